@@ -35,6 +35,9 @@ please keep in mind these two guidelines:
 #include <iomanip>
 #include <ctime>
 #include <sched.h>
+#include <algorithm>
+#include <map>
+#include <vector>
 //Includes for attaching to shared memory
 # include "gmrt_newcorr.h"
 //# include "acqpsr.h"
@@ -103,11 +106,43 @@ class Information
 	char			refFrequency;		//Dedisperse w.r.t 1-> Highest frequency 0-> Lowest frequency
 	char			doUseTempo2;		//Sets the flag to decide whether to use tempo2 or tempo1
 	char			isInline;		//inline mode of gptool - read and write to SHM
+	char			doTiledExecution;	//1-> per-block stages are run on cache sized tiles of time samples
+	long int		tileSizeSamples;	//Number of time samples per tile in tiled execution
+	char			doSumThreshold;		//1-> 2-D SumThreshold flagging of individual samples
+	float			sumThresholdCutOff;	//SumThreshold cutoff to rms ratio for a single sample
+	char			doSpectralKurtosis;	//1-> spectral kurtosis flagging of sub-blocks of each channel
+	int			skBlockLength;		//Number of time samples per spectral kurtosis estimate (M)
+	float			skShape;		//Number of spectra integrated per sample times shape factor (N*d)
+	char			doChannelMaskLibrary;	//1-> persistent per band channel mask library is applied and updated
+	float			channelMaskOccupancy;	//Fraction of blocks a channel is flagged in for the library to mask it
+	char			doSkipFlaggedBlocks;	//1-> dedispersion, folding and filtered output are skipped for mostly flagged blocks
+	float			skipFlaggedOccupancy;	//Flagged fraction of a block above which it is skipped
+	char			doOverlapSave;		//1-> each block is dedispersed completely from a look-back of the 2-D data, with no carry between blocks
+	char			doDMSearch;		//1-> the data is also dedispersed at a range of trial DMs (FDMT)
+	float			dmSearchLow;		//Lowest trial DM
+	float			dmSearchHigh;		//Highest trial DM
+	float			dmSearchTolerance;	//Smearing tolerance between adjacent trial DMs
+	char			doSinglePulseSearch;	//1-> the dedispersed series are searched for single pulses
+	float			singlePulseThreshold;	//Signal to noise ratio above which a boxcar is a detection
+	float			singlePulseMaxWidthMs;	//Width of the widest boxcar in ms
+	char			doSnapshot;		//1-> the last seconds of filtered 2-D data are kept in memory and dumped around triggers
+	float			snapshotBufferSec;	//Length of the snapshot buffer in seconds
+	float			snapshotThreshold;	//Single pulse S/N above which a snapshot is dumped
+	char			doCube;			//1-> the data is also folded into a subint x subband x polarization x bin cube
+	float			cubeSubintSec;		//Length of a subint of the cube in seconds
+	int			cubeSubbands;		//Number of subbands of the cube
+	char			doPulsarList;		//1-> the pulsars listed in pulsarListFile are also folded from the same filtered data
+	string			pulsarListFile;		//One pulsar per line: name, period in ms (-1 -> polyco), DM (-1 -> catalogue) and number of bins (-1 -> native)
+	char			doPeriodicitySearch;	//1-> the dedispersed series are searched for periodic signals with FFTs
+	float			periodicitySegmentSec;	//Length of the segments searched in seconds (0-> whole observation)
+	int			periodicityHarmonics;	//Most harmonics summed (1,2,4,8,16 or 32)
+	float			periodicityThreshold;	//Gaussian equivalent significance above which a peak is a candidate
 	//Time filtering information:
 	char			doTimeFlag;		//0-> Time flagging off		1-> Time flagging on
-	char			timeFlagAlgo;		//1-> Histogram based		2-> MAD based
+	char			timeFlagAlgo;		//1-> Histogram based		2-> MAD based		3-> Streaming quartiles
 	char			doTimeClip;		//0-> Time sample clipping off	1-> On
 	char			doMultiPointFilter;	//0-> single point filter	1-> Multi-point filter
+	int			multiPointLength;	//Longest run of samples tested by the multi-point filter (2 to 5)
 	char			doUseNormalizedData;	//0-> w/o normalization 	1-> w normalizations
 	float			timeCutOffToRMS;	//Cutoff to rms ratio
 	float*			cutoff;			//multi point rms cutoffs for time filtering stored here
@@ -143,11 +178,13 @@ class Information
 	void genPolycoTempo1();				//Fires tempo1 to generate polyco.dat
 	void genPolycoTempo2();				//Fires tempo2 to generate polyco.dat
 	void loadPolyco();				//loads information from polyco.dat to double* polycoTable
+	double expandPolyco(double timeMs,long double& phase,double& slope,double& curvature);	//Polyco phase and its derivatives at a given time
 	void checkPulsarName();				//Verifies if the pulsar name is valid
 	void autoDM();					//Gets dispersion measure from psr cat
 	void calculateCutoff();
 	void errorChecks(); 		//Checks for error in the .in file
 	void fillParams();
+	void initializeFolding();			//Gets the period (or polycos), number of bins and DM of the pulsar to fold
 	void parseManFlagList(std::string& s);	//parses list of bad sub-bands
 };
 
@@ -576,7 +613,6 @@ void Information::readGptoolInputFile()
 	refFrequency=0;
 	flagOrder=1;
 	chanFlagAlgo=2;
-	doMultiPointFilter=0;
 	if(flagOrder==2 && doUseNormalizedData) //Channel filtering cannot be done after time filtering if data is normalized
 	{
 		cout<<"Error in line of gptool.in"<<endl;
@@ -585,7 +621,8 @@ void Information::readGptoolInputFile()
 		exit(0);
 	}
 	
-//	calculateCutoff();	
+	if(doMultiPointFilter)
+		calculateCutoff();	
 	errorChecks();
 }
 void Information::parseManFlagList(std::string& s)
@@ -661,47 +698,7 @@ void Information::fillParams()
 		
 	}
 	if(!doFilteringOnly)
-	{
-		if(!doFixedPeriodFolding)	//Perform actions to use polyco based folding
-		{
-			genMJDObs();
-			if(doUseTempo2)
-				genPolycoTempo2();
-			else
-	 			genPolycoTempo1();
-	 		loadPolyco();
-	 		polycoRowIndex= (int)(((MJDObs-polycoTable[0])*1440)+spanPolyco/2.0)/spanPolyco;
-			double freq=polycoTable[polycoRowIndex*(3+nCoeffPolyco)+2]*60.0;
-			double dt=(MJDObs-polycoTable[polycoRowIndex*(3+nCoeffPolyco)])*1440;
-			/***********************************************************************************************
-			*The following while loop is due to an ill understood issue with the polyco.dat file (generated by
-			*tempo 1) where a particular set(s) in the file has a dataspan less than that specified by spanPolyco
-			*(usually half of it, for example if spanPolyco is 60mins, there maybe a 30mins set in the file. The
-			*reason is not yet understood (8th May '16)
-			************************************************************************************************/
-			while(dt>spanPolyco/2.0)
-			{
-				polycoRowIndex++;
-				dt=(MJDObs-polycoTable[polycoRowIndex*(3+nCoeffPolyco)])*1440;
-			}
-			/***********************************************************************************************
-			*The next loop is for the yet unecountered case of set(s) having more span than spanPolyco
-			************************************************************************************************/
-			while(dt<-spanPolyco/2.0)
-			{
-				polycoRowIndex--;
-				dt=(MJDObs-polycoTable[polycoRowIndex*(3+nCoeffPolyco)])*1440;
-			}
-			for(int i=1;i<nCoeffPolyco;i++)  	
-	    			freq += i*polycoTable[polycoRowIndex*(3+nCoeffPolyco)+3+i] * pow(dt,i-1);
-	 		periodInMs = (1000.0*60.0)/freq;
-	 	} 	
-
-		if(periodInSamples==-1)
-			periodInSamples=(int)(periodInMs/(samplingInterval*1000.0)+0.5);	//Calculating the period in number of samples
-		if(dispersionMeasure<0) //Get DM from psrcat or polyco.dat
-			autoDM();
-	}
+		initializeFolding();
 
 	if(blockSizeSec==0)						//Setting blocksize equal to pulsar period
 		blockSizeSec=periodInMs/1000.0;
@@ -739,6 +736,56 @@ void Information::fillParams()
 		}
 	}
 }
+/*******************************************************************
+*FUNCTION: void Information::initializeFolding()
+*Gets the polycos (or uses the fixed period), the number of bins and
+*the DM of the pulsar to fold. Also used for the pulsars of the 
+*-pulsars list, each on its own copy of Information.
+*******************************************************************/
+void Information::initializeFolding()
+{
+	if(!doFixedPeriodFolding)	//Perform actions to use polyco based folding
+	{
+		genMJDObs();
+		if(doUseTempo2)
+			genPolycoTempo2();
+		else
+ 			genPolycoTempo1();
+ 		loadPolyco();
+ 		polycoRowIndex= (int)(((MJDObs-polycoTable[0])*1440)+spanPolyco/2.0)/spanPolyco;
+		double freq=polycoTable[polycoRowIndex*(3+nCoeffPolyco)+2]*60.0;
+		double dt=(MJDObs-polycoTable[polycoRowIndex*(3+nCoeffPolyco)])*1440;
+		/***********************************************************************************************
+		*The following while loop is due to an ill understood issue with the polyco.dat file (generated by
+		*tempo 1) where a particular set(s) in the file has a dataspan less than that specified by spanPolyco
+		*(usually half of it, for example if spanPolyco is 60mins, there maybe a 30mins set in the file. The
+		*reason is not yet understood (8th May '16)
+		************************************************************************************************/
+		while(dt>spanPolyco/2.0)
+		{
+			polycoRowIndex++;
+			dt=(MJDObs-polycoTable[polycoRowIndex*(3+nCoeffPolyco)])*1440;
+		}
+		/***********************************************************************************************
+		*The next loop is for the yet unecountered case of set(s) having more span than spanPolyco
+		************************************************************************************************/
+		while(dt<-spanPolyco/2.0)
+		{
+			polycoRowIndex--;
+			dt=(MJDObs-polycoTable[polycoRowIndex*(3+nCoeffPolyco)])*1440;
+		}
+		for(int i=1;i<nCoeffPolyco;i++)  	
+    			freq += i*polycoTable[polycoRowIndex*(3+nCoeffPolyco)+3+i] * pow(dt,i-1);
+ 		periodInMs = (1000.0*60.0)/freq;
+ 	} 	
+	else if(doSinglePulseSearch || doSnapshot || doCube || doPeriodicitySearch)	//Single pulse and periodicity candidates, snapshots and the cube are time stamped in MJD
+		genMJDObs();
+
+	if(periodInSamples==-1)
+		periodInSamples=(int)(periodInMs/(samplingInterval*1000.0)+0.5);	//Calculating the period in number of samples
+	if(dispersionMeasure<0) //Get DM from psrcat or polyco.dat
+		autoDM();
+}
 void Information::errorChecks()
 {
 	char erFlag=0;
@@ -843,9 +890,9 @@ void Information::errorChecks()
 		erFlag=1;
 	}
 	
-	if(timeFlagAlgo!=2 && timeFlagAlgo!=1)
+	if(timeFlagAlgo!=2 && timeFlagAlgo!=1 && timeFlagAlgo!=3)
 	{
-		cout<<"Error in line 43 of  gptool.in:"<<endl<<"1 to use histogram based, 2 to use MAD basesd."<<endl;
+		cout<<"Error in line 43 of  gptool.in:"<<endl<<"1 to use histogram based, 2 to use MAD basesd, 3 to use streaming quartiles."<<endl;
 		erFlag=1;
 	}
 	
@@ -887,6 +934,21 @@ void Information::errorChecks()
 		cout<<"Invalid combination of choices in line 41 and 49."<<endl<<"Time filtering must be on to replace by modal (median) values.";
 		erFlag=1;
 	}
+	if(doReplaceByMean!=0 && doOverlapSave)
+	{
+		cout<<"Invalid combination of choice in line 49 and -overlapsave."<<endl<<"Overlap-save dedispersion uses the flags, flagged samples cannot be replaced.";
+		erFlag=1;
+	}
+	if(doSpectralKurtosis && doTimeFlag && doChanFlag && flagOrder==2)
+	{
+		cout<<"Invalid combination of time first flag order and -sk."<<endl<<"Spectral kurtosis flags channels before time filtering, it cannot follow it.";
+		erFlag=1;
+	}
+	if(doDMSearch && doUseNormalizedData!=1)
+	{
+		cout<<"Invalid combination of choice in line 42 and -dmsearch."<<endl<<"Data must be normalized to search trial DMs.";
+		erFlag=1;
+	}
 	if(normalizationProcedure==2)
 	{
 		ifstream testExistance;
@@ -1004,6 +1066,11 @@ void Information::calculateCutoff()
   5.39397, 4.55945, 3.98813}, {10., 6.85773, 5.45273, 4.61055, 
   4.03394}};
   
+  if(timeCutOffToRMS<1 || timeCutOffToRMS>10)
+  {
+  	cout<<"Multi-point time flagging needs a time flagging threshold between 1 and 10."<<endl;
+  	exit(0);
+  }
   cutoff=new float[5];
   cutoff[0]=timeCutOffToRMS;
   
@@ -1352,6 +1419,42 @@ void Information::loadPolyco()
     	polyco->close(); 
 	delete polyco;
 }
+/*******************************************************************
+*FUNCTION: double Information::expandPolyco(double timeMs,long double& phase,double& slope,double& curvature)
+*double timeMs		:Time after the start of observation in ms
+*long double& phase	:returns the polyco phase (in turns)
+*double& slope		:returns the first derivative of phase (turns/ms)
+*double& curvature	:returns half the second derivative (turns/ms^2)
+*returns the time (in ms) up to which the polyco set is used.
+*The polynomial and its derivatives are evaluated by Horner's rule, 
+*so the phase of the samples near timeMs follows from a quadratic 
+*expansion instead of a full evaluation per sample. The time is 
+*counted from the set at the start of observation and moved by 
+*spanPolyco for each later set, so that the phase does not depend on
+*the rounding of the MJD of each set.
+*******************************************************************/
+double Information::expandPolyco(double timeMs,long double& phase,double& slope,double& curvature)
+{
+	int rowIndex=polycoRowIndex;
+	double dt=timeMs/60000.0+(MJDObs-polycoTable[rowIndex*(3+nCoeffPolyco)+0])*1440;
+	while(dt>spanPolyco/2.0)
+	{
+		dt-=spanPolyco;
+		rowIndex++;
+	}
+	double* polycoSet=&(polycoTable[rowIndex*(3+nCoeffPolyco)]);
+	long double value=0,first=0,second=0;
+	for(int i=nCoeffPolyco-1;i>=0;i--)
+	{
+		second=second*dt+first;
+		first=first*dt+value;
+		value=value*dt+polycoSet[3+i];
+	}
+	phase=polycoSet[1]+(long double)dt*60*polycoSet[2]+value;
+	slope=(60*polycoSet[2]+first)/60000.0;
+	curvature=second/(60000.0*60000.0);
+	return timeMs+(spanPolyco/2.0-dt)*60000.0;
+}
 
 /*******************************************************************
 *FUNCTION: void Information::display()
@@ -1498,12 +1601,14 @@ void Information::display()
 			displays<<"\tHistogram based algorithm selected."<<endl;
 		else if(timeFlagAlgo==2)
 			displays<<"\tMAD based algorithm selected."<<endl;
+		else if(timeFlagAlgo==3)
+			displays<<"\tStreaming quartile based algorithm selected."<<endl;
 		
 		if(doMultiPointFilter)
 		{
-			displays<<"\tMultipoint flagging ON. CutOff to rms : "<<endl;
-			for(int j=0;j<3;j++)
-				cout<<"\t"<<cutoff[j]<<" ";
+			displays<<"\tMultipoint flagging ON. CutOff to rms for 1 to "<<multiPointLength<<" point runs: "<<endl;
+			for(int j=0;j<multiPointLength;j++)
+				displays<<"\t"<<cutoff[j]<<" ";
 			displays<<endl;
 		}
 		else
@@ -1525,7 +1630,7 @@ void Information::display()
 		{
 			if(timeFlagAlgo==1)
 				displays<<endl<<"Flagged samples will be replaced by modal value of zero DM time series.";
-			else if(timeFlagAlgo==2)
+			else if(timeFlagAlgo==2 || timeFlagAlgo==3)
 				displays<<endl<<"Flagged samples will be replaced by median value of zero DM time series.";
 		}
 		else
@@ -1556,6 +1661,36 @@ void Information::display()
 	
 	if(doWriteFullDM)
 		displays<<"Dedispersed time series will be written out"<<endl<<endl;
+	if(doTiledExecution)
+		displays<<"Per-block stages will be run in three passes (split by the channel and time flags) on tiles of "<<tileSizeSamples<<" time samples"<<endl<<endl;
+	if(doSpectralKurtosis)
+		displays<<"Spectral kurtosis flagging on "<<skBlockLength<<" sample sub-blocks (N*d="<<skShape<<") with cutoff to rms ratio "<<chanCutOffToRMS<<endl<<endl;
+	if(doSumThreshold)
+		displays<<"2-D SumThreshold flagging of individual samples with cutoff to rms ratio "<<sumThresholdCutOff<<endl<<endl;
+	if(doChannelMaskLibrary)
+		displays<<"Channels flagged in more than "<<channelMaskOccupancy*100<<"% of blocks are masked by the channel mask library"<<endl<<endl;
+	if(doOverlapSave)
+		displays<<"Overlap-save dedispersion, blocks are dedispersed independently from a history of the 2-D data"<<endl<<endl;
+	if(doSkipFlaggedBlocks)
+		displays<<"Blocks with more than "<<skipFlaggedOccupancy*100<<"% of data flagged are not dedispersed or folded"<<endl<<endl;
+	if(doDMSearch)
+		displays<<"Trial DMs from "<<dmSearchLow<<" to "<<dmSearchHigh<<" pc/cc with smearing tolerance "<<dmSearchTolerance<<" are searched with the FDMT"<<endl<<endl;
+	if(doSinglePulseSearch)
+		displays<<"Single pulses above S/N "<<singlePulseThreshold<<" and up to "<<singlePulseMaxWidthMs<<" ms wide are searched for"<<endl<<endl;
+	if(doSnapshot)
+		displays<<"The last "<<snapshotBufferSec<<" s of filtered data are kept, snapshots are dumped for single pulses above S/N "<<snapshotThreshold<<" and on SIGUSR1"<<endl<<endl;
+	if(doCube)
+		displays<<"Data is folded into "<<cubeSubintSec<<" s subints of "<<cubeSubbands<<" subbands"<<endl<<endl;
+	if(doPulsarList)
+		displays<<"The pulsars listed in "<<pulsarListFile<<" are also folded"<<endl<<endl;
+	if(doPeriodicitySearch)
+	{
+		if(periodicitySegmentSec>0)
+			displays<<"Periodicity search of "<<periodicitySegmentSec<<" s segments";
+		else
+			displays<<"Periodicity search of the whole observation";
+		displays<<" summing up to "<<periodicityHarmonics<<" harmonics, candidates above "<<periodicityThreshold<<" sigma"<<endl<<endl;
+	}
 
 	if(doRunFilteredMode)
 		displays<<endl<<"WARNING : gptool run in readback mode. Inputs in lines 36,41,42,48 & 54 were overridden."<<endl<<endl;
@@ -1579,7 +1714,7 @@ void Information::display()
 *******************************************************************/
 void Information::displayNoOptionsHelp()
 {
-	cout<<"gptool -f [filename] -r -shmID [shm_ID] -s [start_time_in_sec] -o [output_2d_filtered_file] -m [mean_value_of_2d_op] -tempo2 -nodedisp  -zsub -inline -gfilt"<<endl<<endl;
+	cout<<"gptool -f [filename] -r -shmID [shm_ID] -s [start_time_in_sec] -o [output_2d_filtered_file] -m [mean_value_of_2d_op] -tempo2 -nodedisp  -zsub -inline -gfilt -tile -sumthreshold [cutoff] -sk [M] [N*d] -chanmask [occupancy] -multipoint [N] -skipflagged [occupancy] -overlapsave -dmsearch [DM_low] [DM_high] [tolerance] -singlepulse [S/N] [max_width_ms] -snapshot [buffer_sec] [S/N] -cube [subint_sec] [n_subbands] -pulsars [list_file] -fftsearch [segment_sec] [n_harmonics] [sigma]"<<endl<<endl;
 	cout<<"-f [filename] \t\t\t :Read from GMRT format file [filename]"<<endl;
 	cout<<"-r  \t\t\t\t :Attach to shared memory"<<endl;
 	cout<<"-shmID [shm_ID] \t\t :shm_ID = \t1 -> Standard correlator shm \n\t\t\t\t\t\t2-> File simulator shm \n\t\t\t\t\t\t3-> Inline gptool shm"<<endl; 
@@ -1591,6 +1726,19 @@ void Information::displayNoOptionsHelp()
 	cout<<"-zsub \t\t\t\t :optimized zero DM subtraction. \n\t\t\t\t Experimental feature, use with caution"<<endl;
 	cout<<"-inline \t\t\t :inline mode of gptool, read from a shared memory \n\t\t\t\t write filtered output to another shared memory"<<endl;
 	cout<<"-gfilt \t\t\t\t :turns off all filtering options, \n\t\t\t\t will over-ride gptool.in inputs"<<endl;
+	cout<<"-tile \t\t\t\t :run float conversion and bandshape, then normalization and zero DM, \n\t\t\t\t then filtering and dedispersion on cache sized tiles of time samples"<<endl;
+	cout<<"-sumthreshold [cutoff] \t\t :flag individual time-frequency samples with the SumThreshold \n\t\t\t\t method, cutoff is the cutoff to rms ratio of a single sample"<<endl;
+	cout<<"-sk [M] [N*d] \t\t\t :flag channels of M sample sub-blocks by spectral kurtosis, \n\t\t\t\t N*d is the number of spectra integrated per sample, \n\t\t\t\t uses the channel cutoff to rms ratio of gptool.in"<<endl;
+	cout<<"-chanmask [occupancy] \t\t :mask channels flagged in more than occupancy percent of \n\t\t\t\t blocks of earlier runs on the same band, the library is \n\t\t\t\t kept in $GPTOOL_CHANMASK_PATH (default current directory)"<<endl;
+	cout<<"-multipoint [N] \t\t :time flagging also flags runs of 2 to N (at most 5) samples \n\t\t\t\t above the multi-point cutoffs of the time flagging threshold"<<endl;
+	cout<<"-skipflagged [occupancy] \t :blocks with more than occupancy percent of data flagged \n\t\t\t\t are not dedispersed or folded, their filtered output \n\t\t\t\t is all replacement values"<<endl;
+	cout<<"-overlapsave \t\t\t :dedisperse each block completely from a history of the last \n\t\t\t\t maxDelay samples of 2-D data, blocks do not wait on each \n\t\t\t\t other (needs memory for the history)"<<endl;
+	cout<<"-dmsearch [DM_low] [DM_high] [tolerance] :also dedisperse at trial DMs from DM_low to DM_high with \n\t\t\t\t the FDMT, trials are spaced to smear a pulse by at most \n\t\t\t\t tolerance times its width (e.g. 1.25), writes dmTime.gpt \n\t\t\t\t and the trial table dmTrials.gpt"<<endl;
+	cout<<"-singlepulse [S/N] [max_width_ms] :search fullDM (and the trial DMs of -dmsearch) for single \n\t\t\t\t pulses with boxcars up to max_width_ms wide, clusters of \n\t\t\t\t boxcars above S/N are written to singlepulse.gpt"<<endl;
+	cout<<"-snapshot [buffer_sec] [S/N] \t :keep the last buffer_sec of filtered data in memory, dump the \n\t\t\t\t dispersion sweep around single pulses above S/N (needs \n\t\t\t\t -singlepulse) or the whole buffer on SIGUSR1 to \n\t\t\t\t snapshot_<n>.fil filterbank files listed in snapshots.gpt"<<endl;
+	cout<<"-cube [subint_sec] [n_subbands] \t :also fold into subint_sec long subints of n_subbands \n\t\t\t\t subbands for each polarization, written to cube.gpt"<<endl;
+	cout<<"-pulsars [list_file] \t\t :also fold the pulsars of list_file (one per line: name, \n\t\t\t\t period in ms or -1 for polyco, DM or -1, bins or -1), \n\t\t\t\t filtering is shared, each pulsar is dedispersed and folded \n\t\t\t\t to profile_filtered_<name>.gpt and profile_unfiltered_<name>.gpt"<<endl;
+	cout<<"-fftsearch [segment_sec] [n_harmonics] [sigma] :FFT search of fullDM (and the trial DMs of -dmsearch) for \n\t\t\t\t periodic signals in segment_sec long segments (0 -> whole \n\t\t\t\t observation), red noise whitened, summing up to n_harmonics \n\t\t\t\t (1 to 32) harmonics, peaks above sigma are written to \n\t\t\t\t periodicity.gpt. Series are kept in a scratch file per \n\t\t\t\t polarization (4 bytes per sample and series), long segments \n\t\t\t\t are transformed out of core, segments are searched on a \n\t\t\t\t thread of their own"<<endl;
 	
 }
 
@@ -1707,7 +1855,7 @@ void Information::writeWpmonIn()
 	inFile<<"#****Time domain impulsive RFI mitigation options****#"<<endl;
 	inFile<<"1\t\t: Time flagging options 	(0-> no flagging, 1-> real time calculation)"<<endl;
 	inFile<<"1\t\t: Data normalization before filtering (0-> no, 1-> yes)"<<endl;
-	inFile<<"1\t\t: Time flagging algorithm	(1-> histogram based, 2-> MAD based)"<<endl;
+	inFile<<"1\t\t: Time flagging algorithm	(1-> histogram based, 2-> MAD based, 3-> streaming quartiles)"<<endl;
 	inFile<<"3\t\t: Threshold for time flagging (in units of RMS deviation)"<<endl;
 	inFile<<"-------------------------------------------------"<<endl;
 	inFile<<"#****Other options****#"<<endl;
@@ -1728,1655 +1876,5564 @@ void Information::writeWpmonIn()
 }
 //end of information class methods implementations
 
-
 /*******************************************************************
-*CLASS:	AquireData
-*Contains functions to read data either from a file or SHM (in case 
-*of real time operation). It also has a functions to split read data
-*into four polarizations. 
+*Compile-time specialised kernels
+*The standard GWB setups (1024 to 16384 channels, 1 or 4 polarizations,
+*1 or 2 byte samples) get their own instantiations of the innermost 
+*loops so that the trip counts are known at compile time and the loops
+*can be fully vectorized without run-time alias checks. These are 
+*compiled at -O3 irrespective of the optimization level of the rest of
+*the file. The kernels are picked once at start-up by the select*Kernel()
+*functions; other configurations use the generic code.
 *******************************************************************/
-class AquireData
+#pragma GCC push_options
+#pragma GCC optimize ("O3")
+/*******************************************************************
+*FUNCTION: void splitKernel<NCHANNELS,T>(const void* input,float** splittedRawData,long int blockLength)
+*Converts a block of single polarization integer samples of type T
+*to float.
+*******************************************************************/
+template<int NCHANNELS,typename T>
+void splitKernel(const void* input,float** splittedRawData,long int blockLength)
 {
-	public:
-	//Static variables:	
-	static	Information	info;
-	static long int		eof;  			//Length of file in bytes
-	static double		totalError;		//Cumulative uncorrected difference between true window width and required width
-	static long int		curPos;			//Total number of samples read.
-	//Static SHM Variables:
-	static DasHdrType*	dataHdr;
-	static DataBufType*	dataBuffer;
-	static DataTabType*	dataTab;
-	static unsigned short*  zeros;
-	static int		recNum;
-	static int		currentReadBlock;
-	static int		remainingData;
-	static timeval*		startTimeStamp;
-	static float		buffSizeSec;
-	static int		nbuff;
-	//Variables:
-	unsigned char*		rawDataChar;		//1-byte integer read data is stored here
-	char*			rawDataCharPolar;	//1-byte integer read data is stored here
-	unsigned short*		rawData;		//2-byte integer read data is stored here
-	short*			rawDataPolar;		//2-byte integer read data is stored here
-	float*			rawDataFloat;		//4-byte floating point read data
-	float**			splittedRawData;	//Pointers to 4 polarization data in case of polar modeIndex.
-							//In normal run it just has one pointer to rawData.
-	char			hasReachedEof;		//Flag to let the program know when end of file has been reached
-	long int		blockLength;		//Length(in samples) of the current block
-	int			blockIndex;		//Current window number. (starting from 0)
-	char*			headerInfo;
-	int			nBuffTaken;
-	//Functions:
-	
-	AquireData(Information _info);			/*Constructor for first time intialization, the static variables 
-							 *are initialized here.*/
-	AquireData(int _blockIndex);			//Constructor to intialize non-static me
-			
-	~AquireData();
-	void readData();				/*This method is a wrapper that checks if the data is being read
-							 *from file or from SHM and according calls the	appropiate
-							 *function.*/
-	void readDataFromFile();			//Reads from file
-	void initializeSHM();				//Attaches to SHM
-	int readFromSHM();				//Reads from SHM
-	void splitRawData();
-};
-//Declaring static variables:
-Information 	AquireData::info;
-long int 	AquireData::eof;
-DasHdrType*	AquireData::dataHdr;
-DataBufType*	AquireData::dataBuffer;
-DataTabType*	AquireData::dataTab;
-unsigned short* AquireData::zeros;
-int		AquireData::recNum=0;
-int		AquireData::remainingData=0;
-int		AquireData::currentReadBlock=0;
-long int	AquireData::curPos=0;
-double		AquireData::totalError=0.0;
-float		AquireData::buffSizeSec;
-int		AquireData::nbuff;		
-struct timeval*	AquireData::startTimeStamp;
+	const T* __restrict__ ptrRawData=(const T*)input;
+	float* __restrict__ ptrSplittedRawData=splittedRawData[0];
+	for(long int i=0;i<blockLength;i++,ptrRawData+=NCHANNELS,ptrSplittedRawData+=NCHANNELS)
+		for(int j=0;j<NCHANNELS;j++)
+			ptrSplittedRawData[j]=ptrRawData[j];
+}
 /*******************************************************************
-*CONSTRUCTOR: AquireData::AquireData(Information _info)
-*Information _info : contains all parameters.
-*Invoked on first creation of an object of this type.
-********************************************************************/
-AquireData::AquireData(Information _info)
+*FUNCTION: void splitPolarKernel<NCHANNELS,T>(const void* input,float** splittedRawData,long int blockLength)
+*Splits a block of 4 polarization integer samples of type T into its
+*polarizations (see AquireData::splitRawData() for the data format) 
+*and converts them to float.
+*******************************************************************/
+template<int NCHANNELS,typename T>
+void splitPolarKernel(const void* input,float** splittedRawData,long int blockLength)
 {
-	 info=_info;
-	 blockIndex=0;	 
-	 hasReachedEof=0;
-	 totalError=0.0;
-	 remainingData=0;
-	 //finding length of data file or initializing SHM according to the mode of operation
-	 if(info.doReadFromFile)
-	 {
-	 	ifstream datafile;
-	 	datafile.open(info.filepath,ios::binary);
-		if(!datafile.is_open())
-  		{
-    			cout<<"Raw data file not found!"<<endl;
-    			exit(1);
- 		}
-	 	datafile.seekg(0,ios::end);
-	 	eof=datafile.tellg();
-	 	datafile.close();
-		if(eof==0)
+	const T* __restrict__ ptrRawData=(const T*)input;
+	float* __restrict__ ptrP=splittedRawData[0];
+	float* __restrict__ ptrQ=splittedRawData[1];
+	float* __restrict__ ptrR=splittedRawData[2];
+	float* __restrict__ ptrS=splittedRawData[3];
+	for(long int i=0;i<blockLength;i++,ptrRawData+=4*NCHANNELS,ptrP+=NCHANNELS,ptrQ+=NCHANNELS,ptrR+=NCHANNELS,ptrS+=NCHANNELS)
+		for(int j=0;j<NCHANNELS;j++)
 		{
-			cout<<"DATA FILE EMPTY"<<endl;
-			exit(1);
+			ptrP[j]=ptrRawData[4*j];
+			ptrQ[j]=ptrRawData[4*j+1];
+			ptrR[j]=ptrRawData[4*j+2];
+			ptrS[j]=ptrRawData[4*j+3];
 		}
-	 }
-	// else
-	//	initializeSHM();
-	
-	 
 }
 /*******************************************************************
-*CONSTRUCTOR: AquireData::AquireData(int _blockIndex)
-*int _blockIndex : current window number.
-********************************************************************/
-AquireData::AquireData(int _blockIndex)
+*FUNCTION: void bandshapeKernel<NCHANNELS>(const float* rawData,float* bandshape,float* squareBandshape,long int blockLength)
+*Accumulates the sum and the sum of squares of each channel over all
+*time samples of a block. Whole rows are accumulated, the caller 
+*discards the excluded channels.
+*******************************************************************/
+template<int NCHANNELS>
+void bandshapeKernel(const float* rawData,float* bandshape,float* squareBandshape,long int blockLength)
 {
-	blockIndex=_blockIndex; 
-	hasReachedEof=0;
-	rawData=NULL;
-	rawDataFloat=NULL;
-	rawDataPolar=NULL;
-	splittedRawData=NULL;
-	nBuffTaken=0;
-	if(info.isInline)
-		headerInfo=new char[4096*nbuff];
-	headerInfo=NULL;
+	const float* __restrict__ ptrRawData=rawData;
+	float* __restrict__ ptrBandshape=bandshape;
+	float* __restrict__ ptrSquareBandshape=squareBandshape;
+	for(long int i=0;i<blockLength;i++,ptrRawData+=NCHANNELS)
+		for(int j=0;j<NCHANNELS;j++)
+		{
+			ptrBandshape[j]+=ptrRawData[j];
+			ptrSquareBandshape[j]+=ptrRawData[j]*ptrRawData[j];
+		}
 }
 /*******************************************************************
-*DESTRUCTOR: AquireData::~AquireData()
-*Free all memory
-********************************************************************/
-AquireData::~AquireData()
-{	
-	switch(info.sampleSizeBytes)
+*FUNCTION: void standardizeRow(const float* data,const float* mean,const float* inverseRms,const char* mask,float clip,float* out,int n)
+*Writes the deviations of n channels of a time sample from their mean in
+*units of rms. Samples already flagged in mask are clipped to +-clip.
+*******************************************************************/
+__attribute__((target_clones("avx2","default")))
+void standardizeRow(const float* __restrict__ data,const float* __restrict__ mean,const float* __restrict__ inverseRms,const char* __restrict__ mask,float clip,float* __restrict__ out,int n)
+{
+	for(int j=0;j<n;j++)
 	{
-		case 1:
-			if(!info.doPolarMode)
-			{
-				delete[] rawDataChar;
-			}
-			else
-				delete[] rawDataCharPolar;
-			break;
-		case 2:
-			if(!info.doPolarMode)
-				delete[] rawData;
-			else
-				delete[] rawDataPolar;
-			break;
-		case 4:		
-			delete[] rawDataFloat;
-			break;
+		float v=(data[j]-mean[j])*inverseRms[j];
+		float c=(v>clip)?clip:((v<-clip)?-clip:v);
+		out[j]=mask[j]?c:v;
 	}
-	
-	//delete[] splittedRawData;
-	
 }
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::readData()
-*Wrapper to decide which method to call to aquire data
+*FUNCTION: int slideTimeWindow(const float* data,const float* mean,const float* inverseRms,const char* mask,float clip,float* oldest,float* windowSum,char* trigger,float threshold,int n)
+*Advances the running sums over time of n channels by one sample. The 
+*sample is standardized as in standardizeRow(). oldest holds the values
+*leaving the window and is overwritten by the entering ones. trigger is
+*set where the absolute window sum exceeds threshold.
+*Returns the number of triggered channels.
 *******************************************************************/
-void AquireData::readData()
+__attribute__((target_clones("avx2","default")))
+int slideTimeWindow(const float* __restrict__ data,const float* __restrict__ mean,const float* __restrict__ inverseRms,const char* __restrict__ mask,float clip,
+	float* __restrict__ oldest,float* __restrict__ windowSum,char* __restrict__ trigger,float threshold,int n)
 {
-	double er=info.blockSizeSec/info.samplingInterval;
-	er=er-(long)er;
-	totalError+=er;	
-	blockLength = info.blockSizeSamples;	
-  	if(!info.isInline && totalError>=1.0)
-  	{
-  		blockLength++;
-  		totalError--;
-  	}	
-	if(info.doReadFromFile)
-		readDataFromFile();
-	else
-		readFromSHM();
+	int nTriggered=0;
+	for(int j=0;j<n;j++)
+	{
+		float v=(data[j]-mean[j])*inverseRms[j];
+		float c=(v>clip)?clip:((v<-clip)?-clip:v);
+		v=mask[j]?c:v;
+		float s=windowSum[j]+v-oldest[j];
+		windowSum[j]=s;
+		oldest[j]=v;
+		trigger[j]=(fabsf(s)>threshold);
+		nTriggered+=trigger[j];
+	}
+	return nTriggered;
 }
 /*******************************************************************
-*FUNCTION: void AquireData::initializeSHM()
-*Initializes collect_psr shared memory of GSB/GWB
+*FUNCTION: void flagFrequencyWindows(float* in,int* runs,char* mask,float threshold,int windowLength,int n)
+*Flags in mask all windows of windowLength (a power of 2) consecutive 
+*channels of a time sample whose absolute sum exceeds threshold. The
+*window sums are built in place in log2(windowLength) passes of pairwise
+*sums, which unlike a prefix sum have no serial dependency and 
+*vectorize. Flagged windows are merged with a difference array. in is
+*overwritten, runs is a scratch array of n elements.
 *******************************************************************/
-void AquireData::initializeSHM()
+__attribute__((target_clones("avx2","default")))
+void flagFrequencyWindows(float* in,int* runs,char* mask,float threshold,int windowLength,int n)
 {
-  	int iddataHdr,idDataBuffer;
-	switch(info.shmID)
+	int nWindows=n;
+	for(int width=1;width<windowLength;width*=2)
 	{
-		case 1: //standard correlator shm
-			iddataHdr = shmget(DAS_H_KEY,sizeof(DasHdrType),SHM_RDONLY);
-			idDataBuffer = shmget(DAS_D_KEY,sizeof(DataBufType),SHM_RDONLY);
-		break;
-		case 2: //file shm
-			iddataHdr = shmget(DAS_H_KEY_GPTOOL,sizeof(DasHdrType),SHM_RDONLY);
-			idDataBuffer = shmget(DAS_D_KEY_GPTOOL,sizeof(DataBufType),SHM_RDONLY);
-		break;
-		case 3: //inline gptool shm
-			iddataHdr = shmget(DAS_H_KEY_GPTOOL_INLINE,sizeof(DasHdrType),SHM_RDONLY);
-			idDataBuffer = shmget(DAS_D_KEY_GPTOOL_INLINE,sizeof(DataBufType),SHM_RDONLY);
-		break;
+		nWindows-=width;
+		for(int j=0;j<nWindows;j++)
+			in[j]+=in[j+width];
 	}
-	
-	cout<<"iddataHdr="<<iddataHdr<<endl<<"idDataBuffer="<<idDataBuffer<<endl;
-	
-	if(iddataHdr < 0 || iddataHdr < 0)
+	int found=0;
+	for(int j=0;j<nWindows;j++)
 	{
-		exit(1);
+		int over=(fabsf(in[j])>threshold);
+		runs[j]=over;
+		found|=over;
 	}
-	dataHdr = (DasHdrType*)shmat(iddataHdr,0,SHM_RDONLY);
-  	dataBuffer = (DataBufType*)shmat(idDataBuffer,0,SHM_RDONLY);
-	if((dataBuffer)==(DataBufType*)-1)
+	if(!found)
+		return;
+	int open=0;
+	for(int j=0;j<n;j++)
 	{
-		cout<<"Cannot attach to shared memory!"<<endl;
-		exit(1);
+		if(j<nWindows)
+			open+=runs[j];
+		if(j>=windowLength)
+			open-=runs[j-windowLength];
+		if(open>0)
+			mask[j]=1;
 	}
-	cout<<"Attached to shared memory:"<<dataHdr<<","<<dataBuffer<<endl;
-	dataTab = dataBuffer-> dtab;
-	cout<<"Max no of blocks="<<dataBuffer->maxblocks<<endl;
-	zeros=new unsigned short[dataBuffer->blocksize-4096];
-	if(info.isInline)
-	{	
-		buffSizeSec=(info.samplingInterval*(dataBuffer->blocksize-4096)/(info.sampleSizeBytes*info.noOfChannels));
-		nbuff=(int)floor(info.blockSizeSec/buffSizeSec);
-		info.blockSizeSec=nbuff*buffSizeSec;
-		info.blockSizeSamples=(int)round(info.blockSizeSec/info.samplingInterval);
-
+}
+/*******************************************************************
+*FUNCTION: void sumThresholdSweep(const float* data,long int length,int stride,int n,const float* mean,const float* inverseRms,int nLevels,const int* windowLength,const long int* lag,const float* threshold,float** ring,float** windowSum,long int** flaggedUpTo,char* trigger,float* row,int* runs,char* flags)
+*The sweep of BasicAnalysis::flagSumThreshold() over a block of length
+*time samples of n channels (stride apart in data and flags). For each
+*new time sample, level l of nLevels slides its window along time over
+*the sample lag[l] behind it and flags the triggered channels, then 
+*runs its windows along frequency over the sample that its windows 
+*along time have passed. ring, windowSum and flaggedUpTo hold the state
+*of each level, trigger, row and runs are scratch of n elements.
+*******************************************************************/
+void sumThresholdSweep(const float* data,long int length,int stride,int n,const float* mean,const float* inverseRms,int nLevels,const int* windowLength,const long int* lag,const float* threshold,
+	float** ring,float** windowSum,long int** flaggedUpTo,char* trigger,float* row,int* runs,char* flags)
+{
+	long int end=length+lag[nLevels-1]+windowLength[nLevels-1]-1;
+	for(long int i=0;i<end;i++)
+	{
+		for(int l=0;l<nLevels;l++)
+		{
+			int M=windowLength[l];
+			float windowThreshold=M*threshold[l];
+			//Along time
+			long int t=i-lag[l];
+			if(t>=0 && t<length)
+			{
+				char *ptrMask=&flags[t*stride];
+				if(slideTimeWindow(&data[t*stride],mean,inverseRms,ptrMask,threshold[l],&ring[l][(t%M)*n],windowSum[l],trigger,windowThreshold,n) && t>=M-1)
+				{
+					long int* __restrict__ ptrFlaggedUpTo=flaggedUpTo[l];
+					for(int j=0;j<n;j++)
+					{
+						if(!trigger[j])
+							continue;
+						long int first=(t-M+1>ptrFlaggedUpTo[j]+1)?t-M+1:ptrFlaggedUpTo[j]+1;
+						char *ptrFlag=&flags[first*stride+j];
+						for(long int k=first;k<=t;k++,ptrFlag+=stride)
+							*ptrFlag=1;
+						ptrFlaggedUpTo[j]=t;
+					}
+				}
+			}
+			//Along frequency, once the windows along time can no longer flag the sample
+			long int r=t-M+1;
+			if(M>1 && M<=n && r>=0 && r<length)	//a window of 1 is the same along both axes
+			{
+				char *ptrMask=&flags[r*stride];
+				standardizeRow(&data[r*stride],mean,inverseRms,ptrMask,threshold[l],row,n);
+				flagFrequencyWindows(row,runs,ptrMask,windowThreshold,M,n);
+			}
+		}
 	}
-	 /*   find a block, two blocks before the current block of the shm for reading data */
-	//if(dataBuffer->cur_rec > (dataBuffer->maxblocks)/2)
-	recNum = (dataBuffer->cur_rec+MaxDataBuf)%MaxDataBuf;
-	currentReadBlock = dataTab[recNum].seqnum;
-
-	int timeOff=sizeof(double)+sizeof(int)+sizeof(int)+sizeof(int);
-	int blk_nano_off=timeOff+sizeof(struct timeval)+sizeof(int);
-	startTimeStamp=(struct timeval*)(dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize)+timeOff);
-	
-	int usec=0;
-  	double nano_usec;
-	struct tm *local_t = localtime(&startTimeStamp->tv_sec);
-//  usec = 1000000*(timestamp_gps->tv_usec);
-	double *blk_nano = (double *)(dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize) + blk_nano_off);
-  	usec = (startTimeStamp->tv_usec);
- 	nano_usec = local_t->tm_sec; // putting int value in double:CAUTION
-  	nano_usec += (startTimeStamp->tv_usec)/1e6;
-  	nano_usec += (*blk_nano)/1e6;
-	FILE* FATM=fopen("timestamp.gpt","w");
-        char time_string[40];
-        fprintf(FATM,"#Start time and date\n");
-        fprintf(FATM,"IST Time: %02d:%02d:%012.9lf\n",local_t->tm_hour,local_t->tm_min, nano_usec);
-        strftime (time_string, sizeof (time_string), "%d:%m:%Y", local_t);
-        fprintf(FATM,"Date: %s\n",time_string);
-        fclose(FATM);
-
 }
-double timeWaitTime=0.0; //Benchmark
 /*******************************************************************
-*FUNCTION: AquireData::readFromSHM()
-*Reads from collect_psr shared memory of GSB/GWB
+*FUNCTION: void flagLongRuns(const float* deviation,long int n,float threshold,int minRun,int* runs,char* flags)
+*Marks in flags every sample that lies in a run of at least minRun
+*consecutive deviations above threshold. The length of the run ending
+*at each sample and of the run starting at it are added up in runs 
+*(scratch of n elements), their sum exceeds minRun exactly for such 
+*samples.
 *******************************************************************/
-int AquireData::readFromSHM()
-{  	
-	int DataOff=4096;
-  	int bufferBlockLength=(dataBuffer->blocksize-DataOff)/info.sampleSizeBytes;  		
-	long samplesToTake=info.noOfChannels*info.noOfPol*blockLength* info.sampleSizeBytes;	
-	rawData=new unsigned  short int[blockLength*info.noOfPol*info.noOfChannels];	
-	long int fetched=0;
-	ofstream meanFile;
-	meanFile.open("realTimeWarning.gpt",ios::app);
-	ofstream recordFile;
-	recordFile.open("blockLossRecord.gpt",ios::app);
-	while(fetched<samplesToTake)
+void flagLongRuns(const float* __restrict__ deviation,long int n,float threshold,int minRun,int* __restrict__ runs,char* __restrict__ flags)
+{
+	int run=0;
+	for(long int i=0;i<n;i++)
 	{
-  		timeWaitTime+=omp_get_wtime();
-		int flag=0;
-		while((dataHdr->status == DAS_START) && (dataTab[recNum].flag &BufReady) == 0)
+		run=(deviation[i]>threshold)?run+1:0;
+		runs[i]=run;
+	}
+	run=0;
+	for(long int i=n-1;i>=0;i--)
+	{
+		run=(deviation[i]>threshold)?run+1:0;
+		runs[i]+=run;
+	}
+	for(long int i=0;i<n;i++)
+		flags[i]|=(runs[i]>minRun);
+}
+/*******************************************************************
+*FUNCTION: void absoluteDeviation(const float* input,long int n,float centre,float* deviation)
+*deviation[i]=|input[i]-centre|
+*******************************************************************/
+void absoluteDeviation(const float* __restrict__ input,long int n,float centre,float* __restrict__ deviation)
+{
+	for(long int i=0;i<n;i++)
+		deviation[i]=fabsf(input[i]-centre);
+}
+/*******************************************************************
+*FUNCTION: void accumulateMoments(const float* data,float* sum,float* squareSum,int n)
+*Adds a time sample of n channels to their sums and sums of squares.
+*******************************************************************/
+void accumulateMoments(const float* __restrict__ data,float* __restrict__ sum,float* __restrict__ squareSum,int n)
+{
+	for(int j=0;j<n;j++)
+	{
+		sum[j]+=data[j];
+		squareSum[j]+=data[j]*data[j];
+	}
+}
+/*******************************************************************
+*FUNCTION: void binSamples(const float* input,int n,float origin,float interval,int size,int* counts)
+*Bins n samples into size bins of width interval starting at origin.
+*Samples below or above the bins go to an underflow and an overflow bin.
+*counts holds 4 interleaved sub-histograms of size+2 bins each 
+*([underflow,bins,overflow] per lane), consecutive samples go to 
+*different lanes so that increments of the same bin do not wait on each
+*other. Bin indices are computed in vectorized chunks.
+*******************************************************************/
+void binSamples(const float* __restrict__ input,int n,float origin,float interval,int size,int* __restrict__ counts)
+{
+	const int chunk=256;
+	int index[chunk];
+	int stride=size+2;
+	for(int first=0;first<n;first+=chunk)
+	{
+		int m=(n-first<chunk)?n-first:chunk;
+		for(int k=0;k<m;k++)
 		{
-			usleep(2000);
-			if(flag==0)
-			{
-				cout<<"Waiting"<<endl;
-				flag=1;
-			}
+			float x=(input[first+k]-origin)/interval;
+			x=(x>size)?size:x;				//clamped before conversion to int
+			index[k]=(x>=0)?(int)x+1:0;			//NaNs go to the underflow bin
 		}
-		if(flag==1)
-			cout<<"Ready"<<endl;
-		timeWaitTime-=omp_get_wtime();
-		if(dataHdr->status != DAS_START)
+		int k=0;
+		for(;k+4<=m;k+=4)
 		{
-			if ((dataTab[recNum].flag & BufReady) == 0)
-			{
-				cout<<"DAS not in START mode!!"<<endl;
-				return -1;
-			}
-		}
-		currentReadBlock = dataTab[recNum].seqnum;
-		if(!info.isInline)
-		{			
-			cout<<endl<<"recNum "<<recNum<<endl;
-			cout<<"dataBuffer->cur_rec "<<dataBuffer->cur_rec<<endl;
-			cout<<"MaxDataBuf "<<MaxDataBuf<<endl;
-			cout<<"dataBuffer->cur_block "<<dataBuffer->cur_block<<endl;
-			cout<<"currentReadBlock "<<currentReadBlock<<endl;
-			cout<<"dataBuffer->maxblocks "<<dataBuffer->maxblocks<<endl<<endl;
+			counts[index[k]]++;
+			counts[stride+index[k+1]]++;
+			counts[2*stride+index[k+2]]++;
+			counts[3*stride+index[k+3]]++;
 		}
-		//memcpy(&currentReadBlock, &dataTab[recNum].seqnum, sizeof(int));
-		//dataBuffer->maxblocks-1
-		if(dataBuffer->cur_block - currentReadBlock >=dataBuffer->maxblocks-1)
+		for(;k<m;k++)
+			counts[index[k]]++;
+	}
+}
+/*******************************************************************
+*FUNCTION: void transposeTile<T>(const T* input,long int stride,int nRows,int nColumns,T* output,long int outputStride)
+*Copies nRows rows of nColumns elements (rows stride elements apart)
+*to output as nColumns rows of nRows elements (rows outputStride 
+*elements apart), i.e. a tile of time
+*samples of the 2-D data to channel major order. Done in 16x16 
+*sub-blocks so that both the rows read and the rows written stay in 
+*the L1 cache.
+*******************************************************************/
+template<typename T>
+void transposeTile(const T* __restrict__ input,long int stride,int nRows,int nColumns,T* __restrict__ output,long int outputStride)
+{
+	const int width=16;
+	for(int firstRow=0;firstRow<nRows;firstRow+=width)
+	{
+		int lastRow=(nRows-firstRow<width)?nRows:firstRow+width;
+		for(int first=0;first<nColumns;first+=width)
 		{
-			meanFile<<"Lag in block blockIndex="<<blockIndex<<endl;
-			meanFile<<"recNum = "<<recNum<<", Reading Sequence: "<<currentReadBlock<<", Collect's Sequence: "<<(dataBuffer->cur_block-1)<<endl;
-			cout<<"Processing lagged behind..."<<endl;
-			//recordFile<<blockIndex
-			/*while(dataBuffer->cur_block - currentReadBlock >=dataBuffer->maxblocks-1)
-			{
-				if(samplesToTake-fetched>dataBuffer->blocksize-DataOff-remainingData)
-				{
-					memcpy(rawData+fetched/sizeof(unsigned short), zeros+remainingData, dataBuffer->blocksize-DataOff-remainingData);
-  				fetched+=(dataBuffer->blocksize-DataOff-remainingData);
-  				recNum=(recNum+1)%MaxDataBuf;
-				remainingData=0;
-  				}
-  				else
-  				{
-					memcpy(rawData+fetched/sizeof(unsigned short), zeros+remainingData,samplesToTake-fetched);				
-					remainingData=(samplesToTake-fetched);
-					curPos+=samplesToTake;
-					meanFile.close();
-  					return -1;
-  				}
-				currentReadBlock = dataTab[(recNum)].seqnum;
-			}*/
-			cout<<"recNum = "<<recNum<<", Reading Sequence: "<<currentReadBlock<<", Collect's Sequence: "<<(dataBuffer->cur_block-1)<<" blockIndex = "<<blockIndex<<"\nRealiging...\n";
-			recNum = (dataBuffer->cur_rec-1-2+MaxDataBuf)%MaxDataBuf;
-			currentReadBlock = dataTab[(recNum)].seqnum;
+			int last=(nColumns-first<width)?nColumns:first+width;
+			for(int j=first;j<last;j++)
+				for(int i=firstRow;i<lastRow;i++)
+					output[j*outputStride+i]=input[i*stride+j];
 		}
-		//cout<<"recNum = "<<recNum<<", Reading Sequence: "<<currentReadBlock<<", Collect's Sequence: "<<dataBuffer->cur_block-1<<endl;
-		//cout<<"Blocksize="<<dataBuffer->blocksize<<endl;
-		if(samplesToTake-fetched>dataBuffer->blocksize-DataOff-remainingData)
-		{	
-			if(info.isInline)
-			{
-				memcpy(headerInfo+nBuffTaken*DataOff, dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize), DataOff);
-				nBuffTaken++;
-			}
-  			memcpy(rawData+fetched/sizeof(short), dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize)+DataOff+remainingData, dataBuffer->blocksize-DataOff-remainingData);
-  			fetched+=(dataBuffer->blocksize-DataOff-remainingData);
-  			recNum=(recNum+1)%MaxDataBuf;
-			remainingData=0;
-  		}
-  		else
-  		{
-  			memcpy(rawData+fetched/sizeof(short), dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize)+DataOff+remainingData, samplesToTake-fetched);
-			remainingData=(samplesToTake-fetched);
-  			break;
-  		}
-  	}
-  	curPos+=samplesToTake;
-	meanFile.close();
-	return 1;
+	}
 }
 /*******************************************************************
-*FUNCTION: void AquireData::readDataFromFile()
-*In offline mode reads raw data from a file
+*FUNCTION: void shiftAddRow(const float* row,const float* weight,int n,float* sum,int* count,float* sumAll,int* countAll)
+*Adds n time samples of a channel to the dedispersed series starting 
+*at its shifted position. Samples of weight 1 are added to sum and 
+*count, all samples to sumAll and countAll.
 *******************************************************************/
-void AquireData::readDataFromFile()
+void shiftAddRow(const float* __restrict__ row,const float* __restrict__ weight,int n,float* __restrict__ sum,int* __restrict__ count,float* __restrict__ sumAll,int* __restrict__ countAll)
 {
-	int 	 c,i;
-	long int blockSizeBytes= info.noOfChannels*info.noOfPol* blockLength* info.sampleSizeBytes; //Number of bytes to read in eac block
-							//Number of bytes that have already been read
-	
-	ifstream datafile;
-	datafile.open(info.filepath,ios::binary);	
-	datafile.seekg(curPos,ios::beg);
-	//logic to handle reading last block
-	if(curPos+blockSizeBytes> eof)
+	for(int i=0;i<n;i++)
 	{
-		blockSizeBytes=eof-curPos;
-		blockLength=blockSizeBytes/(info.sampleSizeBytes*info.noOfChannels*info.noOfPol);		//The number of time samples 
-		hasReachedEof=1;
+		sum[i]+=row[i]*weight[i];
+		count[i]+=(int)weight[i];
+		sumAll[i]+=row[i];
+		countAll[i]++;
 	}
-	/*******************************************************************
-	*Handles different data types. GMRT data is mostly of type short while 
-	*certain processed data maybe floating point.
-	*******************************************************************/
-	switch(info.sampleSizeBytes)
+}
+/*******************************************************************
+*FUNCTION: void shiftAddFlaggedRow(const float* row,int n,float* sumAll,int* countAll)
+*As shiftAddRow() for a flagged channel, only sumAll and countAll are
+*updated.
+*******************************************************************/
+void shiftAddFlaggedRow(const float* __restrict__ row,int n,float* __restrict__ sumAll,int* __restrict__ countAll)
+{
+	for(int i=0;i<n;i++)
 	{
-		case 1:
-			if(!info.doPolarMode)
-			{
-				rawDataChar=new unsigned char[blockSizeBytes/info.sampleSizeBytes];
-				datafile.read((char*)rawDataChar,blockSizeBytes);
-			}	
-			else
-			{
-				rawDataCharPolar=new char[blockSizeBytes/info.sampleSizeBytes];
-				datafile.read((char*)rawDataCharPolar,blockSizeBytes);
-			
-			}
-			break;
-		case 2:
-			if(!info.doPolarMode)
-			{
-				rawData=new unsigned short[blockSizeBytes/info.sampleSizeBytes];
-				datafile.read((char*)rawData,blockSizeBytes);			
-			}
-			else
-			{
-				rawDataPolar=new short[blockSizeBytes/info.sampleSizeBytes];
-				datafile.read((char*)rawDataPolar,blockSizeBytes);	
-			}
-
-			break;
-		case 4:
-			rawDataFloat=new float[blockSizeBytes/info.sampleSizeBytes];
-			datafile.read((char*)rawDataFloat,blockSizeBytes);
-			break;
+		sumAll[i]+=row[i];
+		countAll[i]++;
 	}
-	datafile.close();		
-	curPos+=blockSizeBytes;
 }
-float u16tofloat(short x)
+/*******************************************************************
+*FUNCTION: void sampleWeights(const float* timeWeight,const char* sampleFlags,int n,float* weight)
+*Weights of the samples of a channel row, 0 if the time sample or the
+*individual sample is flagged and 1 otherwise.
+*******************************************************************/
+void sampleWeights(const float* __restrict__ timeWeight,const char* __restrict__ sampleFlags,int n,float* __restrict__ weight)
 {
-    union { float f; int i; } u; u.f = 0.00f; u.i |= x;
-    return u.f ; 
+	for(int i=0;i<n;i++)
+		weight[i]=sampleFlags[i]?0.0f:timeWeight[i];
 }
-/**********************************************************************
-*FUNCTION: void AquireData::splitRawData()
-*If on polar mode, splitting of raw data into four polarization channels
-*is done here. GMRT polarization data is read out in the following fomat:
-T1_C1_P T1_C1_Q T1_C1_R T1_C1_S T1_C2_P T1_C2_Q T1_C2_R T1_C2_S...
-T1_CN_S T2_C1_P ...........TN_CN_S
-where P,Q,R,S are the four polarizations, Cn denotes the nth channel 
-and Tn the nth time sample. So T15_C25_Q means the Q-polarization data
-of channel 25 of the 15th time sample.
-**********************************************************************/
-void AquireData::splitRawData()
+/*******************************************************************
+*FUNCTION: void shiftAddMaskedRow(const float* row,const char* flags,int n,float* sum,int* count,float* sumAll,int* countAll)
+*As shiftAddRow() with the samples given by flags (1-> flagged) 
+*instead of weights.
+*******************************************************************/
+void shiftAddMaskedRow(const float* __restrict__ row,const char* __restrict__ flags,int n,float* __restrict__ sum,int* __restrict__ count,float* __restrict__ sumAll,int* __restrict__ countAll)
 {
-	
-	splittedRawData=new float*[info.noOfPol];
-	float **ptrSplittedRawData=new float*[info.noOfPol];
-	long int length=blockLength*info.noOfChannels;	
-	for(int k=0;k<info.noOfPol;k++)
+	for(int i=0;i<n;i++)
 	{
-		splittedRawData[k]=new float[length];
-		ptrSplittedRawData[k]=splittedRawData[k];
+		sum[i]+=flags[i]?0.0f:row[i];
+		count[i]+=(flags[i]==0);
+		sumAll[i]+=row[i];
+		countAll[i]++;
 	}
-	/*******************************************************************
-	*Handles different data types. GMRT data is mostly of type short while 
-	*certain processed data maybe floating point.
-	*******************************************************************/
-	
-	float* ptrRawDataFloat=rawDataFloat;
-	switch(info.sampleSizeBytes)
+}
+/*******************************************************************
+*FUNCTION: void foldRow(const float* row,const float* weight,int n,const long int* offset,float* sums,int* counts)
+*Folds n time samples of a channel into a partial cube. offset holds 
+*the position in sums and counts of each sample (-1 if it is not 
+*folded), weight is 1 for the samples to fold and 0 for flagged ones.
+*******************************************************************/
+void foldRow(const float* __restrict__ row,const float* __restrict__ weight,int n,const long int* __restrict__ offset,float* __restrict__ sums,int* __restrict__ counts)
+{
+	for(int i=0;i<n;i++)
 	{
-		case 1:		
-			if(!info.doPolarMode)
-			{
-				unsigned char* ptrRawData=rawDataChar;	
-				for(int j=0;j<blockLength;j++)		//Refer to the GMRT polarization data format in Function description.
-				{		
-					for(int i=0;i<info.noOfChannels;i++,ptrRawData++,ptrSplittedRawData[0]++)
-					{
-							*(ptrSplittedRawData[0])=(*ptrRawData);
-					}
-				}
-			}
-			else
-			{
-				char* ptrRawData=rawDataCharPolar;	
-				for(int j=0;j<blockLength;j++)		//Refer to the GMRT polarization data format in Function description.
-				{		
-					for(int i=0;i<info.noOfChannels;i++)
-					{
-							*(ptrSplittedRawData[0]++)=(*ptrRawData++);
-							*(ptrSplittedRawData[1]++)=(*ptrRawData++);
-							*(ptrSplittedRawData[2]++)=(*ptrRawData++);
-							*(ptrSplittedRawData[3]++)=(*ptrRawData++);
+		long int pos=offset[i];
+		if(pos<0)
+			continue;
+		sums[pos]+=row[i]*weight[i];
+		counts[pos]+=(int)weight[i];
+	}
+}
+/*******************************************************************
+*FUNCTION: void combineFlags(const char* timeFlags,char channelFlag,char hasSampleFlags,int n,char* flags)
+*Flags n samples of a channel that are flagged in time or whose 
+*channel is flagged. If hasSampleFlags is 1 flags already holds the
+*flags of the individual samples, which are kept.
+*******************************************************************/
+void combineFlags(const char* __restrict__ timeFlags,char channelFlag,char hasSampleFlags,int n,char* __restrict__ flags)
+{
+	if(hasSampleFlags)
+		for(int i=0;i<n;i++)
+			flags[i]|=timeFlags[i]|channelFlag;
+	else
+		for(int i=0;i<n;i++)
+			flags[i]=timeFlags[i]|channelFlag;
+}
+/*******************************************************************
+*FUNCTION: void centreMaskedRow(float* row,const char* flags,int n)
+*Subtracts the mean (1 for normalized data) from n samples of a
+*channel in place, flagged samples are set to 0.
+*******************************************************************/
+void centreMaskedRow(float* __restrict__ row,const char* __restrict__ flags,int n)
+{
+	for(int i=0;i<n;i++)
+		row[i]=flags[i]?0.0f:row[i]-1.0f;
+}
+/*******************************************************************
+*FUNCTION: void addRows(const float* a,const float* b,long int n,float* out)
+*Element wise sum of two rows.
+*******************************************************************/
+void addRows(const float* __restrict__ a,const float* __restrict__ b,long int n,float* __restrict__ out)
+{
+	for(long int i=0;i<n;i++)
+		out[i]=a[i]+b[i];
+}
+/*******************************************************************
+*FUNCTION: void scrunchRow(const float* row,long int nBins,int factor,float* out)
+*Adds up each factor consecutive samples of a row into nBins bins.
+*******************************************************************/
+void scrunchRow(const float* __restrict__ row,long int nBins,int factor,float* __restrict__ out)
+{
+	for(long int b=0;b<nBins;b++,row+=factor)
+	{
+		float sum=0;
+		for(int i=0;i<factor;i++)
+			sum+=row[i];
+		out[b]=sum;
+	}
+}
+/*******************************************************************
+*FUNCTION: void quadraticBins(double phase,double slope,double curvature,long int n,int nBins,int* bins)
+*Bins of n samples whose phase (in turns) is 
+*phase+slope*k+curvature*k*k for sample k.
+*******************************************************************/
+void quadraticBins(double phase,double slope,double curvature,long int n,int nBins,int* __restrict__ bins)
+{
+	for(long int k=0;k<n;k++)
+	{
+		double x=phase+k*(slope+k*curvature);
+		x-=floor(x);
+		int index=(int)(x*nBins+0.5);
+		bins[k]=(index==nBins)?0:index;
+	}
+}
+/*******************************************************************
+*FUNCTION: void butterflyPass(float* data,long int n,long int half,const float* twiddle,long int stride)
+*One radix-2 decimation in time pass over n interleaved complex points
+*with butterflies half points apart. The twiddle factor of butterfly
+*k is twiddle[k*stride].
+*******************************************************************/
+void butterflyPass(float* data,long int n,long int half,const float* __restrict__ twiddle,long int stride)
+{
+	for(long int start=0;start<n;start+=2*half)
+	{
+		float* __restrict__ a=data+2*start;
+		float* __restrict__ b=a+2*half;
+		for(long int k=0;k<half;k++)
+		{
+			float wRe=twiddle[2*k*stride],wIm=twiddle[2*k*stride+1];
+			float re=b[2*k]*wRe-b[2*k+1]*wIm;
+			float im=b[2*k]*wIm+b[2*k+1]*wRe;
+			b[2*k]=a[2*k]-re;
+			b[2*k+1]=a[2*k+1]-im;
+			a[2*k]+=re;
+			a[2*k+1]+=im;
+		}
+	}
+}
+#pragma GCC pop_options
 
-					}
-				}
-			}
+typedef void (*SplitKernel)(const void*,float**,long int);
+typedef void (*BandshapeKernel)(const float*,float*,float*,long int);
+
+/*******************************************************************
+*FUNCTION: SplitKernel selectSplitKernel(int noOfChannels,int sampleSizeBytes,char doPolarMode)
+*Returns the specialised kernel for splitting raw data of the given 
+*configuration, or NULL if there is none.
+*******************************************************************/
+template<int NCHANNELS>
+SplitKernel selectSplitKernelForChannels(int sampleSizeBytes,char doPolarMode)
+{
+	if(sampleSizeBytes==1)
+	{
+		if(doPolarMode)
+			return splitPolarKernel<NCHANNELS,char>;
+		return splitKernel<NCHANNELS,unsigned char>;
+	}
+	if(sampleSizeBytes==2)
+	{
+		if(doPolarMode)
+			return splitPolarKernel<NCHANNELS,short>;
+		return splitKernel<NCHANNELS,unsigned short>;
+	}
+	return NULL;
+}
+SplitKernel selectSplitKernel(int noOfChannels,int sampleSizeBytes,char doPolarMode)
+{
+	switch(noOfChannels)
+	{
+		case 1024:	return selectSplitKernelForChannels<1024>(sampleSizeBytes,doPolarMode);
+		case 2048:	return selectSplitKernelForChannels<2048>(sampleSizeBytes,doPolarMode);
+		case 4096:	return selectSplitKernelForChannels<4096>(sampleSizeBytes,doPolarMode);
+		case 8192:	return selectSplitKernelForChannels<8192>(sampleSizeBytes,doPolarMode);
+		case 16384:	return selectSplitKernelForChannels<16384>(sampleSizeBytes,doPolarMode);
+	}
+	return NULL;
+}
+/*******************************************************************
+*FUNCTION: BandshapeKernel selectBandshapeKernel(int noOfChannels)
+*Returns the specialised bandshape kernel for the given number of 
+*channels, or NULL if there is none.
+*******************************************************************/
+BandshapeKernel selectBandshapeKernel(int noOfChannels)
+{
+	switch(noOfChannels)
+	{
+		case 1024:	return bandshapeKernel<1024>;
+		case 2048:	return bandshapeKernel<2048>;
+		case 4096:	return bandshapeKernel<4096>;
+		case 8192:	return bandshapeKernel<8192>;
+		case 16384:	return bandshapeKernel<16384>;
+	}
+	return NULL;
+}
+/*******************************************************************
+*FUNCTION: int liveChannelRuns(const char* freqFlags,int nChan,int* runs)
+*const char* freqFlags	: channel flags (1-> flagged) of nChan channels
+*int* runs		: output, at least nChan+1 elements
+*Compacts the unflagged channels into runs of consecutive channels.
+*Run k covers channels runs[2k] to runs[2k+1]-1. Returns the number 
+*of runs. Kernels iterate over the runs (and the flagged gaps between
+*them) instead of testing the flag of every channel for every sample.
+*******************************************************************/
+int liveChannelRuns(const char* freqFlags,int nChan,int* runs)
+{
+	int nRuns=0;
+	for(int j=0;j<nChan;)
+	{
+		while(j<nChan && freqFlags[j])
+			j++;
+		if(j==nChan)
 			break;
-		case 2:		
-			if(!info.doPolarMode)
+		runs[2*nRuns]=j;
+		while(j<nChan && !freqFlags[j])
+			j++;
+		runs[2*nRuns+1]=j;
+		nRuns++;
+	}
+	return nRuns;
+}
+/*******************************************************************
+*FUNCTION: float flagOccupancy(const char* timeFlags,long int length,const char* freqFlags,int nChan)
+*Returns the fraction of the samples of a block that are flagged by 
+*either the time flags or the channel flags. Flags of individual 
+*samples are not counted, so this costs only length+nChan reads.
+*******************************************************************/
+float flagOccupancy(const char* timeFlags,long int length,const char* freqFlags,int nChan)
+{
+	long int liveSamples=0;
+	int liveChannels=0;
+	for(long int i=0;i<length;i++)
+		liveSamples+=!timeFlags[i];
+	for(int j=0;j<nChan;j++)
+		liveChannels+=!freqFlags[j];
+	return 1.0-((double)liveSamples*liveChannels)/((double)length*nChan);
+}
+/*******************************************************************
+*FUNCTION: void foldingBins(Information& info,double lagMs,double timeMs,double initPhase,long int n,int* bins)
+*double lagMs		:Time of the first folded sample after the start 
+*			 of observation (ms)
+*double timeMs		:Time of the first of the n samples after the first
+*			 folded sample (ms)
+*double initPhase	:Polyco phase of the first folded sample, which 
+*			 goes to bin 0
+*int* bins		:output, profile bin of each of the n samples
+*The polyco is expanded every maxSegment samples and at the end of 
+*every polyco set, the phase in between is quadratic.
+*******************************************************************/
+void foldingBins(Information& info,double lagMs,double timeMs,double initPhase,long int n,int* bins)
+{
+	const long int maxSegment=4096;	//About 0.3 s at 81.92 us sampling, the cubic term is then far below a bin
+	double samplingIntervalMs=info.samplingInterval*1000.0;
+	double intPart;
+	if(info.doFixedPeriodFolding)
+	{
+		double phase=modf(timeMs/info.periodInMs,&intPart)+info.profileOffset;
+		quadraticBins(phase,samplingIntervalMs/info.periodInMs,0.0,n,info.periodInSamples,bins);
+		return;
+	}
+	for(long int k=0;k<n;)
+	{
+		double t=timeMs+k*samplingIntervalMs;
+		long double phase;
+		double slope,curvature;
+		double rowEndMs=info.expandPolyco(lagMs+t,phase,slope,curvature)-lagMs;
+		long int m=(long int)floor((rowEndMs-t)/samplingIntervalMs)+1;
+		if(m<1)
+			m=1;
+		if(m>maxSegment)
+			m=maxSegment;
+		if(m>n-k)
+			m=n-k;
+		phase-=initPhase;
+		phase-=floorl(phase);
+		quadraticBins((double)phase+info.profileOffset,slope*samplingIntervalMs,curvature*samplingIntervalMs*samplingIntervalMs,m,info.periodInSamples,bins+k);
+		k+=m;
+	}
+}
+/*******************************************************************
+*FUNCTION: void walkChannelRows<Target>(Information& info,const float* rawData,const char* timeFlags,const char* freqFlags,const char* sampleFlags,long int firstSample,long int nSamples,int tileLength,char doFlaggedRows,Target& target)
+*const char* sampleFlags	:Individual samples marked 1 are flagged 
+*				 (NULL if none are)
+*char doFlaggedRows		:1-> flagged rows are passed to target too
+*Takes a range of time samples of the 2-D data (the selected channels)
+*through tiles of tileLength time samples. Each tile is transposed to 
+*channel major order and every channel row of it is handed to 
+*target.addRow(j,row,weight,n,first): n samples of channel j (from 
+*startChannel) starting at time sample first, with weight 1 for the 
+*samples to use and 0 for flagged ones. weight is NULL for a flagged 
+*channel and for a tile in which all time samples are flagged.
+*Used by the dedispersion and the folding of the 2-D data, whose 
+*kernels add whole rows at their shifted positions.
+*******************************************************************/
+template<typename Target>
+void walkChannelRows(Information& info,const float* rawData,const char* timeFlags,const char* freqFlags,const char* sampleFlags,long int firstSample,long int nSamples,int tileLength,char doFlaggedRows,Target& target)
+{
+	int startChannel=info.startChannel;
+	int totalChan=info.noOfChannels;
+	int nChan=info.stopChannel-startChannel;
+	float *tile=new float[(long int)tileLength*nChan];
+	char *tileSampleFlags=(sampleFlags!=NULL)?new char[(long int)tileLength*nChan]:NULL;
+	float *timeWeight=new float[tileLength];
+	float *weight=new float[tileLength];
+	for(long int first=firstSample;first<firstSample+nSamples;first+=tileLength)
+	{
+		int n=(firstSample+nSamples-first<tileLength)?firstSample+nSamples-first:tileLength;
+		char isTileFlagged=1;
+		for(int i=0;i<n;i++)
+		{
+			timeWeight[i]=timeFlags[first+i]?0.0f:1.0f;
+			isTileFlagged&=(timeFlags[first+i]!=0);
+		}
+		if(isTileFlagged && !doFlaggedRows)
+			continue;
+		transposeTile(rawData+first*totalChan+startChannel,totalChan,n,nChan,tile,n);
+		if(sampleFlags!=NULL && !isTileFlagged)
+			transposeTile(sampleFlags+first*totalChan+startChannel,totalChan,n,nChan,tileSampleFlags,n);
+		const float *row=tile;
+		for(int j=0;j<nChan;j++,row+=n)
+		{
+			if(freqFlags[j] || isTileFlagged)
 			{
-				unsigned short int* ptrRawData=rawData;	
-				for(int j=0;j<blockLength;j++)		//Refer to the GMRT polarization data format in Function description.
-				{		
-					for(int i=0;i<info.noOfChannels;i++,ptrRawData++,ptrSplittedRawData[0]++)
-					{
-							*(ptrSplittedRawData[0])=(*ptrRawData);
-					}
-				}
+				if(doFlaggedRows)
+					target.addRow(j,row,(const float*)NULL,n,first);
 			}
-			else
+			else if(sampleFlags!=NULL)
 			{
-				short int* ptrRawData=rawDataPolar;	
-				for(int j=0;j<blockLength;j++)		//Refer to the GMRT polarization data format in Function description.
-				{		
-					for(int i=0;i<info.noOfChannels;i++)
-					{
-							*(ptrSplittedRawData[0]++)=(*ptrRawData++);
-							*(ptrSplittedRawData[1]++)=(*ptrRawData++);
-							*(ptrSplittedRawData[2]++)=(*ptrRawData++);
-							*(ptrSplittedRawData[3]++)=(*ptrRawData++);
-
-					}
-				}
-			}
-			break;
-		case 4:					
-			for(int j=0;j<blockLength;j++)		//Refer to the GMRT polarization data format in Function description.
-			{		
-				for(int i=0;i<info.noOfChannels;i++)
-				{
-					for(int k=0;k<info.noOfPol;k++,ptrRawDataFloat++)
-					{				
-						(*ptrSplittedRawData[k])=(*ptrRawDataFloat);	
-						ptrSplittedRawData[k]++;
-					}	
-				}
+				sampleWeights(timeWeight,&tileSampleFlags[(long int)j*n],n,weight);
+				target.addRow(j,row,weight,n,first);
 			}
-			break;
+			else
+				target.addRow(j,row,timeWeight,n,first);
+		}
+	}
+	delete[] tile;
+	delete[] tileSampleFlags;
+	delete[] timeWeight;
+	delete[] weight;
+}
+/*******************************************************************
+*FUNCTION: void normalizeDedispersedSeries(float* series,const int* count,float* seriesUnfiltered,const int* countUnfiltered,long int n,int nChan,char* dedispFlags)
+*float* series		:Filtered dedispersed sums, averaged in place
+*float* seriesUnfiltered	:Unfiltered dedispersed sums, averaged in place
+*int nChan		:Number of selected channels
+*char* dedispFlags	:Set to 1 for the samples that are not folded
+*Averages the dedispersed sums over the number of samples added to 
+*them. Samples with 40% of the channels or less are flagged.
+*******************************************************************/
+void normalizeDedispersedSeries(float* series,const int* count,float* seriesUnfiltered,const int* countUnfiltered,long int n,int nChan,char* dedispFlags)
+{
+	for(long int i=0;i<n;i++)
+	{
+		if(count[i]==0)
+		{
+			dedispFlags[i]=1;
+			series[i]=0;
+			continue;
+		}
+		series[i]/=count[i];
+		dedispFlags[i]=(count[i]<=0.4*nChan);
+		if(countUnfiltered[i]!=0)
+			seriesUnfiltered[i]/=countUnfiltered[i];
+	}
+}
+/*******************************************************************
+*FUNCTION: void foldDedispersedSeries(const float* series,const float* seriesUnfiltered,const char* dedispFlags,const int* bins,long int n,float* foldedProfile,int* countProfile,float* foldedProfileUnfiltered,int* countProfileUnfiltered)
+*const int* bins	:Profile bin of each sample (see foldingBins())
+*Adds n averaged dedispersed samples that are not marked in 
+*dedispFlags to the folded profiles.
+*******************************************************************/
+void foldDedispersedSeries(const float* series,const float* seriesUnfiltered,const char* dedispFlags,const int* bins,long int n,float* foldedProfile,int* countProfile,float* foldedProfileUnfiltered,int* countProfileUnfiltered)
+{
+	for(long int i=0;i<n;i++)
+	{
+		if(dedispFlags[i])
+			continue;
+		int index=bins[i];
+		foldedProfile[index]+=series[i];
+		foldedProfileUnfiltered[index]+=seriesUnfiltered[i];
+		countProfileUnfiltered[index]++;
+		countProfile[index]++;
+	}
+}
+/*******************************************************************
+*FUNCTION: float* twiddleTable(long int n)
+*Returns the n/2 twiddle factors exp(-2 pi i k/n) of an n point FFT as
+*interleaved complex floats, computed in double. The caller frees it.
+*******************************************************************/
+float* twiddleTable(long int n)
+{
+	float* twiddle=new float[n];
+	for(long int k=0;k<n/2;k++)
+	{
+		twiddle[2*k]=cos(2.0*M_PI*k/n);
+		twiddle[2*k+1]=-sin(2.0*M_PI*k/n);
+	}
+	return twiddle;
+}
+/*******************************************************************
+*FUNCTION: void complexFFT(float* data,long int n,const float* twiddle)
+*In place forward FFT of n (a power of 2) interleaved complex points,
+*iterative radix-2 with the twiddle factors of twiddleTable(n).
+*******************************************************************/
+void complexFFT(float* data,long int n,const float* twiddle)
+{
+	for(long int i=1,j=0;i<n;i++)
+	{
+		long int bit=n>>1;
+		for(;j&bit;bit>>=1)
+			j^=bit;
+		j^=bit;
+		if(i<j)
+		{
+			swap(data[2*i],data[2*j]);
+			swap(data[2*i+1],data[2*j+1]);
+		}
+	}
+	for(long int half=1;half<n;half*=2)
+		butterflyPass(data,n,half,twiddle,n/(2*half));
+}
+
+
+/*******************************************************************
+*CLASS:	AquireData
+*Contains functions to read data either from a file or SHM (in case 
+*of real time operation). It also has a functions to split read data
+*into four polarizations. 
+*******************************************************************/
+class AquireData
+{
+	public:
+	//Static variables:	
+	static	Information	info;
+	static long int		eof;  			//Length of file in bytes
+	static double		totalError;		//Cumulative uncorrected difference between true window width and required width
+	static long int		curPos;			//Total number of samples read.
+	//Static SHM Variables:
+	static DasHdrType*	dataHdr;
+	static DataBufType*	dataBuffer;
+	static DataTabType*	dataTab;
+	static unsigned short*  zeros;
+	static int		recNum;
+	static int		currentReadBlock;
+	static int		remainingData;
+	static timeval*		startTimeStamp;
+	static float		buffSizeSec;
+	static int		nbuff;
+	static SplitKernel	splitKernel;		//Specialised kernel for splitRawData (NULL -> generic code)
+	//Variables:
+	unsigned char*		rawDataChar;		//1-byte integer read data is stored here
+	char*			rawDataCharPolar;	//1-byte integer read data is stored here
+	unsigned short*		rawData;		//2-byte integer read data is stored here
+	short*			rawDataPolar;		//2-byte integer read data is stored here
+	float*			rawDataFloat;		//4-byte floating point read data
+	float**			splittedRawData;	//Pointers to 4 polarization data in case of polar modeIndex.
+							//In normal run it just has one pointer to rawData.
+	char			hasReachedEof;		//Flag to let the program know when end of file has been reached
+	long int		blockLength;		//Length(in samples) of the current block
+	int			blockIndex;		//Current window number. (starting from 0)
+	char*			headerInfo;
+	int			nBuffTaken;
+	//Functions:
+	
+	AquireData(Information _info);			/*Constructor for first time intialization, the static variables 
+							 *are initialized here.*/
+	AquireData(int _blockIndex);			//Constructor to intialize non-static me
+			
+	~AquireData();
+	void readData();				/*This method is a wrapper that checks if the data is being read
+							 *from file or from SHM and according calls the	appropiate
+							 *function.*/
+	void readDataFromFile();			//Reads from file
+	void initializeSHM();				//Attaches to SHM
+	int readFromSHM();				//Reads from SHM
+	void splitRawData();
+	void allocateSplittedRawData();			//Allocates splittedRawData
+	void splitRawData(long int firstSample,long int nSamples);	//Splits a range of time samples
+};
+//Declaring static variables:
+Information 	AquireData::info;
+long int 	AquireData::eof;
+DasHdrType*	AquireData::dataHdr;
+DataBufType*	AquireData::dataBuffer;
+DataTabType*	AquireData::dataTab;
+unsigned short* AquireData::zeros;
+int		AquireData::recNum=0;
+int		AquireData::remainingData=0;
+int		AquireData::currentReadBlock=0;
+long int	AquireData::curPos=0;
+double		AquireData::totalError=0.0;
+float		AquireData::buffSizeSec;
+int		AquireData::nbuff;		
+SplitKernel	AquireData::splitKernel;
+struct timeval*	AquireData::startTimeStamp;
+/*******************************************************************
+*CONSTRUCTOR: AquireData::AquireData(Information _info)
+*Information _info : contains all parameters.
+*Invoked on first creation of an object of this type.
+********************************************************************/
+AquireData::AquireData(Information _info)
+{
+	 info=_info;
+	 splitKernel=selectSplitKernel(info.noOfChannels,info.sampleSizeBytes,info.doPolarMode);
+	 blockIndex=0;	 
+	 hasReachedEof=0;
+	 totalError=0.0;
+	 remainingData=0;
+	 //finding length of data file or initializing SHM according to the mode of operation
+	 if(info.doReadFromFile)
+	 {
+	 	ifstream datafile;
+	 	datafile.open(info.filepath,ios::binary);
+		if(!datafile.is_open())
+  		{
+    			cout<<"Raw data file not found!"<<endl;
+    			exit(1);
+ 		}
+	 	datafile.seekg(0,ios::end);
+	 	eof=datafile.tellg();
+	 	datafile.close();
+		if(eof==0)
+		{
+			cout<<"DATA FILE EMPTY"<<endl;
+			exit(1);
+		}
+	 }
+	// else
+	//	initializeSHM();
+	
+	 
+}
+/*******************************************************************
+*CONSTRUCTOR: AquireData::AquireData(int _blockIndex)
+*int _blockIndex : current window number.
+********************************************************************/
+AquireData::AquireData(int _blockIndex)
+{
+	blockIndex=_blockIndex; 
+	hasReachedEof=0;
+	rawData=NULL;
+	rawDataFloat=NULL;
+	rawDataPolar=NULL;
+	splittedRawData=NULL;
+	nBuffTaken=0;
+	if(info.isInline)
+		headerInfo=new char[4096*nbuff];
+	headerInfo=NULL;
+}
+/*******************************************************************
+*DESTRUCTOR: AquireData::~AquireData()
+*Free all memory
+********************************************************************/
+AquireData::~AquireData()
+{	
+	switch(info.sampleSizeBytes)
+	{
+		case 1:
+			if(!info.doPolarMode)
+			{
+				delete[] rawDataChar;
+			}
+			else
+				delete[] rawDataCharPolar;
+			break;
+		case 2:
+			if(!info.doPolarMode)
+				delete[] rawData;
+			else
+				delete[] rawDataPolar;
+			break;
+		case 4:		
+			delete[] rawDataFloat;
+			break;
+	}
+	
+	//delete[] splittedRawData;
+	
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::readData()
+*Wrapper to decide which method to call to aquire data
+*******************************************************************/
+void AquireData::readData()
+{
+	double er=info.blockSizeSec/info.samplingInterval;
+	er=er-(long)er;
+	totalError+=er;	
+	blockLength = info.blockSizeSamples;	
+  	if(!info.isInline && totalError>=1.0)
+  	{
+  		blockLength++;
+  		totalError--;
+  	}	
+	if(info.doReadFromFile)
+		readDataFromFile();
+	else
+		readFromSHM();
+}
+/*******************************************************************
+*FUNCTION: void AquireData::initializeSHM()
+*Initializes collect_psr shared memory of GSB/GWB
+*******************************************************************/
+void AquireData::initializeSHM()
+{
+  	int iddataHdr,idDataBuffer;
+	switch(info.shmID)
+	{
+		case 1: //standard correlator shm
+			iddataHdr = shmget(DAS_H_KEY,sizeof(DasHdrType),SHM_RDONLY);
+			idDataBuffer = shmget(DAS_D_KEY,sizeof(DataBufType),SHM_RDONLY);
+		break;
+		case 2: //file shm
+			iddataHdr = shmget(DAS_H_KEY_GPTOOL,sizeof(DasHdrType),SHM_RDONLY);
+			idDataBuffer = shmget(DAS_D_KEY_GPTOOL,sizeof(DataBufType),SHM_RDONLY);
+		break;
+		case 3: //inline gptool shm
+			iddataHdr = shmget(DAS_H_KEY_GPTOOL_INLINE,sizeof(DasHdrType),SHM_RDONLY);
+			idDataBuffer = shmget(DAS_D_KEY_GPTOOL_INLINE,sizeof(DataBufType),SHM_RDONLY);
+		break;
+	}
+	
+	cout<<"iddataHdr="<<iddataHdr<<endl<<"idDataBuffer="<<idDataBuffer<<endl;
+	
+	if(iddataHdr < 0 || iddataHdr < 0)
+	{
+		exit(1);
+	}
+	dataHdr = (DasHdrType*)shmat(iddataHdr,0,SHM_RDONLY);
+  	dataBuffer = (DataBufType*)shmat(idDataBuffer,0,SHM_RDONLY);
+	if((dataBuffer)==(DataBufType*)-1)
+	{
+		cout<<"Cannot attach to shared memory!"<<endl;
+		exit(1);
+	}
+	cout<<"Attached to shared memory:"<<dataHdr<<","<<dataBuffer<<endl;
+	dataTab = dataBuffer-> dtab;
+	cout<<"Max no of blocks="<<dataBuffer->maxblocks<<endl;
+	zeros=new unsigned short[dataBuffer->blocksize-4096];
+	if(info.isInline)
+	{	
+		buffSizeSec=(info.samplingInterval*(dataBuffer->blocksize-4096)/(info.sampleSizeBytes*info.noOfChannels));
+		nbuff=(int)floor(info.blockSizeSec/buffSizeSec);
+		info.blockSizeSec=nbuff*buffSizeSec;
+		info.blockSizeSamples=(int)round(info.blockSizeSec/info.samplingInterval);
+
+	}
+	 /*   find a block, two blocks before the current block of the shm for reading data */
+	//if(dataBuffer->cur_rec > (dataBuffer->maxblocks)/2)
+	recNum = (dataBuffer->cur_rec+MaxDataBuf)%MaxDataBuf;
+	currentReadBlock = dataTab[recNum].seqnum;
+
+	int timeOff=sizeof(double)+sizeof(int)+sizeof(int)+sizeof(int);
+	int blk_nano_off=timeOff+sizeof(struct timeval)+sizeof(int);
+	startTimeStamp=(struct timeval*)(dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize)+timeOff);
+	
+	int usec=0;
+  	double nano_usec;
+	struct tm *local_t = localtime(&startTimeStamp->tv_sec);
+//  usec = 1000000*(timestamp_gps->tv_usec);
+	double *blk_nano = (double *)(dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize) + blk_nano_off);
+  	usec = (startTimeStamp->tv_usec);
+ 	nano_usec = local_t->tm_sec; // putting int value in double:CAUTION
+  	nano_usec += (startTimeStamp->tv_usec)/1e6;
+  	nano_usec += (*blk_nano)/1e6;
+	FILE* FATM=fopen("timestamp.gpt","w");
+        char time_string[40];
+        fprintf(FATM,"#Start time and date\n");
+        fprintf(FATM,"IST Time: %02d:%02d:%012.9lf\n",local_t->tm_hour,local_t->tm_min, nano_usec);
+        strftime (time_string, sizeof (time_string), "%d:%m:%Y", local_t);
+        fprintf(FATM,"Date: %s\n",time_string);
+        fclose(FATM);
+
+}
+double timeWaitTime=0.0; //Benchmark
+/*******************************************************************
+*FUNCTION: AquireData::readFromSHM()
+*Reads from collect_psr shared memory of GSB/GWB
+*******************************************************************/
+int AquireData::readFromSHM()
+{  	
+	int DataOff=4096;
+  	int bufferBlockLength=(dataBuffer->blocksize-DataOff)/info.sampleSizeBytes;  		
+	long samplesToTake=info.noOfChannels*info.noOfPol*blockLength* info.sampleSizeBytes;	
+	rawData=new unsigned  short int[blockLength*info.noOfPol*info.noOfChannels];	
+	long int fetched=0;
+	ofstream meanFile;
+	meanFile.open("realTimeWarning.gpt",ios::app);
+	ofstream recordFile;
+	recordFile.open("blockLossRecord.gpt",ios::app);
+	while(fetched<samplesToTake)
+	{
+  		timeWaitTime+=omp_get_wtime();
+		int flag=0;
+		while((dataHdr->status == DAS_START) && (dataTab[recNum].flag &BufReady) == 0)
+		{
+			usleep(2000);
+			if(flag==0)
+			{
+				cout<<"Waiting"<<endl;
+				flag=1;
+			}
+		}
+		if(flag==1)
+			cout<<"Ready"<<endl;
+		timeWaitTime-=omp_get_wtime();
+		if(dataHdr->status != DAS_START)
+		{
+			if ((dataTab[recNum].flag & BufReady) == 0)
+			{
+				cout<<"DAS not in START mode!!"<<endl;
+				return -1;
+			}
+		}
+		currentReadBlock = dataTab[recNum].seqnum;
+		if(!info.isInline)
+		{			
+			cout<<endl<<"recNum "<<recNum<<endl;
+			cout<<"dataBuffer->cur_rec "<<dataBuffer->cur_rec<<endl;
+			cout<<"MaxDataBuf "<<MaxDataBuf<<endl;
+			cout<<"dataBuffer->cur_block "<<dataBuffer->cur_block<<endl;
+			cout<<"currentReadBlock "<<currentReadBlock<<endl;
+			cout<<"dataBuffer->maxblocks "<<dataBuffer->maxblocks<<endl<<endl;
+		}
+		//memcpy(&currentReadBlock, &dataTab[recNum].seqnum, sizeof(int));
+		//dataBuffer->maxblocks-1
+		if(dataBuffer->cur_block - currentReadBlock >=dataBuffer->maxblocks-1)
+		{
+			meanFile<<"Lag in block blockIndex="<<blockIndex<<endl;
+			meanFile<<"recNum = "<<recNum<<", Reading Sequence: "<<currentReadBlock<<", Collect's Sequence: "<<(dataBuffer->cur_block-1)<<endl;
+			cout<<"Processing lagged behind..."<<endl;
+			//recordFile<<blockIndex
+			/*while(dataBuffer->cur_block - currentReadBlock >=dataBuffer->maxblocks-1)
+			{
+				if(samplesToTake-fetched>dataBuffer->blocksize-DataOff-remainingData)
+				{
+					memcpy(rawData+fetched/sizeof(unsigned short), zeros+remainingData, dataBuffer->blocksize-DataOff-remainingData);
+  				fetched+=(dataBuffer->blocksize-DataOff-remainingData);
+  				recNum=(recNum+1)%MaxDataBuf;
+				remainingData=0;
+  				}
+  				else
+  				{
+					memcpy(rawData+fetched/sizeof(unsigned short), zeros+remainingData,samplesToTake-fetched);				
+					remainingData=(samplesToTake-fetched);
+					curPos+=samplesToTake;
+					meanFile.close();
+  					return -1;
+  				}
+				currentReadBlock = dataTab[(recNum)].seqnum;
+			}*/
+			cout<<"recNum = "<<recNum<<", Reading Sequence: "<<currentReadBlock<<", Collect's Sequence: "<<(dataBuffer->cur_block-1)<<" blockIndex = "<<blockIndex<<"\nRealiging...\n";
+			recNum = (dataBuffer->cur_rec-1-2+MaxDataBuf)%MaxDataBuf;
+			currentReadBlock = dataTab[(recNum)].seqnum;
+		}
+		//cout<<"recNum = "<<recNum<<", Reading Sequence: "<<currentReadBlock<<", Collect's Sequence: "<<dataBuffer->cur_block-1<<endl;
+		//cout<<"Blocksize="<<dataBuffer->blocksize<<endl;
+		if(samplesToTake-fetched>dataBuffer->blocksize-DataOff-remainingData)
+		{	
+			if(info.isInline)
+			{
+				memcpy(headerInfo+nBuffTaken*DataOff, dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize), DataOff);
+				nBuffTaken++;
+			}
+  			memcpy(rawData+fetched/sizeof(short), dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize)+DataOff+remainingData, dataBuffer->blocksize-DataOff-remainingData);
+  			fetched+=(dataBuffer->blocksize-DataOff-remainingData);
+  			recNum=(recNum+1)%MaxDataBuf;
+			remainingData=0;
+  		}
+  		else
+  		{
+  			memcpy(rawData+fetched/sizeof(short), dataBuffer->buf+dataTab[recNum].rec*(dataBuffer->blocksize)+DataOff+remainingData, samplesToTake-fetched);
+			remainingData=(samplesToTake-fetched);
+  			break;
+  		}
+  	}
+  	curPos+=samplesToTake;
+	meanFile.close();
+	return 1;
+}
+/*******************************************************************
+*FUNCTION: void AquireData::readDataFromFile()
+*In offline mode reads raw data from a file
+*******************************************************************/
+void AquireData::readDataFromFile()
+{
+	int 	 c,i;
+	long int blockSizeBytes= info.noOfChannels*info.noOfPol* blockLength* info.sampleSizeBytes; //Number of bytes to read in eac block
+							//Number of bytes that have already been read
+	
+	ifstream datafile;
+	datafile.open(info.filepath,ios::binary);	
+	datafile.seekg(curPos,ios::beg);
+	//logic to handle reading last block
+	if(curPos+blockSizeBytes> eof)
+	{
+		blockSizeBytes=eof-curPos;
+		blockLength=blockSizeBytes/(info.sampleSizeBytes*info.noOfChannels*info.noOfPol);		//The number of time samples 
+		hasReachedEof=1;
+	}
+	/*******************************************************************
+	*Handles different data types. GMRT data is mostly of type short while 
+	*certain processed data maybe floating point.
+	*******************************************************************/
+	switch(info.sampleSizeBytes)
+	{
+		case 1:
+			if(!info.doPolarMode)
+			{
+				rawDataChar=new unsigned char[blockSizeBytes/info.sampleSizeBytes];
+				datafile.read((char*)rawDataChar,blockSizeBytes);
+			}	
+			else
+			{
+				rawDataCharPolar=new char[blockSizeBytes/info.sampleSizeBytes];
+				datafile.read((char*)rawDataCharPolar,blockSizeBytes);
+			
+			}
+			break;
+		case 2:
+			if(!info.doPolarMode)
+			{
+				rawData=new unsigned short[blockSizeBytes/info.sampleSizeBytes];
+				datafile.read((char*)rawData,blockSizeBytes);			
+			}
+			else
+			{
+				rawDataPolar=new short[blockSizeBytes/info.sampleSizeBytes];
+				datafile.read((char*)rawDataPolar,blockSizeBytes);	
+			}
+
+			break;
+		case 4:
+			rawDataFloat=new float[blockSizeBytes/info.sampleSizeBytes];
+			datafile.read((char*)rawDataFloat,blockSizeBytes);
+			break;
+	}
+	datafile.close();		
+	curPos+=blockSizeBytes;
+}
+float u16tofloat(short x)
+{
+    union { float f; int i; } u; u.f = 0.00f; u.i |= x;
+    return u.f ; 
+}
+/**********************************************************************
+*FUNCTION: void AquireData::splitRawData()
+*If on polar mode, splitting of raw data into four polarization channels
+*is done here. GMRT polarization data is read out in the following fomat:
+T1_C1_P T1_C1_Q T1_C1_R T1_C1_S T1_C2_P T1_C2_Q T1_C2_R T1_C2_S...
+T1_CN_S T2_C1_P ...........TN_CN_S
+where P,Q,R,S are the four polarizations, Cn denotes the nth channel 
+and Tn the nth time sample. So T15_C25_Q means the Q-polarization data
+of channel 25 of the 15th time sample.
+**********************************************************************/
+void AquireData::splitRawData()
+{
+	allocateSplittedRawData();
+	splitRawData(0,blockLength);
+}
+/**********************************************************************
+*FUNCTION: void AquireData::allocateSplittedRawData()
+*Allocates the float arrays filled by splitRawData(firstSample,nSamples)
+**********************************************************************/
+void AquireData::allocateSplittedRawData()
+{
+	splittedRawData=new float*[info.noOfPol];
+	long int length=blockLength*info.noOfChannels;	
+	for(int k=0;k<info.noOfPol;k++)
+		splittedRawData[k]=new float[length];
+}
+/**********************************************************************
+*FUNCTION: void AquireData::splitRawData(long int firstSample,long int nSamples)
+*long int firstSample	: first time sample to split
+*long int nSamples	: number of time samples to split
+*Splits and converts a range of time samples of the raw data. This lets
+*the conversion be done tile by tile (see Runtime::floatConversionTasks)
+**********************************************************************/
+void AquireData::splitRawData(long int firstSample,long int nSamples)
+{
+	float **ptrSplittedRawData=new float*[info.noOfPol];
+	long int offset=firstSample*info.noOfChannels;		//offset of the first sample in each polarization
+	for(int k=0;k<info.noOfPol;k++)
+		ptrSplittedRawData[k]=splittedRawData[k]+offset;
+	offset*=info.noOfPol;					//offset of the first sample in the raw data
+	/*******************************************************************
+	*Handles different data types. GMRT data is mostly of type short while 
+	*certain processed data maybe floating point.
+	*******************************************************************/
+	
+	if(splitKernel!=NULL)
+	{
+		const void* input;
+		if(info.sampleSizeBytes==1)
+			input=(info.doPolarMode)?(const void*)rawDataCharPolar:(const void*)rawDataChar;
+		else
+			input=(info.doPolarMode)?(const void*)rawDataPolar:(const void*)rawData;
+		splitKernel((const char*)input+offset*info.sampleSizeBytes,ptrSplittedRawData,nSamples);
+		delete[] ptrSplittedRawData;
+		return;
+	}
+	float* ptrRawDataFloat=rawDataFloat+offset;
+	switch(info.sampleSizeBytes)
+	{
+		case 1:		
+			if(!info.doPolarMode)
+			{
+				unsigned char* ptrRawData=rawDataChar+offset;	
+				for(long int j=0;j<nSamples;j++)		//Refer to the GMRT polarization data format in Function description.
+				{		
+					for(int i=0;i<info.noOfChannels;i++,ptrRawData++,ptrSplittedRawData[0]++)
+					{
+							*(ptrSplittedRawData[0])=(*ptrRawData);
+					}
+				}
+			}
+			else
+			{
+				char* ptrRawData=rawDataCharPolar+offset;	
+				for(long int j=0;j<nSamples;j++)		//Refer to the GMRT polarization data format in Function description.
+				{		
+					for(int i=0;i<info.noOfChannels;i++)
+					{
+							*(ptrSplittedRawData[0]++)=(*ptrRawData++);
+							*(ptrSplittedRawData[1]++)=(*ptrRawData++);
+							*(ptrSplittedRawData[2]++)=(*ptrRawData++);
+							*(ptrSplittedRawData[3]++)=(*ptrRawData++);
+
+					}
+				}
+			}
+			break;
+		case 2:		
+			if(!info.doPolarMode)
+			{
+				unsigned short int* ptrRawData=rawData+offset;	
+				for(long int j=0;j<nSamples;j++)		//Refer to the GMRT polarization data format in Function description.
+				{		
+					for(int i=0;i<info.noOfChannels;i++,ptrRawData++,ptrSplittedRawData[0]++)
+					{
+							*(ptrSplittedRawData[0])=(*ptrRawData);
+					}
+				}
+			}
+			else
+			{
+				short int* ptrRawData=rawDataPolar+offset;	
+				for(long int j=0;j<nSamples;j++)		//Refer to the GMRT polarization data format in Function description.
+				{		
+					for(int i=0;i<info.noOfChannels;i++)
+					{
+							*(ptrSplittedRawData[0]++)=(*ptrRawData++);
+							*(ptrSplittedRawData[1]++)=(*ptrRawData++);
+							*(ptrSplittedRawData[2]++)=(*ptrRawData++);
+							*(ptrSplittedRawData[3]++)=(*ptrRawData++);
+
+					}
+				}
+			}
+			break;
+		case 4:					
+			for(long int j=0;j<nSamples;j++)		//Refer to the GMRT polarization data format in Function description.
+			{		
+				for(int i=0;i<info.noOfChannels;i++)
+				{
+					for(int k=0;k<info.noOfPol;k++,ptrRawDataFloat++)
+					{				
+						(*ptrSplittedRawData[k])=(*ptrRawDataFloat);	
+						ptrSplittedRawData[k]++;
+					}	
+				}
+			}
+			break;
+	}
+	delete[] ptrSplittedRawData;
+}
+//End of AquireData implementation.
+
+/*******************************************************************
+*CLASS: BasicAnalysis
+*Performs basic operations like bandshape and zeroDM time series 
+*computation for a particular window and a particular polarization.
+*These quantities are then used by objects of RFIFiltering class 
+*to find and filter Radio Frequency Interference (RFI).
+*******************************************************************/
+class BasicAnalysis
+{
+	public:
+	//static variables:
+	
+	static	Information	info;			//contains all input parameters
+	static double**		smoothSumBandshape;	//Cumulative smooth bandshape for each polarization
+	static double** 	sumBandshape;		//Cumulative bandshapes for each polaization
+	static double**		squareBandshape;	//Cumulative square of bandshape for each polarization
+	static long long int** 	countBandshape;		//Number of sample that goes into each frequency bin (Cumulative) for each polaization
+	static float**		externalBandshape; 	//Externally loaded bandshape
+	static BandshapeKernel	bandshapeKernel;	//Specialised kernel for computeBandshape (NULL -> generic code)
+	long int		blockLength;	
+	
+	//variables:
+	float 			cumBandshapeScale;		//Used to scale down the cumulative bandshape to avoid overflow issues
+	int			polarIndex;			//Index of polarization to process.
+	float			*rawData;			//The 2D time-frequency data 	
+	short int	*filteredRawData;		//The Filtered 2D time-frequency data 
+	char			*sampleFlags;			//Flags of individual time-frequency samples from spectral kurtosis and flagSumThreshold() (NULL if not used)
+	float			*zeroDM;			//Time series obtained by collapsing all frequency channels (Without dedispersion)
+	float			*zeroDMUnfiltered;		//Time series obtained by collapsing all frequency channels (Without dedispersion), without filtering
+	float			*bandshape;			//Mean bandshape obtained by collapsing all time samples.
+	float			*meanToRmsBandshape;		//Mean to rms computed for each channel. (rms of time series for that channel)
+	float			*smoothBandshape;		//smoothened bandshape obtained by moving mean or median
+	float			*normalizedBandshape;		//bandshape normalized using smoothBandshape.
+	float			*partialSumBandshape;		//Contribution of current block to sumBandshape
+	float			*partialSquareBandshape;	//Contribution of current block to squareBandshape
+	float			*correlationBandshape;
+	char			*headerInfo;			//corresponding header information - used only in INLINE mode
+	//Minimum and maximum of each array. Used in plotting.	
+	float 		minZeroDM;		
+	float		maxZeroDM;
+	float		maxBandshape;
+	float		minBandshape;
+	float		maxMeanToRmsBandshape;
+	float		minMeanToRmsBandshape;
+	float		minNormalizedBandshape;
+	float		maxNormalizedBandshape;
+	int 		count;				//No of time series in current bandshape;
+	char		isRawEightBit;			//1-> rawData still holds the unmodified 1-byte samples (enables the counting based fast paths)
+	char		isBandshapeComputed;		//1-> bandshape of the block has already been accumulated (tiled execution)
+	char		isFlaggedBlock;			//1-> block is mostly flagged (-skipflagged), decided once on the final flags in timeTasks()
+	//Functions:
+	BasicAnalysis(Information _info);
+	BasicAnalysis(float* _rawData,int polarIndex_,long int _blockLength);
+	~BasicAnalysis();
+	void computeZeroDM(char* freqFlags);							//Computes zeroDM with given frequency flags
+	void computeZeroDM(char* freqFlags,long int firstSample,long int nSamples);		//Computes zeroDM for a range of time samples
+	void normalizeAndComputeZeroDM(char* freqFlags,long int tileLength);			//Tiled normalization and zeroDM computation
+	void computeBandshape();								//Computes bandshape
+	void computeBandshapeSpectralKurtosis();						//Computes bandshape and flags sub-blocks by spectral kurtosis
+	void startBandshape();									//Clears the bandshape before accumulation
+	void accumulateBandshape(long int firstSample,long int nSamples);			//Adds a range of time samples to the bandshape
+	void finishBandshape();									//Completes the accumulated bandshape
+	void computeBandshapeFromCounts();							//Computes bandshape of 1-byte data from 256-bin count histograms
+	void computeBandshape(char* timeFlags);							//Computes bandshape with given time flags
+	void calculateBlockBandshapes();							//Computes the bandshapes of the current block and its share of the cumulative bandshapes
+	void mergeCumulativeBandshapes();				//Merges the current block into the global cumulative bandshapes in block order
+	void quicksort(float* x,long int first,long int last);					//Used to compute smooth bandshape using moving median 
+	void smoothBlockBandshape(); 								//Smoothens the bandshape of the current block
+	void normalizeSmoothBandshape(); 							//Updates the cumulative smooth bandshape and normalizes the bandshape
+	void normalizeBandshape();								// Normalize bandshape using externally supplied file
+	void normalizeData();									//normalizes 2-D data
+	void normalizeData(long int firstSample,long int nSamples);				//normalizes a range of time samples of 2-D data
+	void getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue);	//gets Filtered Raw Data.
+	void getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue,long int firstSample,long int nSamples);	//gets Filtered Raw Data of a range of time samples
+	void getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags);
+	void getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags,long int firstSample,long int nSamples);
+	void getReplacedRawData(float replacementValue);					//Filtered Raw Data of a block that is flagged as a whole
+	void getReplacedRawDataSmoothBshape();
+	void flagSumThreshold(char* freqFlags);							//Flags individual samples with the SumThreshold method
+	void subtractZeroDM(char* freqFlags,float centralTendency);
+	void writeBandshape(const char*  filename);						//Writes out the cumulative mean and rms a bandshape	
+	void writeCurBandshape(const char* filename);						//Writes out current bandshape
+	void writeFilteredRawData(const char*  filename);					//Writes out filtered 2D data
+		
+};
+//implementation of BasicAnalysis methods begins
+//Declaration of static variables
+
+Information	BasicAnalysis::info;
+double**	BasicAnalysis::smoothSumBandshape;
+double** 	BasicAnalysis::sumBandshape;
+double**	BasicAnalysis::squareBandshape;
+float**		BasicAnalysis::externalBandshape;
+long long int** BasicAnalysis::countBandshape;
+BandshapeKernel	BasicAnalysis::bandshapeKernel;
+
+
+/*******************************************************************
+*CONSTRUCTOR: BasicAnalysis::BasicAnalysis(Information _info)
+*Information _info: All input parameters are contained in this object
+*Initialization of static variables is done in this constructor
+*******************************************************************/
+BasicAnalysis::BasicAnalysis(Information _info)
+{
+	info=_info;
+	bandshapeKernel=selectBandshapeKernel(info.noOfChannels);
+	//initializing other static variables
+	smoothSumBandshape=new double*[info.noOfPol];
+	sumBandshape=new double*[info.noOfPol];
+	squareBandshape=new double*[info.noOfPol];
+	countBandshape=new long long int*[info.noOfPol];
+	externalBandshape=new float*[info.noOfPol];
+	for(int k=0;k<info.noOfPol;k++)
+	{
+		sumBandshape[k]=new double[info.noOfChannels];
+		smoothSumBandshape[k]=new double[info.noOfChannels];
+		squareBandshape[k]=new double[info.noOfChannels];
+		countBandshape[k]=new long long int[info.noOfChannels];
+		externalBandshape[k]=new float[info.noOfChannels];
+		for(int i=0;i<info.noOfChannels;i++)
+			sumBandshape[k][i]=smoothSumBandshape[k][i]=squareBandshape[k][i]=countBandshape[k][i]=0;
+	}
+	if(info.normalizationProcedure==2)
+	{
+		int count=0;
+		std::ifstream f("bandshape.dat");
+		std::string line;
+		while (std::getline(f, line)) {
+			count++;
+			int index;
+			float val;
+			std::istringstream ss(line);
+			ss >> index >> val;
+			if(val==0)
+				val=-1;
+			externalBandshape[0][index]=val;
+		}
+		if(count<<info.noOfChannels)
+		{
+			cout<<"bandshape.dat does not contain "<<info.noOfChannels<<" number of channels"<<endl;
+		}
+	}
+	filteredRawData=NULL;
+	sampleFlags=NULL;
+	
+}
+/*******************************************************************
+*FUNCTION: BasicAnalysis::BasicAnalysis(float* _rawData,int _blockIndex)
+*float *_rawData 		:the 2-D raw data to process in the current block
+*int _polarIndex		:index of polarization to process
+*long int _blockLength		:length of current block
+*Performs initialization of variables for current block
+*******************************************************************/
+BasicAnalysis::BasicAnalysis(float* _rawData,int _polarIndex,long int _blockLength)
+{
+	polarIndex=_polarIndex;
+	blockLength=_blockLength;
+	rawData=_rawData;
+	bandshape=new float[info.noOfChannels];	
+	correlationBandshape=new float[info.noOfChannels];	
+	meanToRmsBandshape=new float[info.noOfChannels];	
+	normalizedBandshape=new float[info.noOfChannels];	
+	partialSumBandshape=new float[info.noOfChannels];	
+	partialSquareBandshape=new float[info.noOfChannels];	
+	zeroDM=new float[blockLength]; 
+	zeroDMUnfiltered=new float[blockLength]; 
+	cumBandshapeScale=1000.0;
+	if(info.normalizationProcedure==2)
+		smoothBandshape=externalBandshape[polarIndex];
+	else
+		smoothBandshape=new float[info.noOfChannels];
+	filteredRawData=NULL;
+	sampleFlags=NULL;
+	headerInfo=NULL;
+	isRawEightBit=(info.sampleSizeBytes==1);
+	isBandshapeComputed=0;
+	isFlaggedBlock=0;
+	
+}
+/*******************************************************************
+*DESTRUCTOR: BasicAnalysis::~BasicAnalysis()
+*Frees memory occupied by various arrays
+*******************************************************************/
+BasicAnalysis::~BasicAnalysis()
+{
+	delete[] rawData;
+	delete[] zeroDM;
+	delete[] zeroDMUnfiltered;
+	delete[] bandshape;
+	delete[] correlationBandshape;
+	delete[] meanToRmsBandshape;
+	delete[] normalizedBandshape;
+	delete[] partialSumBandshape;
+	delete[] partialSquareBandshape;
+	if(info.normalizationProcedure!=2)
+		delete[] smoothBandshape;
+	if(filteredRawData!=NULL)
+		delete[] filteredRawData;
+	if(sampleFlags!=NULL)
+		delete[] sampleFlags;
+	if(headerInfo!=NULL)
+		delete[] headerInfo;
+}
+
+
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::computeZeroDM(char* freqFlags)
+*char* freqFlags : The channels marked 1 in this array is not 
+*included while computing zeroDM (or are clipped)
+*For no flagging, a char* variable with all 0's is passed on to this 
+*function
+*Computes the time series by collapsing all frequency channels with
+*no dedispersion (hence the name "zeroDM" series). While collapsing 
+*the flagged channels are ignored or clipped.
+*******************************************************************/
+void BasicAnalysis::computeZeroDM(char* freqFlags)
+{
+	maxZeroDM=0;
+	minZeroDM=10000*(info.stopChannel-info.startChannel);	//This is done because there is no sample computed yet.		
+	computeZeroDM(freqFlags,0,blockLength);
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::computeZeroDM(char* freqFlags,long int firstSample,long int nSamples)
+*long int firstSample	: first time sample to compute
+*long int nSamples	: number of time samples to compute
+*Computes zeroDM for a range of time samples and updates its minimum
+*and maximum (which are initialized by computeZeroDM(char* freqFlags)).
+*Only the runs of unflagged channels are summed into zeroDM; the 
+*flagged gaps are summed separately for the unfiltered series.
+*******************************************************************/
+void BasicAnalysis::computeZeroDM(char* freqFlags,long int firstSample,long int nSamples)
+{
+	float*	ptrZeroDM;
+	float*	ptrZeroDMUnfiltered;
+	float* 	ptrRawData;
+	float 	count=0;					//Stores the number of channels added to get each time sample	
+	int 	startChannel=info.startChannel;
+	int 	nChan= info.stopChannel-startChannel;		//Number of channels to use
+	int	*runs=new int[nChan+1];				//Runs of unflagged channels
+	int	nRuns=liveChannelRuns(freqFlags,nChan,runs);
+	for(int r=0;r<nRuns;r++)
+		count+=runs[2*r+1]-runs[2*r];
+	ptrRawData=rawData+firstSample*info.noOfChannels+startChannel;	//startChannel number of channels skipped at the start of the band
+	ptrZeroDM=zeroDM+firstSample;
+	ptrZeroDMUnfiltered=zeroDMUnfiltered+firstSample;
+	for(long int i=0;i<nSamples;i++,ptrZeroDM++,ptrZeroDMUnfiltered++,ptrRawData+=info.noOfChannels)
+	{		
+		float	sum=0;					//Sum of unflagged channels
+		float	flaggedSum=0;				//Sum of flagged channels
+		int 	j=0;
+		for(int r=0;r<nRuns;r++)
+		{
+			for(;j<runs[2*r];j++)
+				flaggedSum+=ptrRawData[j];
+			for(;j<runs[2*r+1];j++)
+				sum+=ptrRawData[j];
+		}
+		for(;j<nChan;j++)
+			flaggedSum+=ptrRawData[j];
+		*ptrZeroDM=sum/(float)count;			//Each sample averaged 
+		*ptrZeroDMUnfiltered=(sum+flaggedSum)/(float)nChan;
+		//Calculating of minimum and maximum of zeroDM series
+		if(*ptrZeroDM>maxZeroDM)
+			maxZeroDM=*ptrZeroDM;
+		if(*ptrZeroDM<minZeroDM)
+			minZeroDM=*ptrZeroDM;
+	}
+	delete[] runs;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::normalizeAndComputeZeroDM(char* freqFlags,long int tileLength)
+*char* freqFlags	: channels marked 1 are excluded from zeroDM
+*long int tileLength	: number of time samples per tile
+*Tiled execution of normalizeData() (if enabled) followed by 
+*computeZeroDM(). Each tile is normalized and immediately collapsed
+*while it is still in cache, instead of streaming the whole block 
+*twice. Results are identical to the untiled path.
+*******************************************************************/
+void BasicAnalysis::normalizeAndComputeZeroDM(char* freqFlags,long int tileLength)
+{
+	if(isRawEightBit && info.doUseNormalizedData)
+	{
+		//the table lookup normalization of 1-byte data is cheaper than tiling
+		normalizeData();
+		computeZeroDM(freqFlags);
+		return;
+	}
+	maxZeroDM=0;
+	minZeroDM=10000*(info.stopChannel-info.startChannel);
+	for(long int firstSample=0;firstSample<blockLength;firstSample+=tileLength)
+	{
+		long int nSamples=(blockLength-firstSample<tileLength)?blockLength-firstSample:tileLength;
+		if(info.doUseNormalizedData)
+			normalizeData(firstSample,nSamples);
+		computeZeroDM(freqFlags,firstSample,nSamples);
+	}
+	if(info.doUseNormalizedData)
+		isRawEightBit=0;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::computeBandshape()
+*Computes mean and mean-to-rms bandshape for the current block .
+*It also calculates quantities to find the cumulative mean and 
+*rms of the bandshape.
+*******************************************************************/
+void BasicAnalysis::computeBandshape()
+{
+	if(info.doSpectralKurtosis)
+	{
+		computeBandshapeSpectralKurtosis();
+		return;
+	}
+	if(isRawEightBit)
+	{
+		computeBandshapeFromCounts();
+		return;
+	}
+	startBandshape();
+	accumulateBandshape(0,blockLength);
+	finishBandshape();
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::computeBandshapeSpectralKurtosis()
+*Computes the bandshape as computeBandshape() and, in the same pass,
+*the generalized spectral kurtosis estimator (Nita & Gary 2010) of each
+*channel for every sub-block of M=info.skBlockLength samples:
+*	SK=(M*N*d+1)/(M-1)*(M*S2/S1^2-1)
+*where S1 and S2 are the sum and the sum of squares of the power over 
+*the sub-block and N*d=info.skShape. SK is 1 for gaussian noise, and 
+*departs from 1 for non-gaussian (e.g. pulsed or CW) RFI that the mean-
+*to-rms bandshape averages out. The samples of a sub-block of a channel
+*with |SK-1| more than chanCutOffToRMS times the rms of SK,
+*	sqrt(2*N*d*(N*d+1)*M^2/((M-1)*(M*N*d+2)*(M*N*d+3)))
+*are marked in sampleFlags.
+*******************************************************************/
+void BasicAnalysis::computeBandshapeSpectralKurtosis()
+{
+	int 	startChannel=info.startChannel;
+	int 	nChan=info.stopChannel-startChannel;
+	int	totalChan=info.noOfChannels;
+	float	shape=info.skShape;
+	float	*sum=new float[nChan];
+	float	*squareSum=new float[nChan];
+	if(sampleFlags==NULL)
+	{
+		sampleFlags=new char[blockLength*totalChan];
+		memset(sampleFlags,0,blockLength*totalChan);
+	}
+	startBandshape();
+	for(long int firstSample=0;firstSample<blockLength;firstSample+=info.skBlockLength)
+	{
+		long int M=(blockLength-firstSample<info.skBlockLength)?blockLength-firstSample:info.skBlockLength;
+		for(int j=0;j<nChan;j++)
+			sum[j]=squareSum[j]=0;
+		for(long int i=firstSample;i<firstSample+M;i++)
+			accumulateMoments(&rawData[i*totalChan+startChannel],sum,squareSum,nChan);
+		float *ptrBandshape=&bandshape[startChannel];
+		float *ptrMeanToRmsBandshape=&meanToRmsBandshape[startChannel];
+		for(int j=0;j<nChan;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
+		{
+			*ptrBandshape+=sum[j];
+			*ptrMeanToRmsBandshape+=squareSum[j];
+		}
+		if(M<2)
+			continue;
+		double MNd=M*shape;
+		double skScale=(MNd+1)/(M-1);
+		double skRms=sqrt(2*shape*(shape+1)*M*M/((M-1)*(MNd+2)*(MNd+3)));
+		float cutoff=info.chanCutOffToRMS*skRms;
+		for(int j=0;j<nChan;j++)
+		{
+			if(sum[j]<=0)
+				continue;
+			float sk=skScale*(M*squareSum[j]/((double)sum[j]*sum[j])-1);
+			if(fabs(sk-1)<=cutoff)
+				continue;
+			char *ptrFlag=&sampleFlags[firstSample*totalChan+startChannel+j];
+			for(long int i=0;i<M;i++,ptrFlag+=totalChan)
+				*ptrFlag=1;
+		}
+	}
+	finishBandshape();
+	delete[] sum;
+	delete[] squareSum;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::startBandshape()
+*Clears the bandshape accumulators. Together with accumulateBandshape()
+*and finishBandshape() this allows the bandshape to be built up tile by
+*tile (see Runtime::floatConversionTasks()).
+*******************************************************************/
+void BasicAnalysis::startBandshape()
+{
+	float	*ptrBandshape=bandshape;
+	float	*ptrMeanToRmsBandshape=meanToRmsBandshape;
+	//Intialization of bandshape
+	for(int j=0;j<info.noOfChannels;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
+		*ptrBandshape=*ptrMeanToRmsBandshape=0;	
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::accumulateBandshape(long int firstSample,long int nSamples)
+*long int firstSample	: first time sample to add
+*long int nSamples	: number of time samples to add
+*Adds the given time samples to the sum and sum of squares of each
+*channel.
+*******************************************************************/
+void BasicAnalysis::accumulateBandshape(long int firstSample,long int nSamples)
+{
+	float	*ptrBandshape,*ptrMeanToRmsBandshape;
+	float	*ptrRawData;
+	int 	startChannel=info.startChannel;
+	int 	nChan= info.stopChannel-startChannel;				//Number of channels to use
+	int 	endExclude=info.noOfChannels-info.stopChannel;			//Number of channels to exclude from the end
+	ptrRawData=rawData+firstSample*info.noOfChannels;
+	if(bandshapeKernel!=NULL)
+	{
+		bandshapeKernel(ptrRawData,bandshape,meanToRmsBandshape,nSamples);	//excluded channels are reset by finishBandshape()
+		return;
+	}
+	for(long int i=0;i<nSamples;i++)
+	{		
+		ptrBandshape=&bandshape[startChannel]; 				//startChannel number of channels skipped at the start
+		ptrMeanToRmsBandshape=&meanToRmsBandshape[startChannel];
+		ptrRawData+=startChannel;
+		for(int j=0;j<nChan;j++,ptrRawData++,ptrBandshape++,ptrMeanToRmsBandshape++)
+		{
+			(*ptrBandshape)+=(*ptrRawData);
+			*ptrMeanToRmsBandshape+=(*ptrRawData)*(*ptrRawData);
+		}
+		ptrRawData+=endExclude;						//endExclude number of channels skipped at the end
+	}
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::finishBandshape()
+*Completes a bandshape built up by accumulateBandshape().
+*******************************************************************/
+void BasicAnalysis::finishBandshape()
+{
+	//excluded channels are reset
+	for(int j=0;j<info.startChannel;j++)
+		bandshape[j]=meanToRmsBandshape[j]=0;
+	for(int j=info.stopChannel;j<info.noOfChannels;j++)
+		bandshape[j]=meanToRmsBandshape[j]=0;
+	count=blockLength;
+	isBandshapeComputed=1;
+}
+
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::computeBandshapeFromCounts()
+*Fast path of computeBandshape() for 1-byte data. The samples of each
+*channel are binned into a 256-bin count histogram, from which the 
+*sum and sum of squares are obtained exactly using integer arithmetic.
+*(Float accumulation of squares of 8-bit values loses precision
+*beyond ~250 samples.)
+*Valid only while rawData holds the unmodified 1-byte samples.
+*******************************************************************/
+void BasicAnalysis::computeBandshapeFromCounts()
+{
+	float	*ptrBandshape,*ptrMeanToRmsBandshape;
+	float	*ptrRawData;
+	int 	startChannel=info.startChannel;
+	int 	nChan= info.stopChannel-startChannel;				//Number of channels to use
+	int 	endExclude=info.noOfChannels-info.stopChannel;			//Number of channels to exclude from the end
+	int 	l= blockLength;
+	int	offset=(info.doPolarMode)?128:0;				//1-byte polar data is signed
+	unsigned int *counts=new unsigned int[nChan*256];
+	unsigned int *ptrCounts;
+	
+	ptrCounts=counts;
+	for(long int j=0;j<nChan*256;j++,ptrCounts++)
+		*ptrCounts=0;
+	ptrRawData=rawData;
+	for(int i=0;i<l;i++)
+	{		
+		ptrRawData+=startChannel;					//startChannel number of channels skipped at the start
+		ptrCounts=counts+offset;
+		for(int j=0;j<nChan;j++,ptrRawData++,ptrCounts+=256)
+			ptrCounts[(int)(*ptrRawData)]++;
+		ptrRawData+=endExclude;						//endExclude number of channels skipped at the end
+	}
+	
+	ptrBandshape=bandshape;
+	ptrMeanToRmsBandshape=meanToRmsBandshape;
+	for(int j=0;j<info.noOfChannels;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
+		*ptrBandshape=*ptrMeanToRmsBandshape=0;	
+	ptrBandshape=&bandshape[startChannel];
+	ptrMeanToRmsBandshape=&meanToRmsBandshape[startChannel];
+	ptrCounts=counts;
+	for(int j=0;j<nChan;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
+	{
+		long long int sum=0,square=0;
+		for(int v=-offset;v<256-offset;v++,ptrCounts++)
+		{
+			sum+=(long long int)v*(*ptrCounts);
+			square+=(long long int)(v*v)*(*ptrCounts);
+		}
+		*ptrBandshape=sum;
+		*ptrMeanToRmsBandshape=square;
+	}
+	delete[] counts;
+	count=blockLength;
+	isBandshapeComputed=1;
+}
+
+/*******************************************************************
+*void BasicAnalysis::computeBandshape(char* timeFlags)
+*char* timeFlags : Excludes the time samples for which timeFlag is 1
+*This function is similar to void BasicAnalysis::computeBandshape(),
+*the only difference being that timeFlags is used to ignore (or clip)
+*bad time samples.
+*******************************************************************/
+void BasicAnalysis::computeBandshape(char* timeFlags)
+{
+	float *ptrBandshape,*ptrMeanToRmsBandshape;
+	float* 	ptrRawData;
+	char*  	ptrTimeFlags;
+	int 	startChannel=info.startChannel;
+	int 	nChan= info.stopChannel-startChannel;
+	int 	endExclude=info.noOfChannels-info.stopChannel;
+	int 	l= blockLength;
+	ptrRawData=rawData;
+	ptrBandshape=bandshape;
+	ptrTimeFlags=timeFlags;
+	
+	//Initializing bandshape
+	for(int j=0;j<info.noOfChannels;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
+		*ptrBandshape=*ptrMeanToRmsBandshape=0;		
+			
+	ptrTimeFlags=timeFlags;	
+	
+	for(int i=0;i<l;i++,ptrTimeFlags++)
+	{		
+		ptrBandshape=&(bandshape[startChannel]);			//startChannel number of channels skipped at the start
+		ptrMeanToRmsBandshape=&meanToRmsBandshape[startChannel];
+		if(!(*ptrTimeFlags))
+		{
+			ptrRawData+=startChannel;			
+			for(int j=0;j<nChan;j++,ptrRawData++,ptrBandshape++,ptrMeanToRmsBandshape++)
+			{
+				(*ptrBandshape)+=(*ptrRawData);	
+				*ptrMeanToRmsBandshape+=(*ptrRawData)*(*ptrRawData);	
+					
+			}
+			ptrRawData+=endExclude;					//endExclude number of channels skipped at the end
+			ptrBandshape+=endExclude;
+			ptrMeanToRmsBandshape+=endExclude;
+		}
+		else
+			ptrRawData+=info.noOfChannels;				//skips entire time sample if flagged
+	}
+	
+	//Finding number of time samples added to each channel bin
+	for(int i=0;i<l;i++,ptrTimeFlags++)
+		if(!(*ptrTimeFlags))		
+			count++;
+	
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::calculateBlockBandshapes()
+*Computes the mean and mean-to-rms bandshape of the current block and,
+*if required, its moving median smooth bandshape. The contribution of
+*the block to the cumulative bandshapes is kept in partialSumBandshape
+*and partialSquareBandshape, to be added later by
+*mergeCumulativeBandshapes(). No shared state is touched here, hence
+*blocks can be processed in any order and in parallel.
+*******************************************************************/
+void BasicAnalysis::calculateBlockBandshapes()
+{
+	float *ptrBandshape,*ptrMeanToRmsBandshape;
+	float *ptrPartialSumBandshape,*ptrPartialSquareBandshape;
+	int nChan= info.stopChannel-info.startChannel;
+	ptrBandshape=&bandshape[info.startChannel];	
+	ptrMeanToRmsBandshape=&meanToRmsBandshape[info.startChannel];
+	ptrPartialSumBandshape=&partialSumBandshape[info.startChannel];
+	ptrPartialSquareBandshape=&partialSquareBandshape[info.startChannel];
+	minMeanToRmsBandshape=minBandshape=1e8;
+	maxMeanToRmsBandshape=maxBandshape=0;
+
+	/*************************************************************************************
+	*Calculation of this block's share of the cumulative values, current mean bandshape,
+	*mean-to-rms bandshape. Also computes the max and min of each of these bandshapes.
+	*These max-min values are used for plotting purposes.
+	**************************************************************************************/
+	for(int j=0;j<nChan;j++,ptrBandshape++,ptrPartialSumBandshape++,ptrPartialSquareBandshape++,ptrMeanToRmsBandshape++)
+	{
+		//Contribution to cumulative values: 
+		*ptrPartialSumBandshape=*ptrBandshape/cumBandshapeScale;
+		*ptrPartialSquareBandshape=*ptrMeanToRmsBandshape/(cumBandshapeScale*cumBandshapeScale);
+		
+		//Computation of mean bandshape:
+		*ptrBandshape/=(float)count;
+		if(*ptrBandshape>maxBandshape)
+			maxBandshape=*ptrBandshape;
+		if(*ptrBandshape<minBandshape)		
+			minBandshape=*ptrBandshape;
+		if(*ptrBandshape==0)
+		{
+			*ptrMeanToRmsBandshape=0;
+			minMeanToRmsBandshape=0;
+			continue;
+		}
+		//Computation of mean-to-rms bandshape:
+		*ptrMeanToRmsBandshape=(*ptrBandshape)/sqrt(*ptrMeanToRmsBandshape/count-pow(*ptrBandshape,2));
+		
+		
+		if(*ptrMeanToRmsBandshape>maxMeanToRmsBandshape)
+			maxMeanToRmsBandshape=*ptrMeanToRmsBandshape;
+		if(*ptrMeanToRmsBandshape<minMeanToRmsBandshape)		
+			minMeanToRmsBandshape=*ptrMeanToRmsBandshape;
+		
+	}
+	if(((int)info.bandshapeToUse==2 || info.doUseNormalizedData) && info.normalizationProcedure==1)
+		smoothBlockBandshape();
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::mergeCumulativeBandshapes()
+*Adds the partial bandshapes of the current block to the global
+*cumulative bandshapes and normalizes the bandshape with the updated
+*cumulative smooth bandshape.
+*Blocks must be merged strictly in block order, so the cumulative sums
+*are bit-for-bit independent of the number of threads. The caller runs
+*it in an omp ordered region (see Runtime::channelTasks()). This is 
+*the only serial part of the bandshape computation and is O(nChan).
+*The cumulative values are used to calculate the mean and the mean-to-rms
+*bandshape over the entire run of the program.
+*******************************************************************/
+void BasicAnalysis::mergeCumulativeBandshapes()
+{
+	int nChan= info.stopChannel-info.startChannel;
+	float *ptrPartialSumBandshape=&partialSumBandshape[info.startChannel];
+	float *ptrPartialSquareBandshape=&partialSquareBandshape[info.startChannel];
+	double *ptrSumBandshape=&sumBandshape[polarIndex][info.startChannel];
+	double *ptrSquareBandshape=&squareBandshape[polarIndex][info.startChannel];
+	long long int *ptrCountBandshape=&countBandshape[polarIndex][info.startChannel];
+	
+	for(int j=0;j<nChan;j++,ptrPartialSumBandshape++,ptrPartialSquareBandshape++,ptrSumBandshape++,ptrSquareBandshape++,ptrCountBandshape++)
+	{
+		*ptrSumBandshape+=*ptrPartialSumBandshape;
+		*ptrSquareBandshape+=*ptrPartialSquareBandshape;
+		*ptrCountBandshape+=count;	
+	}
+	if((int)info.bandshapeToUse==2 || info.doUseNormalizedData)
+	{
+		if(info.normalizationProcedure==1)
+			normalizeSmoothBandshape();
+		else
+			normalizeBandshape();
+	}
+}
+void BasicAnalysis::quicksort(float* x,long int first,long int last)
+{
+    int pivot,j,i;
+    float temp;
+
+     if(first<last){
+         pivot=first;
+         i=first;
+         j=last;
+
+         while(i<j){
+             while(x[i]<=x[pivot]&&i<last)
+                 i++;
+             while(x[j]>x[pivot])
+                 j--;
+             if(i<j){
+                 temp=x[i];
+                  x[i]=x[j];
+                  x[j]=temp;
+             }
+         }
+
+         temp=x[pivot];
+         x[pivot]=x[j];
+         x[j]=temp;
+         quicksort(x,first,j-1);
+         quicksort(x,j+1,last);
+
+	}
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::smoothBlockBandshape()
+*Smoothens the mean bandshape of the current block using a moving
+*median. The result is stored in smoothBandshape and is folded into 
+*the cumulative smooth bandshape by normalizeSmoothBandshape().
+*The smooth bandshape here is used as an approximation to filtering
+*response where smoothing ensures that the impact of RFI is minimized.
+*******************************************************************/
+void BasicAnalysis::smoothBlockBandshape() 
+{
+	int startChannel=info.startChannel;
+	int nChan= info.stopChannel-startChannel;
+	float *ptrSmoothBandshape=&smoothBandshape[startChannel];
+	float *ptrBandshape=&bandshape[startChannel];	
+	for(int i=0;i<info.noOfChannels;i++)
+		smoothBandshape[i]=0;
+	int wSize=info.smoothingWindowLength/2;
+	float* tempArray=new float[info.smoothingWindowLength];
+	
+	for(int j=0;j<nChan;j++,ptrBandshape++,ptrSmoothBandshape++)
+	{
+		int tempCnt=0;	
+		for(int i=-1*wSize;i<wSize;i++)
+		{
+			if(i+j>=nChan)
+				break;
+			if(i+j>=0)
+			{
+				tempArray[tempCnt]=*(ptrBandshape+i);
+				tempCnt++;	
+			}
+		}
+		quicksort(tempArray,0,tempCnt-1);
+		*ptrSmoothBandshape=tempArray[tempCnt/2];
+	}
+	delete[] tempArray;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::normalizeSmoothBandshape()
+*Adds the smooth bandshape of the current block to the cumulative 
+*smooth bandshape and uses the latter to find the normalized 
+*bandshape. Must be called in block order (see 
+*mergeCumulativeBandshapes()).
+*Normilization inverts the effect of filter response to bring the power
+*levels of each channel to roughly 1.
+*Normalization helps in both time and frequency domain filtering.
+*Refer to documentations on it for more details.
+*******************************************************************/
+void BasicAnalysis::normalizeSmoothBandshape() 
+{
+	int startChannel=info.startChannel;
+	int nChan= info.stopChannel-startChannel;
+	double *ptrSmoothSumBandshape=&smoothSumBandshape[polarIndex][startChannel];
+	float *ptrSmoothBandshape=&smoothBandshape[startChannel];
+	float *ptrNormalizedBandshape=&normalizedBandshape[startChannel];
+	float *ptrBandshape=&bandshape[startChannel];	
+	long long *ptrCountBandshape=&countBandshape[polarIndex][startChannel];
+	minNormalizedBandshape=maxNormalizedBandshape=0;
+	
+	for(int j=0;j<nChan;j++,ptrBandshape++,ptrSmoothBandshape++,ptrNormalizedBandshape++,ptrSmoothSumBandshape++,ptrCountBandshape++)
+	{
+		*ptrSmoothSumBandshape+=(*ptrSmoothBandshape)*blockLength/cumBandshapeScale;
+		*ptrSmoothBandshape=(*ptrSmoothSumBandshape)*cumBandshapeScale/(*ptrCountBandshape);
+		*ptrNormalizedBandshape=*ptrBandshape/(*ptrSmoothBandshape);
+		if(*ptrNormalizedBandshape<minNormalizedBandshape)
+			minNormalizedBandshape=*ptrNormalizedBandshape;
+		if(*ptrNormalizedBandshape>maxNormalizedBandshape)
+			maxNormalizedBandshape=*ptrNormalizedBandshape;
+		if(*ptrSmoothBandshape==0)
+		{
+			*ptrSmoothBandshape=1;
+			*ptrNormalizedBandshape=0;
+		}
+	}
+}
+
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::normalizeBandshape()
+*Normalizes bandshape using externally supplied bandshape
+*Normalization inverts the effect of filter response to bring the power
+*levels of each channel to roughly 1.
+*Normalization helps in both time and frequency domain filtering.
+*Refer to documentations on it for more details.
+*******************************************************************/
+void BasicAnalysis::normalizeBandshape() 
+{
+	
+	int nChan= info.stopChannel-info.startChannel;
+	float *ptrSmoothBandshape=&smoothBandshape[info.startChannel];
+	float *ptrNormalizedBandshape=&normalizedBandshape[info.startChannel];
+	float *ptrBandshape=&bandshape[info.startChannel];
+	for(int j=0;j<nChan;j++,ptrBandshape++,ptrSmoothBandshape++,ptrNormalizedBandshape++)
+	{
+		if(*ptrSmoothBandshape==0)
+			*ptrNormalizedBandshape=0;
+		*ptrNormalizedBandshape=*ptrBandshape/(*ptrSmoothBandshape);
+		if(*ptrNormalizedBandshape<minNormalizedBandshape)
+			minNormalizedBandshape=*ptrNormalizedBandshape;
+		if(*ptrNormalizedBandshape>maxNormalizedBandshape)
+			maxNormalizedBandshape=*ptrNormalizedBandshape;
+	}
+}
+
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::NormalizeData()
+*Normalizes data based on smooth bandshape.
+*******************************************************************/
+void BasicAnalysis::normalizeData()
+{	
+	int startChannel=info.startChannel;
+	int nChan= info.stopChannel-startChannel;
+	int endExclude=info.noOfChannels-info.stopChannel;
+	float *ptrSmoothBandshape=&smoothBandshape[startChannel];
+	float *ptrRawData=rawData;	
+	if(isRawEightBit && blockLength>256)
+	{
+		/*1-byte data can take only 256 values per channel. The quotients are
+		*tabulated once per channel (same division, hence identical results)
+		*and the 2-D data is normalized by table lookup.*/
+		int offset=(info.doPolarMode)?128:0;
+		float *lookupTable=new float[nChan*256];
+		float *ptrLookupTable=lookupTable;
+		for(int j=0;j<nChan;j++,ptrSmoothBandshape++)
+			for(int v=-offset;v<256-offset;v++,ptrLookupTable++)
+				*ptrLookupTable=(float)v/(*ptrSmoothBandshape);
+		for(int i=0;i<blockLength;i++)
+		{							
+			ptrRawData+=startChannel;
+			ptrLookupTable=lookupTable+offset;
+			for(int j=0;j<nChan;j++,ptrRawData++,ptrLookupTable+=256)
+				(*ptrRawData)=ptrLookupTable[(int)(*ptrRawData)];		
+			ptrRawData+=endExclude;
+		}
+		delete[] lookupTable;
+		isRawEightBit=0;
+		return;
+	}
+	normalizeData(0,blockLength);
+	isRawEightBit=0;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::normalizeData(long int firstSample,long int nSamples)
+*Normalizes a range of time samples based on smooth bandshape.
+*******************************************************************/
+void BasicAnalysis::normalizeData(long int firstSample,long int nSamples)
+{	
+	int startChannel=info.startChannel;
+	int nChan= info.stopChannel-startChannel;
+	int endExclude=info.noOfChannels-info.stopChannel;
+	float *ptrSmoothBandshape;
+	float *ptrRawData=rawData+firstSample*info.noOfChannels;	
+	for(long int i=0;i<nSamples;i++)
+	{							
+		ptrRawData+=startChannel;
+		ptrSmoothBandshape=&smoothBandshape[startChannel];
+		for(int j=0;j<nChan;j++,ptrRawData++,ptrSmoothBandshape++)
+			(*ptrRawData)=(*ptrRawData)/(*ptrSmoothBandshape);		
+		ptrRawData+=endExclude;
+		
+	}
+}
+
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::computeZeroDM(char* freqFlags)
+*char* freqFlags : The channels marked 1 in this array is not 
+*included while computing zeroDM (or are clipped)
+*For no flagging, a char* variable with all 0's is passed on to this 
+*function
+*Subtracts the zero DM time series from each channel
+*******************************************************************/
+void BasicAnalysis::subtractZeroDM(char* freqFlags,float centralTendency)
+{
+	float*	ptrZeroDM;
+	float*	ptrCorrelationBandshape;
+	float*	ptrMeanToRmsBandshape;
+	float*  ptrNormalizedBandshape;
+	float* 	ptrRawData;
+	float 	count=0;					//Stores the number of channels added to get each time sample	
+	int 	startChannel=info.startChannel;
+	int 	nChan= info.stopChannel-startChannel;		//Number of channels to use
+	int 	endExclude=info.noOfChannels-info.stopChannel;	//Number of channels to exclude from the end of the band
+	int 	l= blockLength;
+	float 	zeroDMMean,zeroDMRMS;
+	for(int i=0;i<nChan;i++)
+		if(!freqFlags[i])
+			count++;
+	ptrZeroDM=zeroDM;
+	zeroDMMean=0.0;	
+	zeroDMRMS=0.0;
+	for(int i=0;i<l;i++,ptrZeroDM++)
+	{
+		zeroDMMean+=*ptrZeroDM;
+		zeroDMRMS+=(*ptrZeroDM)*(*ptrZeroDM);
+	}
+	zeroDMMean/=l;
+	zeroDMRMS=zeroDMRMS/l-zeroDMMean*zeroDMMean;
+	ptrZeroDM=zeroDM;
+	ptrRawData=rawData;
+	ptrCorrelationBandshape=correlationBandshape;
+	for(int j=0;j<info.noOfChannels;j++,ptrCorrelationBandshape++)		
+		*ptrCorrelationBandshape=0;
+	for(int i=0;i<l;i++,ptrZeroDM++)
+	{	
+		ptrRawData+=startChannel;			//startChannel number of channels skipped at the start of the band
+		ptrCorrelationBandshape=correlationBandshape+startChannel;
+		ptrNormalizedBandshape=normalizedBandshape+startChannel;
+		for(int j=0;j<nChan;j++,ptrRawData++,ptrCorrelationBandshape++,ptrNormalizedBandshape++)		
+			*ptrCorrelationBandshape+=(*ptrZeroDM-zeroDMMean)*(*ptrRawData-*ptrNormalizedBandshape);
+		ptrRawData+=endExclude;				//endExclude number of channels skipped at the end of the band
+	}
+	ptrZeroDM=zeroDM;
+	ptrRawData=rawData;
+	for(int i=0;i<l;i++,ptrZeroDM++)
+	{	
+		ptrRawData+=startChannel;			//startChannel number of channels skipped at the start of the band
+		ptrCorrelationBandshape=correlationBandshape+startChannel;
+		ptrNormalizedBandshape=normalizedBandshape+startChannel;
+		ptrMeanToRmsBandshape=meanToRmsBandshape+startChannel;
+		for(int j=0;j<nChan;j++,ptrRawData++,ptrNormalizedBandshape++,ptrCorrelationBandshape++,ptrMeanToRmsBandshape++)		
+			*ptrRawData=(*ptrRawData-*ptrNormalizedBandshape)-(*ptrZeroDM-zeroDMMean)*(*ptrCorrelationBandshape/l)/zeroDMRMS+*ptrNormalizedBandshape;
+		ptrRawData+=endExclude;				//endExclude number of channels skipped at the end of the band
+	}
+	isRawEightBit=0;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::getFilteredRawData(float replacementValue)
+*float replacementValue - 0 or median/mode of zeroDM series
+*Replaces flagged values by zero or median when 2d time-freq data
+*is to be written out
+*******************************************************************/
+void BasicAnalysis::getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue)
+{
+	getFilteredRawData(timeFlags,freqFlags,replacementValue,0,blockLength);
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue,long int firstSample,long int nSamples)
+*long int firstSample	:first time sample of the range
+*long int nSamples	:number of time samples in the range
+*As getFilteredRawData(timeFlags,freqFlags,replacementValue) for a 
+*range of time samples, filteredRawData is allocated for the whole 
+*block on the first call (see Runtime::fullDMTask() in tiled mode).
+*******************************************************************/
+void BasicAnalysis::getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue,long int firstSample,long int nSamples)
+{
+	int startChannel=info.startChannel;
+	int stopChannel=info.stopChannel;
+	int totalChan=info.noOfChannels;
+	float* ptrRawData=rawData+firstSample*totalChan;
+	char* ptrTimeFlags=timeFlags+firstSample;
+	char* ptrFreqFlags;
+	char* ptrSampleFlags=sampleFlags;
+	if(filteredRawData==NULL)
+		filteredRawData=new short int[blockLength*totalChan];
+	short int* ptrFilteredRawData=filteredRawData+firstSample*totalChan;
+	for(long int i=firstSample;i<firstSample+nSamples;i++,ptrTimeFlags++)
+	{
+			ptrFreqFlags=freqFlags;	
+			if(sampleFlags!=NULL)
+				ptrSampleFlags=sampleFlags+i*totalChan+startChannel;
+			for(int j=0;j<startChannel;j++,ptrRawData++,ptrFilteredRawData++)
+				*ptrFilteredRawData=(short int)(replacementValue*info.meanval);
+
+			for(int j=startChannel;j<stopChannel;j++,ptrRawData++,ptrFreqFlags++,ptrFilteredRawData++)
+			{
+
+				if((!*ptrTimeFlags)&(!*ptrFreqFlags)&((sampleFlags==NULL) || !(*(ptrSampleFlags++))))
+					*ptrFilteredRawData=(short int)((*ptrRawData)*info.meanval);
+				else
+					*ptrFilteredRawData=(short int)(replacementValue*info.meanval);					
+			}
+
+			for(int j=stopChannel;j<totalChan;j++,ptrRawData++,ptrFilteredRawData++)
+				*ptrFilteredRawData=(short int)(replacementValue*info.meanval);
+	}
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags)
+*Replaces flagged values by the smooth bandshape value for that channel
+*******************************************************************/
+void BasicAnalysis::getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags)
+{
+	getFilteredRawDataSmoothBshape(timeFlags,freqFlags,0,blockLength);
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags,long int firstSample,long int nSamples)
+*As getFilteredRawDataSmoothBshape(timeFlags,freqFlags) for a range
+*of time samples (see getFilteredRawData()).
+*******************************************************************/
+void BasicAnalysis::getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags,long int firstSample,long int nSamples)
+{
+	int startChannel=info.startChannel;
+	int stopChannel=info.stopChannel;
+	int totalChan=info.noOfChannels;
+	float* ptrRawData=rawData+firstSample*totalChan;
+	char* ptrTimeFlags=timeFlags+firstSample;
+	char* ptrFreqFlags;
+	char* ptrSampleFlags=sampleFlags;
+	if(filteredRawData==NULL)
+		filteredRawData=new short int[blockLength*totalChan];
+	short int* ptrFilteredRawData=filteredRawData+firstSample*totalChan;
+	float *ptrSmoothBandshape;
+	for(long int i=firstSample;i<firstSample+nSamples;i++,ptrTimeFlags++)
+	{
+			ptrFreqFlags=freqFlags;	
+			if(sampleFlags!=NULL)
+				ptrSampleFlags=sampleFlags+i*totalChan+startChannel;
+			ptrSmoothBandshape=smoothBandshape;
+			for(int j=0;j<startChannel;j++,ptrRawData++,ptrFilteredRawData++,ptrSmoothBandshape++)
+				*ptrFilteredRawData=*ptrSmoothBandshape;
+
+			for(int j=startChannel;j<stopChannel;j++,ptrRawData++,ptrFreqFlags++,ptrFilteredRawData++,ptrSmoothBandshape++)
+			{
+
+				if((!*ptrTimeFlags)&(!*ptrFreqFlags)&((sampleFlags==NULL) || !(*(ptrSampleFlags++))))
+					*ptrFilteredRawData=(short int)(*ptrRawData);
+				else
+					*ptrFilteredRawData=(short int)(*ptrSmoothBandshape);					
+			}
+
+			for(int j=stopChannel;j<totalChan;j++,ptrRawData++,ptrFilteredRawData++,ptrSmoothBandshape++)
+				*ptrFilteredRawData=*ptrSmoothBandshape;
+	}
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::getReplacedRawData(float replacementValue)
+*float replacementValue - 0 or median/mode of zeroDM series
+*Filtered raw data of a block that is skipped as mostly flagged. All 
+*samples are replaced, so one spectrum is built and copied to every 
+*time sample.
+*******************************************************************/
+void BasicAnalysis::getReplacedRawData(float replacementValue)
+{
+	int totalChan=info.noOfChannels;
+	filteredRawData=new short int[blockLength*totalChan];
+	short int* ptrFilteredRawData=filteredRawData;
+	for(int j=0;j<totalChan;j++,ptrFilteredRawData++)
+		*ptrFilteredRawData=(short int)(replacementValue*info.meanval);
+	for(long int i=1;i<blockLength;i++,ptrFilteredRawData+=totalChan)
+		memcpy(ptrFilteredRawData,filteredRawData,totalChan*sizeof(short int));
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::getReplacedRawDataSmoothBshape()
+*As getReplacedRawData() with every sample replaced by the smooth 
+*bandshape value for its channel.
+*******************************************************************/
+void BasicAnalysis::getReplacedRawDataSmoothBshape()
+{
+	int totalChan=info.noOfChannels;
+	filteredRawData=new short int[blockLength*totalChan];
+	short int* ptrFilteredRawData=filteredRawData;
+	float* ptrSmoothBandshape=smoothBandshape;
+	for(int j=0;j<totalChan;j++,ptrFilteredRawData++,ptrSmoothBandshape++)
+		*ptrFilteredRawData=*ptrSmoothBandshape;
+	for(long int i=1;i<blockLength;i++,ptrFilteredRawData+=totalChan)
+		memcpy(ptrFilteredRawData,filteredRawData,totalChan*sizeof(short int));
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::flagSumThreshold(char* freqFlags)
+*char* freqFlags : channels marked 1 are already flagged and ignored
+*SumThreshold flagging (Offringa et al. 2010) of individual samples of
+*the 2-D data, for RFI that is narrow in time or frequency and would 
+*otherwise cost whole spectra or channels. Each sample is expressed in
+*units of the rms of its channel in this block. Windows of M=1,2,4..64
+*consecutive samples along time and along frequency are flagged when
+*the absolute sum exceeds M*cutoff/1.5^log2(M). Samples flagged at 
+*smaller windows are clipped to the current threshold. Sums along time
+*are running sums over all channels of a row, sums along frequency are
+*built by pairwise addition, so each pass is O(n) and vectorizes. Flags
+*are added to sampleFlags (samples flagged by spectral kurtosis count as
+*already flagged).
+*All window lengths are done in a single sweep over the block: window 
+*length M works on the time sample that the windows along time of the
+*shorter lengths can no longer flag, i.e. sum(M'-1) samples behind the
+*newest one. Only this band of about 128 time samples is touched at a
+*time, so it stays in cache while all levels pass over it. The sweep 
+*is done by sumThresholdSweep() with the other O3 kernels, the kernels
+*it calls per time sample are also built for AVX2 and picked at run 
+*time on CPUs that have it.
+*******************************************************************/
+void BasicAnalysis::flagSumThreshold(char* freqFlags)
+{
+	const int nLevels=7;						//window lengths 1,2,4..64
+	int startChannel=info.startChannel;
+	int nChan=info.stopChannel-startChannel;
+	int totalChan=info.noOfChannels;
+	if(sampleFlags==NULL)
+	{
+		sampleFlags=new char[blockLength*totalChan];
+		memset(sampleFlags,0,blockLength*totalChan);
+	}
+	float *mean=new float[nChan];
+	float *inverseRms=new float[nChan];
+	float *row=new float[nChan];					//standardized time sample
+	char *trigger=new char[nChan];
+	int *runs=new int[nChan+1];
+	int windowLength[nLevels];
+	long int lag[nLevels];						//number of time samples each level is behind the newest one
+	float threshold[nLevels];
+	float *ring[nLevels];						//last M standardized time samples added to the running sums
+	float *windowSum[nLevels];					//running sums along time
+	long int *flaggedUpTo[nLevels];					//last time sample flagged in each channel
+	for(int l=0;l<nLevels;l++)
+	{
+		windowLength[l]=1<<l;
+		lag[l]=(l==0)?0:lag[l-1]+windowLength[l-1]-1;
+		threshold[l]=(l==0)?info.sumThresholdCutOff:threshold[l-1]/1.5;
+		ring[l]=new float[windowLength[l]*nChan];
+		windowSum[l]=new float[nChan];
+		flaggedUpTo[l]=new long int[nChan];
+		for(int k=0;k<windowLength[l]*nChan;k++)
+			ring[l][k]=0;
+		for(int j=0;j<nChan;j++)
+		{
+			windowSum[l][j]=0;
+			flaggedUpTo[l][j]=-1;
+		}
+	}
+	//Statistics of each channel in the units of rawData
+	for(int j=0;j<nChan;j++)
+	{
+		float m=bandshape[startChannel+j];
+		float rms=(meanToRmsBandshape[startChannel+j]>0)?m/meanToRmsBandshape[startChannel+j]:0;
+		if(info.doUseNormalizedData)
+		{
+			m/=smoothBandshape[startChannel+j];
+			rms/=smoothBandshape[startChannel+j];
+		}
+		mean[j]=m;
+		inverseRms[j]=(rms>0 && !freqFlags[j])?1.0/rms:0;	//flagged or empty channels contribute 0
+	}
+	sumThresholdSweep(rawData+startChannel,blockLength,totalChan,nChan,mean,inverseRms,nLevels,windowLength,lag,threshold,ring,windowSum,flaggedUpTo,trigger,row,runs,sampleFlags+startChannel);
+	for(int l=0;l<nLevels;l++)
+	{
+		delete[] ring[l];
+		delete[] windowSum[l];
+		delete[] flaggedUpTo[l];
+	}
+	delete[] mean;
+	delete[] inverseRms;
+	delete[] row;
+	delete[] trigger;
+	delete[] runs;
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::writeFilteredRawData(const char*  filename)
+*const char*  fileName: Filename to write to.
+*Writes out filtered rawdata where flagged samples have been replaced by 
+*zeros
+*******************************************************************/
+void BasicAnalysis::writeFilteredRawData(const char*  filename)
+{
+	FILE* filteredRawDataFile;    
+	filteredRawDataFile = fopen(filename, "ab");
+	fwrite(filteredRawData, sizeof(short int), blockLength*info.noOfChannels, filteredRawDataFile); 
+	fclose(filteredRawDataFile); 
+}
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::writeBandshape(char* filename)
+*char* filename: Name of the file to which mean, mean smooth and rms bandshape will 
+*be written out.
+*Writes out the mean, mean smooth and rms bandshape (over the entire run of the program)
+*to the specified file.
+*******************************************************************/
+void BasicAnalysis::writeBandshape(const char* filename)
+{
+	ofstream meanFile;
+	meanFile.open(filename);
+	double sMean,mean,rms;
+	meanFile<<"# chan_no \t smooth_bshape \t mean_bshape \t rms_bshape"<<endl;
+	for(int i=0;i<info.noOfChannels;i++)
+	{
+		if(countBandshape[polarIndex][i]!=0)		
+		{
+			sMean=smoothSumBandshape[polarIndex][i]/countBandshape[polarIndex][i];	
+			mean=sumBandshape[polarIndex][i]/countBandshape[polarIndex][i];	
+			rms=sqrt((squareBandshape[polarIndex][i]/countBandshape[polarIndex][i])-pow(mean,2));	
+		}		
+		else
+		{
+			sMean=0;
+			mean=0;
+			rms=-1;
+		}
+		meanFile<<i<<" "<<sMean*cumBandshapeScale<<" "<<mean*cumBandshapeScale<<" "<<rms*cumBandshapeScale<<endl;	
+			
+	}
+	meanFile.close();
+}
+
+/*******************************************************************
+*FUNCTION: void BasicAnalysis::writeBandshape(char* filename)
+*char* filename: Name of the file to which mean bandshape will 
+*be written out.
+*Writes out the mean bandshape (for current block)
+*to the specified file.
+*******************************************************************/
+void BasicAnalysis::writeCurBandshape(const char* filename)
+{
+	ofstream meanFile;
+	meanFile.open(filename,ios::app);
+	meanFile<<blockLength<<" ";
+	if((int)info.bandshapeToUse==2 || info.doUseNormalizedData)
+		for(int i=0;i<info.noOfChannels;i++)
+		{			
+			if(smoothBandshape[i]==0)
+				meanFile<<0.0<<" ";	
+			else
+				meanFile<<bandshape[i]/smoothBandshape[i]<<" ";			
+		}	
+	else	
+		for(int i=0;i<info.noOfChannels;i++)
+		{			
+				meanFile<<bandshape[i]<<" ";				
+		}	
+	
+	meanFile<<endl;
+	meanFile.close();
+}
+
+//implementation of BasicAnalysis methods ends
+
+/*******************************************************************
+CLASS: StreamingQuantile
+*Estimates a quantile of a data stream with the P-square algorithm
+*(Jain & Chlamtac 1985). Five markers are kept and moved with piecewise
+*parabolic interpolation, so each sample costs O(1) time and no samples
+*are stored. To follow slow changes of the data the marker positions
+*are rescaled once more than windowLength samples have been seen, which
+*limits the weight of old data to about windowLength samples.
+*******************************************************************/
+class StreamingQuantile
+{
+	public:
+	long int	count;			//Number of samples added
+	
+	StreamingQuantile(float _p,long int _windowLength);
+	void add(float x);						//Adds a sample to the estimate
+	float quantile();						//Current estimate of the quantile
+	private:
+	float		p;			//Quantile to estimate (0 to 1)
+	long int	windowLength;		//Number of samples after which the marker positions are rescaled
+	double		height[5];		//Marker heights
+	double		position[5];		//Actual marker positions
+	double		desiredPosition[5];	//Desired marker positions
+	double		increment[5];		//Increments of the desired marker positions per sample
+	double parabolic(int i,int d);
+	double linear(int i,int d);
+};
+//implementation of StreamingQuantile methods
+
+/*******************************************************************
+*CONSTRUCTOR: StreamingQuantile::StreamingQuantile(float _p,long int _windowLength)
+*float _p		: quantile to estimate (0.5 for median)
+*long int _windowLength	: effective number of samples remembered
+*******************************************************************/
+StreamingQuantile::StreamingQuantile(float _p,long int _windowLength)
+{
+	p=_p;
+	windowLength=(_windowLength>5)?_windowLength:5;
+	count=0;
+	increment[0]=0;
+	increment[1]=p/2.0;
+	increment[2]=p;
+	increment[3]=(1.0+p)/2.0;
+	increment[4]=1;
+}
+/*******************************************************************
+*FUNCTION: void StreamingQuantile::add(float x)
+*Adds sample x and adjusts the markers.
+*******************************************************************/
+void StreamingQuantile::add(float x)
+{
+	int k;
+	if(count<5)
+	{
+		//The first five samples are kept sorted as the initial markers
+		for(k=count;k>0 && height[k-1]>x;k--)
+			height[k]=height[k-1];
+		height[k]=x;
+		count++;
+		if(count==5)
+		{
+			for(int i=0;i<5;i++)
+				position[i]=i+1;
+			desiredPosition[0]=1;
+			desiredPosition[1]=1+2*p;
+			desiredPosition[2]=1+4*p;
+			desiredPosition[3]=3+2*p;
+			desiredPosition[4]=5;
+		}
+		return;
+	}
+	//Finds the cell containing x
+	if(x<height[0])
+	{
+		height[0]=x;
+		k=0;
+	}
+	else if(x>=height[4])
+	{
+		height[4]=x;
+		k=3;
+	}
+	else
+		for(k=0;k<3 && x>=height[k+1];k++);
+	for(int i=k+1;i<5;i++)
+		position[i]++;
+	for(int i=0;i<5;i++)
+		desiredPosition[i]+=increment[i];
+	//Moves the middle markers towards their desired positions
+	for(int i=1;i<4;i++)
+	{
+		double delta=desiredPosition[i]-position[i];
+		if((delta>=1 && position[i+1]-position[i]>1) || (delta<=-1 && position[i-1]-position[i]<-1))
+		{
+			int d=(delta>0)?1:-1;
+			double h=parabolic(i,d);
+			if(height[i-1]<h && h<height[i+1])
+				height[i]=h;
+			else
+				height[i]=linear(i,d);
+			position[i]+=d;
+		}
+	}
+	count++;
+	//Rescales positions so that old samples lose weight
+	if(position[4]>2*windowLength)
+		for(int i=0;i<5;i++)
+		{
+			position[i]=1+(position[i]-1)/2.0;
+			desiredPosition[i]=1+(desiredPosition[i]-1)/2.0;
+		}
+}
+/*******************************************************************
+*FUNCTION: double StreamingQuantile::parabolic(int i,int d)
+*FUNCTION: double StreamingQuantile::linear(int i,int d)
+*Piecewise parabolic and linear predictions of the height of marker i
+*moved by d (+1 or -1) positions.
+*******************************************************************/
+double StreamingQuantile::parabolic(int i,int d)
+{
+	return height[i]+d/(position[i+1]-position[i-1])*((position[i]-position[i-1]+d)*(height[i+1]-height[i])/(position[i+1]-position[i])
+		+(position[i+1]-position[i]-d)*(height[i]-height[i-1])/(position[i]-position[i-1]));
+}
+double StreamingQuantile::linear(int i,int d)
+{
+	return height[i]+d*(height[i+d]-height[i])/(position[i+d]-position[i]);
+}
+/*******************************************************************
+*FUNCTION: float StreamingQuantile::quantile()
+*Returns the current estimate. With less than five samples the nearest
+*order statistic of the samples seen is returned.
+*******************************************************************/
+float StreamingQuantile::quantile()
+{
+	if(count==0)
+		return 0;
+	if(count<5)
+		return height[(int)(p*(count-1)+0.5)];
+	return height[2];
+}
+//implementation of StreamingQuantile methods ends
+
+/*******************************************************************
+CLASS: RFIFiltering
+*Handles detecting and flagging Radio Frequency Interference (RFI) in
+*input data.
+*Contains methods to find the central tendency as well as the rms of 
+*the current block. Can be expanded to include multiple algorithms
+*to do so.
+*It also generates and writes flags.
+*******************************************************************/
+class RFIFiltering
+{
+	
+	public:
+	float histogramInterval;
+	float*	input;			//Input array from which outliers are to be detected
+	int	inputSize;		//Size of input array
+	float	inputMax;		//Maximum and minimum elements of the array. Used by certain algorithms.
+	float	inputMin;		
+	float	centralTendency;	//Computed central tendency of the input data.
+	float	rms;			//Computer rms of the input data.
+	float	cutoff;			//Threshold above which samples are flagged.
+	float	cutoffToRms;		//Threshold to rms ratio.
+	char*	flags;			//Array where flags are stored. 1 implies outlier. 0 implies normal.
+	float*  sFlags;
+	//These variables are used when histogram based filtering is done
+	static const int maxHistogramSize=1024;	//Cap on the number of bins
+	float*	histogram;		//Points to histogramBins once computed
+	float*	histogramAxis;
+	int 	histogramSize;
+	int	histogramMax;
+	float	histogramOrigin;	//Lower edge of the bins when the range of the data exceeds the cap (from the previous block)
+	float	histogramBins[maxHistogramSize];
+	float	histogramAxisBins[maxHistogramSize];
+	//These variables are used when streaming quartile based filtering is done
+	StreamingQuantile** quartiles;	//Estimators of the 25%, 50% and 75% quantiles of previous blocks
+	
+	
+	RFIFiltering(float* input_,int inputSize_);			//Constructor	
+	~RFIFiltering();						//Destructor
+	void computeStatistics(int algorithmCode);			//Wrapper to call appropiate function to find the central tendency and rms
+	void smoothFlags(int windowLength,float threshold);
+	void flagData();						//Function to generate flags once rms and central tendency has been found
+	void multiPointFlagData(float* multiCutoff,int nPoints);	//Flags runs of 1 to nPoints samples above the multi point cutoffs
+	void generateBlankFlags();					//Generates blank flags in case of no flagging
+	void writeFlags(const char* fileName);				//Writes out flags to a file
+	void writeFlags(const char* filename,char* startFlags,int nStartFlags,char* endFlags,int nEndFlags); //Writes out flags to a file with startFlags and endFlags appeneded at the beginning and end respectively.
+	void generateManualFlags(int nBadChanBlocks,int* badChanBlocks,int offset);	//flags user specified blocks
+	private:
+	void histogramBased();						//Finds mode for central tendency and rms based on finding the distribution
+	void MADBased();						//Finds median for central tendency and median absolute deviation for rms
+	void streamingBased();						//Takes median and interquartile range from streaming estimators
+	float median(float* x,long int n);				//Median of x by selection in expected linear time (reorders x)
+	float* copyToScratch();						//Copies input to scratch for median()
+	float*	scratch;		//Scratch copy of input used by median(), allocated on first use
+	
+};
+//implementation of RFIFiltering methods
+
+/*******************************************************************
+*CONSTRUCTOR: RFIFiltering::RFIFiltering(float* input_,int inputSize_)
+*float* input_  : Array from which outliers are to be detected.
+*int inputSize_ : Size of the input array
+*******************************************************************/
+RFIFiltering::RFIFiltering(float* input_,int inputSize_)
+{
+	input=input_;
+	inputSize=inputSize_;
+	flags=new char[inputSize];
+	sFlags=new float[inputSize];
+	histogram=NULL;
+	histogramAxis=NULL;
+	histogramOrigin=0;
+	quartiles=NULL;
+	scratch=NULL;
+	generateBlankFlags();  	
+}
+
+
+/*******************************************************************
+*DESTRUCTOR: RFIFiltering::~RFIFiltering()
+*frees used memory
+*******************************************************************/
+RFIFiltering::~RFIFiltering()
+{
+	delete[] flags;
+	delete[] sFlags;
+	if(scratch!=NULL)
+		delete[] scratch;
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::computeStatistics(int algorithmCode)
+*int algorithmCode: algorithm to use 
+*Wrapper to select algorithm to find central tendency and rms.
+*******************************************************************/
+void RFIFiltering::computeStatistics(int algorithmCode)
+{
+	switch(algorithmCode)
+	{
+		case 1:
+			histogramBased();
+			break;
+		case 2:
+			MADBased();
+			break;
+		case 3:
+			streamingBased();
+			break;
+	}
+}
+/*******************************************************************
+*FUNCTION: float RFIFiltering::median(float* x,long int n)
+*Finds the median of n elements of x using introselect (nth_element),
+*which runs in expected linear time. For even n the lower middle element is the
+*largest element left of the upper one after selection. x is reordered.
+*******************************************************************/
+float RFIFiltering::median(float* x,long int n)
+{
+	float* upper=x+n/2;
+	std::nth_element(x,upper,x+n);
+	if(n%2==0)
+		return (*std::max_element(x,upper)+(*upper))/2.0;
+	else
+		return *upper;
+}
+/*******************************************************************
+*FUNCTION: float* RFIFiltering::copyToScratch()
+*Copies input to the scratch array and returns it. The scratch array
+*is allocated on first use and freed with the object.
+*******************************************************************/
+float* RFIFiltering::copyToScratch()
+{
+	if(scratch==NULL)
+		scratch=new float[inputSize];
+	memcpy(scratch,input,inputSize*sizeof(float));
+	return scratch;
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::MADBased()
+*Median Absolute Deviation (MAD) based algorithm to calculate
+*mean and rms of the underlying gaussian from which the dataset 
+*is derived. It uses median to estimate the central tendency and
+*MAD to estimate the variance. 
+*******************************************************************/
+void RFIFiltering::MADBased()
+{
+	/*The input is copied to a scratch array for selection.
+	*This is done to avoid scrambling the original array 
+	*which may be in use by other objects.*/
+	float *tempInput=copyToScratch();
+	float *ptrTempInput;
+
+	centralTendency=median(tempInput,inputSize);
+	ptrTempInput=tempInput;
+	//Deviations from the median is calculated and its median used to estimate rms
+	for(long int i=0;i<inputSize;i++,ptrTempInput++)
+		*ptrTempInput=fabs(*ptrTempInput-centralTendency);
+	rms=median(tempInput,inputSize);
+	rms=rms*1.4826;
+	cutoff=rms*cutoffToRms;
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::streamingBased()
+*Streaming algorithm to calculate mean and rms. The median and the 
+*interquartile range are read from the streaming quartile estimators, 
+*which hold the data of previous blocks, so no per block sorting or 
+*binning is needed. For gaussian data rms=IQR/1.349. Until the 
+*estimators have seen a block worth of samples MADBased() is used.
+*******************************************************************/
+void RFIFiltering::streamingBased()
+{
+	if(quartiles==NULL || quartiles[0]->count<inputSize)
+	{
+		MADBased();
+		return;
+	}
+	centralTendency=quartiles[1]->quantile();
+	rms=(quartiles[2]->quantile()-quartiles[0]->quantile())/1.349;
+	cutoff=rms*cutoffToRms;
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::histogramBased()
+*This algorithm bins datapoints to form a histogram of size histogramSize.
+*It then uses the modal point of the histogram to estimate the central 
+*tendency and then uses it along with the width at half maximum to find
+*variance.
+*The number of bins is capped at maxHistogramSize and the bins live in
+*the object, so the cost is fixed and nothing is allocated. If the data
+*range needs more bins (e.g. because of a strong outlier) the bins are 
+*laid around the mode of the previous block (histogramOrigin), samples
+*outside fall in under/overflow bins. If the mode has moved out of that
+*range the bins are re-centred on the median of the block. The half-
+*maximum search stops at the ends of the histogram.
+*******************************************************************/
+void RFIFiltering::histogramBased()
+{	
+	float interval,origin;
+	int modeHeight,modeIndex;
+	int p;
+	int counts[4*(maxHistogramSize+2)];
+	interval=histogramInterval;
+	float range=(inputMax-inputMin)/interval;
+	if(range<maxHistogramSize-1)
+	{
+		histogramSize=(int)range+1;
+		origin=inputMin;
+	}
+	else
+	{
+		histogramSize=maxHistogramSize;
+		origin=histogramOrigin;
+	}
+	for(int pass=0;pass<2;pass++)
+	{
+		memset(counts,0,4*(histogramSize+2)*sizeof(int));
+		binSamples(input,inputSize,origin,interval,histogramSize,counts);	//Computing histogram
+		int stride=histogramSize+2;
+		for (int i=0;i<histogramSize;i++)
+			histogramBins[i]=counts[i+1]+counts[stride+i+1]+counts[2*stride+i+1]+counts[3*stride+i+1];
+		histogram=histogramBins;
+		modeHeight=0;
+		modeIndex=0;
+		//finding modal point
+		for (int i=0;i<histogramSize;i++)
+		{
+			if(histogram[i]>modeHeight)
+			{
+				modeHeight=histogram[i];
+				modeIndex=i;
+			}
+		}
+		if(histogramSize<maxHistogramSize || pass==1 || (modeHeight>0 && modeIndex>0 && modeIndex<histogramSize-1))
+			break;
+		//The mode is not inside the bins of the previous block: re-centre them on the median
+		origin=median(copyToScratch(),inputSize)-(histogramSize/2)*interval;
+	}
+	if(modeHeight==0) 
+		return;
+	histogramMax=modeHeight;
+	p=0;	
+	while(modeIndex+p<histogramSize && histogram[modeIndex+p]>=histogram[modeIndex]/2.0) //finding index of half on the right
+		p++;
+	int q=0;
+	while(modeIndex+q>=0 && histogram[modeIndex+q]>=histogram[modeIndex]/2.0) //finding index of half on the left
+		q--;
+	
+	centralTendency=(modeIndex+0.5)*interval+origin;
+	/*rms=(p*interval)/(sqrt(2*log(histogram[modeIndex]/(float)histogram[modeIndex+p])));
+	rms+=(p*interval)/(sqrt(2*log(histogram[modeIndex]/(float)histogram[modeIndex-p])));
+	rms/=2.0;*/
+	rms=(p-q)*interval/2.355;
+	histogramAxis=histogramAxisBins;
+	for (int i=0;i<histogramSize;i++)
+		histogramAxis[i]=(i*interval+origin-centralTendency)/rms;
+	
+	cutoff=rms*cutoffToRms;
+	histogramInterval=(4.0*rms)/(pow(inputSize,1/3.0));	
+	histogramOrigin=centralTendency-(maxHistogramSize/2)*histogramInterval;
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::smoothFlags()
+*Generates a smooth version of the flags
+*The fraction of flagged samples in a window of windowLength around 
+*each sample is found from a running prefix sum of the flags, and all 
+*samples within half a window of a sample below threshold are flagged
+*using a difference array. Both passes are O(n) in the window length.
+*******************************************************************/
+void RFIFiltering::smoothFlags(int windowLength,float threshold)
+{
+	float* ptrSmoothFlags;
+	char* ptrFlags;
+	int* counts=new int[inputSize+1];		//prefix sum of flags, later the difference array of the dilation
+	int* ptrCounts;
+	int s=windowLength/2;
+	int sum;
+	
+	ptrFlags=flags;
+	ptrCounts=counts;
+	*ptrCounts=0;
+	for(int i=0;i<inputSize;i++,ptrFlags++,ptrCounts++)
+		*(ptrCounts+1)=(*ptrCounts)+(*ptrFlags);
+	ptrSmoothFlags=sFlags;
+	for(int i=0;i<inputSize;i++,ptrSmoothFlags++)
+	{
+		int first=(i-s<0)?0:i-s;
+		int last=(i+s+1>inputSize)?inputSize:i+s+1;
+		*ptrSmoothFlags=1.0-((float)(counts[last]-counts[first])/(last-first));
+	}
+	
+	ptrCounts=counts;
+	for(int i=0;i<=inputSize;i++,ptrCounts++)
+		*ptrCounts=0;
+	ptrSmoothFlags=sFlags;
+	for(int i=0;i<inputSize;i++,ptrSmoothFlags++)
+	{
+		if(*ptrSmoothFlags<threshold)
+		{
+			counts[(i-s<0)?0:i-s]++;
+			counts[(i+s+1>inputSize)?inputSize:i+s+1]--;
+		}
+	}
+	ptrFlags=flags;
+	ptrCounts=counts;
+	sum=0;
+	for(int i=0;i<inputSize;i++,ptrFlags++,ptrCounts++)
+	{
+		sum+=(*ptrCounts);
+		if(sum>0)
+			*ptrFlags=1;
+	}
+	delete[] counts;
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::generateManualFlags(int nBadChanBlocks,int* badChanBlocks)
+*Flags blocks specified by user (usually blocks of channels)
+*******************************************************************/
+void RFIFiltering::generateManualFlags(int nBadChanBlocks,int* badChanBlocks,int offset)
+{
+	for(int i=0;i<nBadChanBlocks;i++)
+	{		
+		for(int j=badChanBlocks[i*2];j<badChanBlocks[i*2+1];j++)
+		{	
+			if(j-offset<0 or j-offset>=inputSize)	
+				continue;	
+			flags[j-offset]=1;
+		}
+	}
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::generateBlankFlags()
+*In cases when an array containing blank flags (all zeroes,no flagging)
+*is required by other functions.
+*******************************************************************/
+void RFIFiltering::generateBlankFlags()
+{
+	float* ptrInput;
+	char* ptrFlags;
+	ptrFlags=flags;	 
+	for(int i=0;i< inputSize;i++,ptrFlags++)
+	       *ptrFlags=0;	
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::generateBlankFlags()
+*Flagging of data based on its deviation from central tendency being
+*above a certain threshold.
+*******************************************************************/
+void RFIFiltering::flagData()
+{
+	float* ptrInput;
+	char* ptrFlags;
+	ptrInput=input;
+	ptrFlags=flags;
+	for(int i=0;i< inputSize;i++,ptrInput++,ptrFlags++)
+	{
+		if(fabs(*ptrInput-centralTendency)>cutoff)
+			*ptrFlags=1;
+	}
+}
+/*******************************************************************
+*FUNCTION: void RFIFiltering::multiPointFlagData(float* multiCutoff,int nPoints)
+*float* multiCutoff	: k-point cutoff to rms ratios, k=1..nPoints 
+*			  (see Information::calculateCutoff())
+*int nPoints		: longest run of samples tested
+*Flags every run of at least k consecutive samples whose deviations
+*from the central tendency all exceed multiCutoff[k-1]*rms, for 
+*k=1..nPoints. A weak burst spanning several samples is caught at a
+*lower cutoff than a single sample with the same false alarm rate.
+*Each k is one pass over run lengths, so the cost is O(n*nPoints).
+*******************************************************************/
+void RFIFiltering::multiPointFlagData(float* multiCutoff,int nPoints)
+{
+	float* deviation=new float[inputSize];
+	int* runs=new int[inputSize];
+	memset(flags,0,inputSize);
+	absoluteDeviation(input,inputSize,centralTendency,deviation);
+	for(int k=1;k<=nPoints;k++)
+		flagLongRuns(deviation,inputSize,multiCutoff[k-1]*rms,k,runs,flags);
+	delete[] deviation;
+	delete[] runs;
+}
+
+/*******************************************************************
+*FUNCTION: void RFIFiltering::writeFlags(const char* filename)
+*const char* filename: Name of file to which flags are written.
+*******************************************************************/
+void RFIFiltering::writeFlags(const char* filename)
+{
+	FILE* flagFile;    
+    	flagFile = fopen(filename, "ab");
+        fwrite(flags, sizeof(char), inputSize, flagFile);    
+    	fclose(flagFile);    	
+}
+
+/*******************************************************************
+*FUNCTION: void RFIFiltering::writeFlags(const char* filename)
+*const char* filename: Name of file to which flags are written.
+*char* startFlags: Initial flags at the beginning 
+*int nStartFlags: number of flags (1s) to write before flags
+*char* endFlags: flags appeneded at the end
+*int nEndFlags: number of flags (1s) to write after flags
+*This is used to write channel flag file where some channels
+*at the start and the end have been marked bad by the user. 
+*******************************************************************/
+void RFIFiltering::writeFlags(const char* filename,char* startFlags,int nStartFlags,char* endFlags,int nEndFlags)
+{
+	FILE* flagFile;    
+    	flagFile = fopen(filename, "ab");
+	fwrite(startFlags, sizeof(char), nStartFlags, flagFile);    
+        fwrite(flags, sizeof(char), inputSize, flagFile);  
+	fwrite(endFlags, sizeof(char), nEndFlags, flagFile);     
+    	fclose(flagFile);    	
+}
+
+
+//implementation of RFIFiltering methods ends
+
+/*******************************************************************
+CLASS: ChannelMaskLibrary
+*Persistent per band record of how often each channel is flagged.
+*The same channel ranges (mobile, satellite bands) are flagged in 
+*every block of every observation at GMRT. The library keeps, for
+*each channel, the number of blocks in which the statistical channel
+*flagging marked it and the number of blocks seen, over runs on the 
+*same band (lowest frequency, bandwidth, number of channels and 
+*sideband). Channels flagged in more than info.channelMaskOccupancy 
+*of the blocks are masked from the start of the run.
+*The counts are updated from the statistical flags only (before the
+*library and manual masks are applied), so a channel that has become
+*clean is unmasked in later runs.
+*******************************************************************/
+class ChannelMaskLibrary
+{
+	public:
+	Information info;
+	string	fileName;			//Library file of the band
+	double*	flaggedBlocks;			//Number of blocks in which each channel was flagged
+	double*	totalBlocks;			//Number of blocks seen by each channel
+	char*	mask;				//1-> channel (from startChannel) is masked by the library
+	int	nMasked;			//Number of masked channels
+	static const int minBlocks=20;		//Blocks a channel must have been seen in before it can be masked
+	static const int memoryBlocks=20000;	//Counts are scaled down beyond this many blocks so old runs fade out
+	
+	ChannelMaskLibrary(Information info_);
+	~ChannelMaskLibrary();
+	void update(char* flags);		//Adds the statistical channel flags of a block
+	void applyMask(char* flags);		//Marks the masked channels in the channel flags of a block
+	void write();				//Writes the library back to its file
+};
+/*******************************************************************
+*FUNCTION: ChannelMaskLibrary::ChannelMaskLibrary(Information info_)
+*Locates the library file of the band in $GPTOOL_CHANMASK_PATH (or the
+*current directory), loads it if it exists and builds the mask.
+*******************************************************************/
+ChannelMaskLibrary::ChannelMaskLibrary(Information info_)
+{
+	info=info_;
+	char* path=getenv("GPTOOL_CHANMASK_PATH");
+	ostringstream name;
+	if(path!=NULL)
+		name<<path<<"/";
+	name<<"chanmask_"<<info.lowestFrequency<<"_"<<info.bandwidth<<"_"<<info.noOfChannels<<"_"<<(int)info.sidebandFlag<<".gpt";
+	fileName=name.str();
+	flaggedBlocks=new double[info.noOfChannels];
+	totalBlocks=new double[info.noOfChannels];
+	mask=new char[info.stopChannel-info.startChannel];
+	for(int j=0;j<info.noOfChannels;j++)
+		flaggedBlocks[j]=totalBlocks[j]=0;
+	ifstream libraryFile(fileName.c_str(),ios::in);
+	string line;
+	while(getline(libraryFile,line))
+	{
+		if(line.length()==0 || line[0]=='#')
+			continue;
+		istringstream fields(line);
+		int channel;
+		double flagged,total;
+		if(!(fields>>channel>>flagged>>total) || channel<0 || channel>=info.noOfChannels)
+			continue;
+		flaggedBlocks[channel]=flagged;
+		totalBlocks[channel]=total;
+	}
+	nMasked=0;
+	for(int j=0;j<info.stopChannel-info.startChannel;j++)
+	{
+		int channel=j+info.startChannel;
+		mask[j]=(totalBlocks[channel]>=minBlocks && flaggedBlocks[channel]>info.channelMaskOccupancy*totalBlocks[channel]);
+		nMasked+=mask[j];
+	}
+}
+ChannelMaskLibrary::~ChannelMaskLibrary()
+{
+	delete[] flaggedBlocks;
+	delete[] totalBlocks;
+	delete[] mask;
+}
+/*******************************************************************
+*FUNCTION: void ChannelMaskLibrary::update(char* flags)
+*char* flags : statistical channel flags of a block (from startChannel)
+*Called from the parallel channel tasks, hence the atomic updates.
+*******************************************************************/
+void ChannelMaskLibrary::update(char* flags)
+{
+	double* ptrFlaggedBlocks=flaggedBlocks+info.startChannel;
+	double* ptrTotalBlocks=totalBlocks+info.startChannel;
+	for(int j=0;j<info.stopChannel-info.startChannel;j++,ptrFlaggedBlocks++,ptrTotalBlocks++)
+	{
+		if(flags[j])
+		{
+			#pragma omp atomic
+			(*ptrFlaggedBlocks)++;
+		}
+		#pragma omp atomic
+		(*ptrTotalBlocks)++;
+	}
+}
+/*******************************************************************
+*FUNCTION: void ChannelMaskLibrary::applyMask(char* flags)
+*char* flags : channel flags of a block (from startChannel)
+*******************************************************************/
+void ChannelMaskLibrary::applyMask(char* flags)
+{
+	for(int j=0;j<info.stopChannel-info.startChannel;j++)
+		flags[j]|=mask[j];
+}
+/*******************************************************************
+*FUNCTION: void ChannelMaskLibrary::write()
+*Writes the counts back to the library file. Counts of channels seen
+*in more than memoryBlocks blocks are scaled down to memoryBlocks so 
+*that the library follows changes in the RFI environment.
+*******************************************************************/
+void ChannelMaskLibrary::write()
+{
+	ofstream libraryFile(fileName.c_str(),ios::out | ios::trunc);
+	if(libraryFile.fail())
+	{
+		cout<<"Cannot write channel mask library "<<fileName<<endl;
+		return;
+	}
+	libraryFile<<"#gptool channel mask library"<<endl;
+	libraryFile<<"#lowest frequency "<<info.lowestFrequency<<" MHz, bandwidth "<<info.bandwidth<<" MHz, "<<info.noOfChannels<<" channels, sideband flag "<<(int)info.sidebandFlag<<endl;
+	libraryFile<<"#channel\tflagged_blocks\ttotal_blocks"<<endl;
+	for(int j=0;j<info.noOfChannels;j++)
+	{
+		if(totalBlocks[j]>memoryBlocks)
+		{
+			flaggedBlocks[j]*=memoryBlocks/totalBlocks[j];
+			totalBlocks[j]=memoryBlocks;
+		}
+		libraryFile<<j<<"\t"<<flaggedBlocks[j]<<"\t"<<totalBlocks[j]<<endl;
+	}
+	libraryFile.close();
+}
+
+
+/*******************************************************************
+CLASS: SnapshotBuffer
+*Ring buffer of the last info.snapshotBufferSec seconds of filtered 2-D
+*data of the first polarization (16-bit, scaled by the mean value of
+*the filtered output). A trigger asks for the window around an event
+*to be dumped as a SIGPROC filterbank file. The window of a single 
+*pulse candidate covers the dispersion sweep across the band at its DM
+*on either side of the pulse plus its width, it is dumped once all of
+*it has been added (or at the end of the run). Triggers with windows 
+*that overlap are dumped together. SIGUSR1 dumps the whole buffer.
+*Triggers and dumps are handled on the I/O thread, blocks must be
+*added in order.
+*******************************************************************/
+struct SnapshotTrigger
+{
+	long long int	firstSample;	//First time sample of the window
+	long long int	lastSample;	//Last time sample of the window
+	float		dm;		//DM of the brightest event of the window (-1 for external triggers)
+	float		snr;		//S/N of the brightest event of the window
+};
+class SnapshotBuffer
+{
+	public:
+	Information info;
+	long int		length;		//Number of time samples the buffer holds
+	short int*		data;		//Last length time samples of filtered 2-D data (circular, time major)
+	long long int		endSample;	//Number of time samples added so far
+	vector<SnapshotTrigger>	pending;	//Triggers waiting for the end of their window
+	int			nDumps;		//Number of filterbank files written
+	
+	SnapshotBuffer(Information info_);
+	~SnapshotBuffer();
+	void add(short int* block,long int blockLength);	//Adds a block of filtered 2-D data
+	void trigger(long long int sample,int width,float dm,float snr);	//Triggers on a pulse
+	void triggerAll();			//Triggers on the whole buffer
+	void dumpReady(char flush);		//Dumps the triggers with complete windows (all of them if flush)
+	
+	private:
+	void addTrigger(SnapshotTrigger trigger);
+	void dump(SnapshotTrigger trigger);
+	void writeHeaderString(ofstream& file,const char* value);
+};
+/*******************************************************************
+*FUNCTION: SnapshotBuffer::SnapshotBuffer(Information info_)
+*******************************************************************/
+SnapshotBuffer::SnapshotBuffer(Information info_)
+{
+	info=info_;
+	length=(long int)(info.snapshotBufferSec/info.samplingInterval+0.5);
+	if(length<info.blockSizeSamples)
+		length=info.blockSizeSamples;
+	data=new short int[length*info.noOfChannels];
+	endSample=0;
+	nDumps=0;
+}
+/*******************************************************************
+*DESTRUCTOR: SnapshotBuffer::~SnapshotBuffer()
+*Dumps the triggers still waiting with the data there is.
+*******************************************************************/
+SnapshotBuffer::~SnapshotBuffer()
+{
+	dumpReady(1);
+	delete[] data;
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::add(short int* block,long int blockLength)
+*short int* block	:Filtered 2-D data of the block
+*long int blockLength	:Number of time samples of the block
+*******************************************************************/
+void SnapshotBuffer::add(short int* block,long int blockLength)
+{
+	int nChannels=info.noOfChannels;
+	for(long int i=0;i<blockLength;)
+	{
+		long int pos=(endSample+i)%length;
+		long int n=(length-pos<blockLength-i)?length-pos:blockLength-i;
+		memcpy(&data[pos*nChannels],&block[i*nChannels],n*nChannels*sizeof(short int));
+		i+=n;
+	}
+	endSample+=blockLength;
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::trigger(long long int sample,int width,float dm,float snr)
+*long long int sample	:First time sample of the pulse
+*int width		:Width of the pulse in time samples
+*float dm		:DM of the pulse
+*float snr		:S/N of the pulse
+*******************************************************************/
+void SnapshotBuffer::trigger(long long int sample,int width,float dm,float snr)
+{
+	double highestFrequency=info.lowestFrequency+info.bandwidth;
+	long int sweep=(long int)ceil(4.148808*pow(10,3)*dm*(1.0/pow(info.lowestFrequency,2)-1.0/pow(highestFrequency,2))/info.samplingInterval);
+	SnapshotTrigger trigger;
+	trigger.firstSample=sample-sweep-width;
+	trigger.lastSample=sample+sweep+2*width-1;
+	trigger.dm=dm;
+	trigger.snr=snr;
+	addTrigger(trigger);
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::triggerAll()
+*******************************************************************/
+void SnapshotBuffer::triggerAll()
+{
+	SnapshotTrigger trigger;
+	trigger.firstSample=endSample-length;
+	trigger.lastSample=endSample-1;
+	trigger.dm=-1;
+	trigger.snr=0;
+	addTrigger(trigger);
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::addTrigger(SnapshotTrigger trigger)
+*Merges the trigger into a waiting one it overlaps with.
+*******************************************************************/
+void SnapshotBuffer::addTrigger(SnapshotTrigger trigger)
+{
+	if(trigger.firstSample<0)
+		trigger.firstSample=0;
+	for(unsigned int k=0;k<pending.size();k++)
+	{
+		if(trigger.firstSample>pending[k].lastSample+1 || trigger.lastSample+1<pending[k].firstSample)
+			continue;
+		pending[k].firstSample=(trigger.firstSample<pending[k].firstSample)?trigger.firstSample:pending[k].firstSample;
+		pending[k].lastSample=(trigger.lastSample>pending[k].lastSample)?trigger.lastSample:pending[k].lastSample;
+		if(trigger.snr>pending[k].snr)
+		{
+			pending[k].dm=trigger.dm;
+			pending[k].snr=trigger.snr;
+		}
+		return;
 	}
-	delete[] ptrSplittedRawData;
+	pending.push_back(trigger);
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::dumpReady(char flush)
+*char flush	:1-> triggers are dumped even if their window is not
+*		 complete (end of run)
+*******************************************************************/
+void SnapshotBuffer::dumpReady(char flush)
+{
+	for(unsigned int k=0;k<pending.size();)
+	{
+		if(flush || pending[k].lastSample<endSample)
+		{
+			dump(pending[k]);
+			pending.erase(pending.begin()+k);
+		}
+		else
+			k++;
+	}
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::writeHeaderString(ofstream& file,const char* value)
+*Writes a string the way SIGPROC headers store them (length, then the
+*characters).
+*******************************************************************/
+void SnapshotBuffer::writeHeaderString(ofstream& file,const char* value)
+{
+	int len=strlen(value);
+	file.write((char*)&len,sizeof(int));
+	file.write(value,len);
+}
+/*******************************************************************
+*FUNCTION: void SnapshotBuffer::dump(SnapshotTrigger trigger)
+*Writes the part of the window still in the buffer to 
+*snapshot_<n>.fil and lists it in snapshots.gpt. Channels are in the
+*order of the input, with a positive channel offset if the first 
+*channel is of the lowest frequency.
+*******************************************************************/
+void SnapshotBuffer::dump(SnapshotTrigger trigger)
+{
+	long long int firstSample=(trigger.firstSample<endSample-length)?endSample-length:trigger.firstSample;
+	long long int lastSample=(trigger.lastSample>=endSample)?endSample-1:trigger.lastSample;
+	if(firstSample<0)
+		firstSample=0;
+	if(lastSample<firstSample)
+		return;
+	int nChannels=info.noOfChannels;
+	double channelWidth=info.bandwidth/info.noOfChannels;
+	double fch1,foff;
+	if(info.sidebandFlag==1)
+	{
+		fch1=info.lowestFrequency+channelWidth/2.0;
+		foff=channelWidth;
+	}
+	else
+	{
+		fch1=info.lowestFrequency+info.bandwidth-channelWidth/2.0;
+		foff=-channelWidth;
+	}
+	double tstart=info.MJDObs+(info.startBlockIndex*info.blockSizeSec+firstSample*info.samplingInterval)/86400.0;
+	
+	nDumps++;
+	ostringstream filename;
+	filename<<"snapshot_"<<nDumps<<".fil";
+	ofstream file(filename.str().c_str(),ios::out | ios::binary | ios::trunc);
+	if(file.fail())
+	{
+		cout<<"Cannot write snapshot "<<filename.str()<<endl;
+		return;
+	}
+	int intValue;
+	writeHeaderString(file,"HEADER_START");
+	writeHeaderString(file,"rawdatafile");
+	writeHeaderString(file,info.doReadFromFile?info.filepath:"shm");
+	writeHeaderString(file,"source_name");
+	writeHeaderString(file,(info.pulsarName.length()>1)?info.pulsarName.substr(1).c_str():info.pulsarName.c_str());
+	writeHeaderString(file,"telescope_id");
+	intValue=7;	//GMRT
+	file.write((char*)&intValue,sizeof(int));
+	writeHeaderString(file,"data_type");
+	intValue=1;	//filterbank
+	file.write((char*)&intValue,sizeof(int));
+	writeHeaderString(file,"fch1");
+	file.write((char*)&fch1,sizeof(double));
+	writeHeaderString(file,"foff");
+	file.write((char*)&foff,sizeof(double));
+	writeHeaderString(file,"nchans");
+	file.write((char*)&nChannels,sizeof(int));
+	writeHeaderString(file,"nbits");
+	intValue=16;
+	file.write((char*)&intValue,sizeof(int));
+	writeHeaderString(file,"nifs");
+	intValue=1;
+	file.write((char*)&intValue,sizeof(int));
+	writeHeaderString(file,"tstart");
+	file.write((char*)&tstart,sizeof(double));
+	writeHeaderString(file,"tsamp");
+	file.write((char*)&info.samplingInterval,sizeof(double));
+	writeHeaderString(file,"HEADER_END");
+	
+	//16-bit filterbank samples are unsigned
+	unsigned short* spectrum=new unsigned short[nChannels];
+	for(long long int i=firstSample;i<=lastSample;i++)
+	{
+		short int* ptrData=&data[(i%length)*nChannels];
+		for(int j=0;j<nChannels;j++,ptrData++)
+			spectrum[j]=(*ptrData<0)?0:*ptrData;
+		file.write((char*)spectrum,nChannels*sizeof(unsigned short));
+	}
+	delete[] spectrum;
+	file.close();
+	
+	ofstream logFile("snapshots.gpt",ios::app);
+	logFile<<filename.str()<<"\t"<<setprecision(15)<<tstart<<"\t"<<setprecision(6)<<firstSample<<"\t"<<lastSample-firstSample+1<<"\t";
+	if(trigger.dm<0)
+		logFile<<"external"<<endl;
+	else
+		logFile<<trigger.dm<<"\t"<<trigger.snr<<endl;
+	logFile.close();
+	cout<<"Snapshot "<<filename.str()<<" written"<<endl;
 }
-//End of AquireData implementation.
 
 /*******************************************************************
-*CLASS: BasicAnalysis
-*Performs basic operations like bandshape and zeroDM time series 
-*computation for a particular window and a particular polarization.
-*These quantities are then used by objects of RFIFiltering class 
-*to find and filter Radio Frequency Interference (RFI).
+CLASS: DMSearch
+*Dedisperses the data at a range of trial DMs in one pass with the 
+*Fast Dispersion Measure Transform (FDMT, Zackay & Ofek 2017).
+*The selected channels are put on a frequency axis of a power of two
+*number of channels (empty channels pad the top of the band). For 
+*every delay across a channel the channel is summed over that many 
+*samples, then adjacent subbands are merged pairwise log2(nSubbands) 
+*times: a delay across the merged subband is the sum of its lower half
+*at the delay across that half and its upper half, shifted by the same
+*delay, at the rest of the delay. All delays up to the highest one are
+*carried, so the cost per block is 
+*O(nSubbands*(length+nDelays)*log2(nSubbands)) instead of 
+*O(nChan*length*nTrials) for dedispersing each trial separately.
+*Trials are grouped by time scrunch factor and each group is 
+*transformed from data scrunched by its factor, so the number of
+*delays (and the memory, which goes as nDelays*(length+nDelays)) of a
+*transform stays small at high DMs.
+*The transform works on normalized data with the mean (1) subtracted
+*and flagged samples set to zero. Each block is transformed together
+*with the last nDelays-1 samples of the block before it, so that its
+*trial series are complete.
 *******************************************************************/
-class BasicAnalysis
+class DMSearch
 {
 	public:
-	//static variables:
-	
-	static	Information	info;			//contains all input parameters
-	static double**		smoothSumBandshape;	//Cumulative smooth bandshape for each polarization
-	static double** 	sumBandshape;		//Cumulative bandshapes for each polaization
-	static double**		squareBandshape;	//Cumulative square of bandshape for each polarization
-	static long long int** 	countBandshape;		//Number of sample that goes into each frequency bin (Cumulative) for each polaization
-	static float**		externalBandshape; 	//Externally loaded bandshape
-	long int		blockLength;	
-	
-	//variables:
-	float 			cumBandshapeScale;		//Used to scale down the cumulative bandshape to avoid overflow issues
-	int			polarIndex;			//Index of polarization to process.
-	float			*rawData;			//The 2D time-frequency data 	
-	short int	*filteredRawData;		//The Filtered 2D time-frequency data 
-	float			*zeroDM;			//Time series obtained by collapsing all frequency channels (Without dedispersion)
-	float			*zeroDMUnfiltered;		//Time series obtained by collapsing all frequency channels (Without dedispersion), without filtering
-	float			*bandshape;			//Mean bandshape obtained by collapsing all time samples.
-	float			*meanToRmsBandshape;		//Mean to rms computed for each channel. (rms of time series for that channel)
-	float			*smoothBandshape;		//smoothened bandshape obtained by moving mean or median
-	float			*normalizedBandshape;		//bandshape normalized using smoothBandshape.
-	float			*correlationBandshape;
-	char			*headerInfo;			//corresponding header information - used only in INLINE mode
-	//Minimum and maximum of each array. Used in plotting.	
-	float 		minZeroDM;		
-	float		maxZeroDM;
-	float		maxBandshape;
-	float		minBandshape;
-	float		maxMeanToRmsBandshape;
-	float		minMeanToRmsBandshape;
-	float		minNormalizedBandshape;
-	float		maxNormalizedBandshape;
-	int 		count;				//No of time series in current bandshape;
-	//Functions:
-	BasicAnalysis(Information _info);
-	BasicAnalysis(float* _rawData,int polarIndex_,long int _blockLength);
-	~BasicAnalysis();
-	void computeZeroDM(char* freqFlags);							//Computes zeroDM with given frequency flags
-	void computeBandshape();								//Computes bandshape
-	void computeBandshape(char* timeFlags);							//Computes bandshape with given time flags
-	void calculateCumulativeBandshapes();							//Computes the global cumulative bandshapes
-	void quicksort(float* x,long int first,long int last);					//Used to compute smooth bandshape using moving median 
-	void smoothAndNormalizeBandshape(); 							//Smoothens and normalizes the bandshape
-	void normalizeBandshape();								// Normalize bandshape using externally supplied file
-	void normalizeData();									//normalizes 2-D data
-	void getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue);	//gets Filtered Raw Data.
-	void getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags);
-	void subtractZeroDM(char* freqFlags,float centralTendency);
-	void writeBandshape(const char*  filename);						//Writes out the cumulative mean and rms a bandshape	
-	void writeCurBandshape(const char* filename);						//Writes out current bandshape
-	void writeFilteredRawData(const char*  filename);					//Writes out filtered 2D data
+		//Static variables:
+		static Information	info;			//contains all input parameters
+		static int		nSubbands;		//Number of channels of the transform (a power of two)
+		static double		lowestFrequency;	//Lower edge of the band of the transform in MHz
+		static double		highestFrequency;	//Upper edge of the band of the transform in MHz
+		static int		nTrials;		//Number of trial DMs
+		static int*		trialDelay;		//Delay across the band of each trial in samples
+		static int*		trialScrunch;		//Number of time samples added to each sample of the series of each trial
+		static double*		trialDM;		//DM of each trial
+		static int		nGroups;		//Number of groups of trials with the same scrunch factor
+		static int*		groupFirstTrial;	//First trial of each group (groupFirstTrial[nGroups]=nTrials)
+		static int*		groupDelays;		//Number of delays (in scrunched samples) computed for each group
+		static float***		tail;			//Last groupDelays-1 scrunched samples of the transform input of each group, one for each polarization
+		
+		//Variables:
+		int		polarIndex;		//Index of polarization to process
+		long int	length;			//Number of time samples of the block
+		float**		series;			//Dedispersed (and scrunched) time series of each trial
 		
+		//Functions:
+		DMSearch(Information info_);		//Constructor for first intialization
+		DMSearch(int polarIndex_,long int length_);	//constructor
+		~DMSearch();				//Destructor
+		void transform(float* rawData,char* timeFlags,char* freqFlags,char* sampleFlags);	//Computes the series of all trials for the block
+		void write(const char* filename);	//Writes out the series of all trials
+		static void writeTrials(const char* filename);	//Writes out the table of trials
+		
+		private:
+		void transformGroup(int group,float* channels);	//Computes the series of the trials of a group
+		static int subbandDelays(int nDelays,double startFrequency,double endFrequency);	//Number of delays carried for a subband
 };
-//implementation of BasicAnalysis methods begins
-//Declaration of static variables
-
-Information	BasicAnalysis::info;
-double**	BasicAnalysis::smoothSumBandshape;
-double** 	BasicAnalysis::sumBandshape;
-double**	BasicAnalysis::squareBandshape;
-float**		BasicAnalysis::externalBandshape;
-long long int** BasicAnalysis::countBandshape;
 
+//implementation of DMSearch methods begins
 
+//Declaration of static variables.
+Information DMSearch::info;
+int DMSearch::nSubbands;
+double DMSearch::lowestFrequency;
+double DMSearch::highestFrequency;
+int DMSearch::nTrials;
+int* DMSearch::trialDelay;
+int* DMSearch::trialScrunch;
+double* DMSearch::trialDM;
+int DMSearch::nGroups;
+int* DMSearch::groupFirstTrial;
+int* DMSearch::groupDelays;
+float*** DMSearch::tail;
 /*******************************************************************
-*CONSTRUCTOR: BasicAnalysis::BasicAnalysis(Information _info)
+*CONSTRUCTOR: DMSearch::DMSearch(Information _info)
 *Information _info: All input parameters are contained in this object
-*Initialization of static variables is done in this constructor
+*Chooses the trials and initializes the static variables.
+*The trials start at the delay of the lowest DM and are spaced so that
+*a pulse half way between two trials is smeared to at most tolerance
+*times its width at the trial. The width is the sampling interval and
+*the dispersion smearing within the lowest channel added in quadrature,
+*and it is also the longest a trial can be scrunched by without losing
+*resolution. Scrunch factors are powers of two that divide the block
+*length so that every block has whole samples of every series, the 
+*delays of a trial are multiples of its scrunch factor.
 *******************************************************************/
-BasicAnalysis::BasicAnalysis(Information _info)
+DMSearch::DMSearch(Information info_)
 {
-	info=_info;
-	//initializing other static variables
-	smoothSumBandshape=new double*[info.noOfPol];
-	sumBandshape=new double*[info.noOfPol];
-	squareBandshape=new double*[info.noOfPol];
-	countBandshape=new long long int*[info.noOfPol];
-	externalBandshape=new float*[info.noOfPol];
+	info=info_;
+	int nChan=info.stopChannel-info.startChannel;
+	double channelWidth=info.bandwidth/info.noOfChannels;
+	nSubbands=2;
+	while(nSubbands<nChan)
+		nSubbands*=2;
+	if(info.sidebandFlag==1)
+		lowestFrequency=info.lowestFrequency+info.startChannel*channelWidth;
+	else
+		lowestFrequency=info.lowestFrequency+(info.noOfChannels-info.stopChannel)*channelWidth;
+	highestFrequency=lowestFrequency+nSubbands*channelWidth;
+	double delayPerDM=4.148808*pow(10,3)*(1.0/pow(lowestFrequency,2)-1.0/pow(highestFrequency,2))/info.samplingInterval;
+	double channelShare=(1.0/pow(lowestFrequency,2)-1.0/pow(lowestFrequency+channelWidth,2))/(1.0/pow(lowestFrequency,2)-1.0/pow(highestFrequency,2));
+	int lowestDelay=(int)(info.dmSearchLow*delayPerDM+0.5);
+	int highestDelay=(int)ceil(info.dmSearchHigh*delayPerDM);
+	
+	trialDelay=new int[highestDelay-lowestDelay+1];
+	trialScrunch=new int[highestDelay-lowestDelay+1];
+	nTrials=0;
+	for(int delay=lowestDelay;delay<=highestDelay;)
+	{
+		double width=sqrt(1.0+pow(delay*channelShare,2));
+		int scrunch=1;
+		while(scrunch*2<=width && info.blockSizeSamples%(scrunch*2)==0)
+			scrunch*=2;
+		trialDelay[nTrials]=((delay+scrunch/2)/scrunch)*scrunch;
+		trialScrunch[nTrials]=scrunch;
+		nTrials++;
+		int step=(int)(2.0*width*sqrt(pow(info.dmSearchTolerance,2)-1.0));
+		delay+=(step<scrunch)?scrunch:step;
+	}
+	trialDM=new double[nTrials];
+	for(int k=0;k<nTrials;k++)
+		trialDM[k]=trialDelay[k]/delayPerDM;
+	
+	groupFirstTrial=new int[nTrials+1];
+	groupDelays=new int[nTrials];
+	nGroups=0;
+	for(int k=0;k<nTrials;k++)
+	{
+		if(k==0 || trialScrunch[k]!=trialScrunch[k-1])
+			groupFirstTrial[nGroups++]=k;
+		groupDelays[nGroups-1]=trialDelay[k]/trialScrunch[k]+1;
+	}
+	groupFirstTrial[nGroups]=nTrials;
+	
+	tail=new float**[info.noOfPol];
 	for(int k=0;k<info.noOfPol;k++)
 	{
-		sumBandshape[k]=new double[info.noOfChannels];
-		smoothSumBandshape[k]=new double[info.noOfChannels];
-		squareBandshape[k]=new double[info.noOfChannels];
-		countBandshape[k]=new long long int[info.noOfChannels];
-		externalBandshape[k]=new float[info.noOfChannels];
-		for(int i=0;i<info.noOfChannels;i++)
-			sumBandshape[k][i]=smoothSumBandshape[k][i]=squareBandshape[k][i]=countBandshape[k][i]=0;
-	}
-	if(info.normalizationProcedure==2)
-	{
-		int count=0;
-		std::ifstream f("bandshape.dat");
-		std::string line;
-		while (std::getline(f, line)) {
-			count++;
-			int index;
-			float val;
-			std::istringstream ss(line);
-			ss >> index >> val;
-			if(val==0)
-				val=-1;
-			externalBandshape[0][index]=val;
+		tail[k]=new float*[nGroups];
+		for(int g=0;g<nGroups;g++)
+		{
+			tail[k][g]=new float[(long int)nSubbands*(groupDelays[g]-1)];
+			memset(tail[k][g],0,(long int)nSubbands*(groupDelays[g]-1)*sizeof(float));
 		}
-		if(count<<info.noOfChannels)
+	}
+	series=NULL;
+}
+/*******************************************************************
+*CONSTRUCTOR: DMSearch::DMSearch(int polarIndex_,long int length_)
+*int polarIndex_	:Index of current polarization to process
+*long int length_	:Number of time samples of the block
+*A short last block leaves out its last incomplete scrunched sample.
+*******************************************************************/
+DMSearch::DMSearch(int polarIndex_,long int length_)
+{
+	polarIndex=polarIndex_;
+	length=length_;
+	series=new float*[nTrials];
+	for(int k=0;k<nTrials;k++)
+		series[k]=new float[length/trialScrunch[k]];
+}
+/*******************************************************************
+*DESTRUCTOR: DMSearch::~DMSearch()
+*frees up used memory.
+*******************************************************************/
+DMSearch::~DMSearch()
+{
+	if(series==NULL)
+		return;
+	for(int k=0;k<nTrials;k++)
+		delete[] series[k];
+	delete[] series;
+}
+/*******************************************************************
+*FUNCTION: int DMSearch::subbandDelays(int nDelays,double startFrequency,double endFrequency)
+*Number of delays across a subband that are needed for the delays 
+*across the band to go up to nDelays-1 samples.
+*******************************************************************/
+int DMSearch::subbandDelays(int nDelays,double startFrequency,double endFrequency)
+{
+	double share=(1.0/pow(startFrequency,2)-1.0/pow(endFrequency,2))/(1.0/pow(lowestFrequency,2)-1.0/pow(highestFrequency,2));
+	return (int)ceil((nDelays-1)*share-1e-9)+1;
+}
+/*******************************************************************
+*FUNCTION: void DMSearch::transform(float* rawData,char* timeFlags,char* freqFlags,char* sampleFlags)
+*float* rawData		:Normalized 2-D data of the block
+*char* timeFlags	:Time samples marked 1 are left out.
+*char* freqFlags	:Channels marked 1 are left out.
+*char* sampleFlags	:Samples of the 2-D data marked 1 are left out
+*			 (NULL if individual samples are not flagged).
+*Computes the series of all trials of the block. Sample i of a series
+*is the sum over the band along the sweep that reaches the lowest 
+*frequency at sample i, as for fullDM with dedispersion w.r.t the 
+*lowest frequency. The blocks of a polarization must be transformed
+*in block order.
+*******************************************************************/
+void DMSearch::transform(float* rawData,char* timeFlags,char* freqFlags,char* sampleFlags)
+{
+	int startChannel=info.startChannel;
+	int nChan=info.stopChannel-startChannel;
+	//The selected channels, centred and flagged, in channel major order.
+	float* channels=new float[(long int)nChan*length];
+	char* flags=new char[(long int)nChan*length];
+	transposeTile(rawData+startChannel,info.noOfChannels,length,nChan,channels,length);
+	if(sampleFlags!=NULL)
+		transposeTile(sampleFlags+startChannel,info.noOfChannels,length,nChan,flags,length);
+	#pragma omp parallel for
+	for(int j=0;j<nChan;j++)
+	{
+		combineFlags(timeFlags,freqFlags[j],sampleFlags!=NULL,length,&flags[(long int)j*length]);
+		centreMaskedRow(&channels[(long int)j*length],&flags[(long int)j*length],length);
+	}
+	delete[] flags;
+	for(int g=0;g<nGroups;g++)
+		transformGroup(g,channels);
+	delete[] channels;
+}
+/*******************************************************************
+*FUNCTION: void DMSearch::transformGroup(int group,float* channels)
+*int group		:Group of trials to compute
+*float* channels	:Centred and flagged channels in channel major order
+*FDMT of the channels scrunched by the scrunch factor of the group, 
+*only the delays of the trials are computed in the last merge.
+*******************************************************************/
+void DMSearch::transformGroup(int group,float* channels)
+{
+	int nChan=info.stopChannel-info.startChannel;
+	int scrunch=trialScrunch[groupFirstTrial[group]];
+	int nDelays=groupDelays[group];
+	long int nBins=length/scrunch;
+	long int tailLength=nDelays-1;
+	long int nSamples=tailLength+nBins;
+	float* groupTail=tail[polarIndex][group];
+	double channelWidth=(highestFrequency-lowestFrequency)/nSubbands;
+	int nIterations=0;
+	while((1<<nIterations)<nSubbands)
+		nIterations++;
+	
+	//Both state buffers are sized for the largest intermediate state, each subband of an iteration has room for the delays of the lowest one.
+	long int stateSize=0;
+	for(int iteration=0;iteration<nIterations;iteration++)
+	{
+		long int size=(long int)(nSubbands>>iteration)*subbandDelays(nDelays,lowestFrequency,lowestFrequency+(1<<iteration)*channelWidth)*nSamples;
+		if(size>stateSize)
+			stateSize=size;
+	}
+	float* state=new float[stateSize];
+	float* nextState=new float[stateSize];
+	
+	//Initial state: each channel summed over 1 to rows samples.
+	int rows=subbandDelays(nDelays,lowestFrequency,lowestFrequency+channelWidth);
+	#pragma omp parallel for schedule(dynamic, 16)
+	for(int c=0;c<nSubbands;c++)
+	{
+		float* row=&state[(long int)c*rows*nSamples];
+		memcpy(row,&groupTail[c*tailLength],tailLength*sizeof(float));
+		int j=(info.sidebandFlag==1)?c:nChan-1-c;
+		if(c<nChan)
+			scrunchRow(&channels[(long int)j*length],nBins,scrunch,&row[tailLength]);
+		else
+			memset(&row[tailLength],0,nBins*sizeof(float));
+		memcpy(&groupTail[c*tailLength],&row[nBins],tailLength*sizeof(float));
+		int channelRows=subbandDelays(nDelays,lowestFrequency+c*channelWidth,lowestFrequency+(c+1)*channelWidth);
+		for(int d=1;d<channelRows;d++)
 		{
-			cout<<"bandshape.dat does not contain "<<info.noOfChannels<<" number of channels"<<endl;
+			float* out=&row[d*nSamples];
+			memset(out,0,d*sizeof(float));
+			addRows(out-nSamples+d,row,nSamples-d,out+d);
 		}
 	}
-	filteredRawData=NULL;
 	
+	//Pairwise merges, the last one computes only the trial delays.
+	for(int iteration=1;iteration<=nIterations;iteration++)
+	{
+		char isLast=(iteration==nIterations);
+		int nMerged=nSubbands>>iteration;
+		double width=(1<<iteration)*channelWidth;
+		int nextRows=subbandDelays(nDelays,lowestFrequency,lowestFrequency+width);
+		int nTasks=isLast?groupFirstTrial[group+1]-groupFirstTrial[group]:nMerged*nextRows;
+		#pragma omp parallel for schedule(dynamic, 16)
+		for(int task=0;task<nTasks;task++)
+		{
+			int s=isLast?0:task/nextRows;
+			int delay=isLast?trialDelay[groupFirstTrial[group]+task]/scrunch:task%nextRows;
+			double startFrequency=lowestFrequency+s*width;
+			double endFrequency=startFrequency+width;
+			if(!isLast && delay>=subbandDelays(nDelays,startFrequency,endFrequency))
+				continue;
+			//The halves meet at the middle frequency, taken half a channel lower (higher) for the lower (upper) half as in Zackay & Ofek.
+			double middleFrequency=(startFrequency+endFrequency)/2.0;
+			double sweep=1.0/pow(endFrequency,2)-1.0/pow(startFrequency,2);
+			int lowerDelay=(int)(delay*(1.0/pow(middleFrequency-channelWidth/2.0,2)-1.0/pow(startFrequency,2))/sweep+0.5);
+			int shift=(int)(delay*(1.0/pow(middleFrequency+channelWidth/2.0,2)-1.0/pow(startFrequency,2))/sweep+0.5);
+			int upperDelay=delay-shift;
+			int lowerRows=subbandDelays(nDelays,startFrequency,middleFrequency);
+			int upperRows=subbandDelays(nDelays,middleFrequency,endFrequency);
+			if(lowerDelay>=lowerRows)
+				lowerDelay=lowerRows-1;
+			if(upperDelay>=upperRows)
+				upperDelay=upperRows-1;
+			const float* lower=&state[((long int)2*s*rows+lowerDelay)*nSamples];
+			const float* upper=&state[((long int)(2*s+1)*rows+upperDelay)*nSamples];
+			if(isLast)
+				addRows(lower+tailLength,upper+tailLength-shift,nBins,series[groupFirstTrial[group]+task]);
+			else
+			{
+				float* out=&nextState[((long int)s*nextRows+delay)*nSamples];
+				memcpy(out,lower,shift*sizeof(float));
+				addRows(lower+shift,upper,nSamples-shift,out+shift);
+			}
+		}
+		float* swap=state;
+		state=nextState;
+		nextState=swap;
+		rows=nextRows;
+	}
+	delete[] state;
+	delete[] nextState;
 }
 /*******************************************************************
-*FUNCTION: BasicAnalysis::BasicAnalysis(float* _rawData,int _blockIndex)
-*float *_rawData 		:the 2-D raw data to process in the current block
-*int _polarIndex		:index of polarization to process
-*long int _blockLength		:length of current block
-*Performs initialization of variables for current block
+*FUNCTION: void DMSearch::write(const char*  filename)
+*const char*  fileName: Filename to write to.
+*Writes out the series of all trials of the block one after another.
 *******************************************************************/
-BasicAnalysis::BasicAnalysis(float* _rawData,int _polarIndex,long int _blockLength)
+void DMSearch::write(const char*  filename)
 {
-	polarIndex=_polarIndex;
-	blockLength=_blockLength;
-	rawData=_rawData;
-	bandshape=new float[info.noOfChannels];	
-	correlationBandshape=new float[info.noOfChannels];	
-	meanToRmsBandshape=new float[info.noOfChannels];	
-	normalizedBandshape=new float[info.noOfChannels];	
-	zeroDM=new float[blockLength]; 
-	zeroDMUnfiltered=new float[blockLength]; 
-	cumBandshapeScale=1000.0;
-	if(info.normalizationProcedure==2)
-		smoothBandshape=externalBandshape[polarIndex];
-	else
-		smoothBandshape=new float[info.noOfChannels];
-	filteredRawData=NULL;
-	headerInfo=NULL;
-	
+	FILE* dmTimeFile;    
+	dmTimeFile = fopen(filename, "ab");
+	for(int k=0;k<nTrials;k++)
+		fwrite(series[k], sizeof(float), length/trialScrunch[k], dmTimeFile);    
+	fclose(dmTimeFile); 
 }
 /*******************************************************************
-*DESTRUCTOR: BasicAnalysis::~BasicAnalysis()
-*Frees memory occupied by various arrays
+*FUNCTION: void DMSearch::writeTrials(const char*  filename)
+*const char*  fileName: Filename to write to.
+*Writes out the DM, delay and scrunch factor of each trial.
 *******************************************************************/
-BasicAnalysis::~BasicAnalysis()
+void DMSearch::writeTrials(const char*  filename)
 {
-	delete[] rawData;
-	delete[] zeroDM;
-	delete[] zeroDMUnfiltered;
-	delete[] bandshape;
-	delete[] correlationBandshape;
-	delete[] meanToRmsBandshape;
-	delete[] normalizedBandshape;
-	if(info.normalizationProcedure!=2)
-		delete[] smoothBandshape;
-	if(filteredRawData!=NULL)
-		delete[] filteredRawData;
-	if(headerInfo!=NULL)
-		delete[] headerInfo;
+	ofstream trialFile(filename,ios::out | ios::trunc);
+	trialFile<<"#Each block of the DM-time file has the series of all trials in this order, "<<info.blockSizeSamples<<"/scrunch samples each"<<endl;
+	trialFile<<"#trial\tDM\tdelay\tscrunch"<<endl;
+	for(int k=0;k<nTrials;k++)
+		trialFile<<k<<"\t"<<setprecision(8)<<trialDM[k]<<"\t"<<trialDelay[k]<<"\t"<<trialScrunch[k]<<endl;
+	trialFile.close();
+}
+
+//implementation of DMSearch methods ends
+
+/*******************************************************************
+CLASS: RunningMedian
+*Median of the last windowLength values added. The window is kept as 
+*two binary heaps over flat arrays, a max heap of the lower half and a
+*min heap of the upper half. Each value of the window remembers where 
+*it sits in the heaps, so the oldest value is overwritten in place by 
+*the new one and sifted, which costs O(log windowLength) per value 
+*with no allocation.
+*******************************************************************/
+class RunningMedian
+{
+	public:
+		int			windowLength;	//Number of values the median is taken over
+		float*			window;		//Values in the window in the order they were added (circular)
+		int*			position;	//Position of each value of window in the heaps, i for lower[i] and -1-i for upper[i]
+		int*			lower;		//Max heap of the lower half of the window (indices into window, holds the median)
+		int*			upper;		//Min heap of the upper half of the window
+		int			nLower;		//Number of values in lower
+		int			nUpper;		//Number of values in upper
+		long int		nAdded;		//Number of values added so far
+		RunningMedian(int windowLength_);
+		~RunningMedian();
+		float add(float x);			//Adds x in place of the oldest value and returns the median
+	private:
+		char precedes(char isLower,int a,int b);	//Whether value a goes above value b in the heap
+		void place(char isLower,int i,int slot);	//Puts value slot at position i of a heap
+		int siftUp(char isLower,int i);		//Moves the value at i up the heap, returns its new position
+		void siftDown(char isLower,int i);		//Moves the value at i down the heap
+		void exchangeRoots();				//Swaps the roots if the halves are out of order
+};
+/*******************************************************************
+*CONSTRUCTOR: RunningMedian::RunningMedian(int windowLength_)
+*int windowLength_	:Number of values the median is taken over
+*******************************************************************/
+RunningMedian::RunningMedian(int windowLength_)
+{
+	windowLength=windowLength_;
+	window=new float[windowLength];
+	position=new int[windowLength];
+	lower=new int[windowLength/2+1];
+	upper=new int[windowLength/2+1];
+	nLower=0;
+	nUpper=0;
+	nAdded=0;
+}
+/*******************************************************************
+*DESTRUCTOR: RunningMedian::~RunningMedian()
+*frees up used memory.
+*******************************************************************/
+RunningMedian::~RunningMedian()
+{
+	delete[] window;
+	delete[] position;
+	delete[] lower;
+	delete[] upper;
+}
+/*******************************************************************
+*FUNCTION: char RunningMedian::precedes(char isLower,int a,int b)
+*char isLower		:1 for the max heap lower, 0 for the min heap upper
+*int a, int b		:Indices into window
+*******************************************************************/
+inline char RunningMedian::precedes(char isLower,int a,int b)
+{
+	return isLower?(window[a]>window[b]):(window[a]<window[b]);
+}
+/*******************************************************************
+*FUNCTION: void RunningMedian::place(char isLower,int i,int slot)
+*Puts the value window[slot] at position i of lower or upper and 
+*records the position.
+*******************************************************************/
+inline void RunningMedian::place(char isLower,int i,int slot)
+{
+	if(isLower)
+	{
+		lower[i]=slot;
+		position[slot]=i;
+	}
+	else
+	{
+		upper[i]=slot;
+		position[slot]=-1-i;
+	}
 }
-
-
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::computeZeroDM(char* freqFlags)
-*char* freqFlags : The channels marked 1 in this array is not 
-*included while computing zeroDM (or are clipped)
-*For no flagging, a char* variable with all 0's is passed on to this 
-*function
-*Computes the time series by collapsing all frequency channels with
-*no dedispersion (hence the name "zeroDM" series). While collapsing 
-*the flagged channels are ignored or clipped.
+*FUNCTION: int RunningMedian::siftUp(char isLower,int i)
+*Moves the value at position i of lower or upper towards the root
+*while it goes above its parent. Returns its new position.
 *******************************************************************/
-void BasicAnalysis::computeZeroDM(char* freqFlags)
+int RunningMedian::siftUp(char isLower,int i)
 {
-	float*	ptrZeroDM;
-	float*	ptrZeroDMUnfiltered;
-	float* 	ptrRawData;
-	float 	count=0;					//Stores the number of channels added to get each time sample	
-	int 	startChannel=info.startChannel;
-	int 	nChan= info.stopChannel-startChannel;		//Number of channels to use
-	int 	endExclude=info.noOfChannels-info.stopChannel;	//Number of channels to exclude from the end of the band
-	int 	l= blockLength;
-	for(int i=0;i<nChan;i++)
-		if(!freqFlags[i])
-			count++;
-	ptrRawData=rawData;
-	ptrZeroDM=zeroDM;
-	ptrZeroDMUnfiltered=zeroDMUnfiltered;
-	maxZeroDM=0;
-	minZeroDM=10000*nChan;					//This is done because there is no sample computed yet.		
-	for(int i=0;i<l;i++,ptrZeroDM++,ptrZeroDMUnfiltered++)
-	{		
-		*ptrZeroDM=0;	
-		*ptrZeroDMUnfiltered=0;		
-		ptrRawData+=startChannel;			//startChannel number of channels skipped at the start of the band
-		for(int j=0;j<nChan;j++,ptrRawData++)
-		{
-			*ptrZeroDMUnfiltered+=(*ptrRawData);
-			if(!freqFlags[j])
-				(*ptrZeroDM)+=(*ptrRawData);
-		}
-		ptrRawData+=endExclude;				//endExclude number of channels skipped at the end of the band
-		(*ptrZeroDM)/=(float)count;			//Each sample averaged 
-		(*ptrZeroDMUnfiltered)/=(float)nChan;
-		//Calculating of minimum and maximum of zeroDM series
-		if(*ptrZeroDM>maxZeroDM)
-			maxZeroDM=*ptrZeroDM;
-		if(*ptrZeroDM<minZeroDM)
-			minZeroDM=*ptrZeroDM;
+	int* heap=isLower?lower:upper;
+	int slot=heap[i];
+	while(i>0 && precedes(isLower,slot,heap[(i-1)/2]))
+	{
+		place(isLower,i,heap[(i-1)/2]);
+		i=(i-1)/2;
 	}
+	place(isLower,i,slot);
+	return i;
 }
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::computeBandshape()
-*Computes mean and mean-to-rms bandshape for the current block .
-*It also calculates quantities to find the cumulative mean and 
-*rms of the bandshape.
+*FUNCTION: void RunningMedian::siftDown(char isLower,int i)
+*Moves the value at position i of lower or upper towards the leaves
+*while a child goes above it.
 *******************************************************************/
-void BasicAnalysis::computeBandshape()
+void RunningMedian::siftDown(char isLower,int i)
 {
-	float	*ptrBandshape,*ptrMeanToRmsBandshape;
-	float	*ptrRawData;
-	int 	startChannel=info.startChannel;
-	int 	nChan= info.stopChannel-startChannel;				//Number of channels to use
-	int 	endExclude=info.noOfChannels-info.stopChannel;			//Number of channels to exclude from the end
-	int 	l= blockLength;
-	ptrRawData=rawData;
-	ptrBandshape=bandshape;
-	ptrMeanToRmsBandshape=meanToRmsBandshape;
-	//Intialization of bandshape
-	for(int j=0;j<info.noOfChannels;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
-		*ptrBandshape=*ptrMeanToRmsBandshape=0;	
-	for(int i=0;i<l;i++)
-	{		
-		ptrBandshape=&bandshape[startChannel]; 				//startChannel number of channels skipped at the start
-		ptrMeanToRmsBandshape=&meanToRmsBandshape[startChannel];
-		ptrRawData+=startChannel;
-		for(int j=0;j<nChan;j++,ptrRawData++,ptrBandshape++,ptrMeanToRmsBandshape++)
-		{
-			(*ptrBandshape)+=(*ptrRawData);
-			*ptrMeanToRmsBandshape+=(*ptrRawData)*(*ptrRawData);
-		}
-		ptrRawData+=endExclude;						//endExclude number of channels skipped at the end
-		ptrBandshape+=endExclude;
-		ptrMeanToRmsBandshape+=endExclude;
+	int* heap=isLower?lower:upper;
+	int n=isLower?nLower:nUpper;
+	int slot=heap[i];
+	for(int child=2*i+1;child<n;child=2*i+1)
+	{
+		if(child+1<n && precedes(isLower,heap[child+1],heap[child]))
+			child++;
+		if(!precedes(isLower,heap[child],slot))
+			break;
+		place(isLower,i,heap[child]);
+		i=child;
 	}
-	count=blockLength;
+	place(isLower,i,slot);
 }
-
-
 /*******************************************************************
-*void BasicAnalysis::computeBandshape(char* timeFlags)
-*char* timeFlags : Excludes the time samples for which timeFlag is 1
-*This function is similar to void BasicAnalysis::computeBandshape(),
-*the only difference being that timeFlags is used to ignore (or clip)
-*bad time samples.
+*FUNCTION: void RunningMedian::exchangeRoots()
+*Only one value can be on the wrong side after an insertion or an
+*overwrite, and it is then at the root of its heap, so one exchange
+*of the roots restores the order of the halves.
 *******************************************************************/
-void BasicAnalysis::computeBandshape(char* timeFlags)
+void RunningMedian::exchangeRoots()
 {
-	float *ptrBandshape,*ptrMeanToRmsBandshape;
-	float* 	ptrRawData;
-	char*  	ptrTimeFlags;
-	int 	startChannel=info.startChannel;
-	int 	nChan= info.stopChannel-startChannel;
-	int 	endExclude=info.noOfChannels-info.stopChannel;
-	int 	l= blockLength;
-	ptrRawData=rawData;
-	ptrBandshape=bandshape;
-	ptrTimeFlags=timeFlags;
-	
-	//Initializing bandshape
-	for(int j=0;j<info.noOfChannels;j++,ptrBandshape++,ptrMeanToRmsBandshape++)
-		*ptrBandshape=*ptrMeanToRmsBandshape=0;		
-			
-	ptrTimeFlags=timeFlags;	
-	
-	for(int i=0;i<l;i++,ptrTimeFlags++)
-	{		
-		ptrBandshape=&(bandshape[startChannel]);			//startChannel number of channels skipped at the start
-		ptrMeanToRmsBandshape=&meanToRmsBandshape[startChannel];
-		if(!(*ptrTimeFlags))
+	if(nUpper==0 || window[lower[0]]<=window[upper[0]])
+		return;
+	int slot=lower[0];
+	place(1,0,upper[0]);
+	place(0,0,slot);
+	siftDown(1,0);
+	siftDown(0,0);
+}
+/*******************************************************************
+*FUNCTION: float RunningMedian::add(float x)
+*float x		:Value to add
+*Until the window is full the median is over the values added so far.
+*lower holds as many values as upper or one more, its largest value 
+*is the median.
+*******************************************************************/
+float RunningMedian::add(float x)
+{
+	int slot=nAdded%windowLength;
+	window[slot]=x;
+	if(nAdded<windowLength)
+	{
+		if(nLower==nUpper)
 		{
-			ptrRawData+=startChannel;			
-			for(int j=0;j<nChan;j++,ptrRawData++,ptrBandshape++,ptrMeanToRmsBandshape++)
-			{
-				(*ptrBandshape)+=(*ptrRawData);	
-				*ptrMeanToRmsBandshape+=(*ptrRawData)*(*ptrRawData);	
-					
-			}
-			ptrRawData+=endExclude;					//endExclude number of channels skipped at the end
-			ptrBandshape+=endExclude;
-			ptrMeanToRmsBandshape+=endExclude;
+			place(1,nLower,slot);
+			siftUp(1,nLower++);
 		}
 		else
-			ptrRawData+=info.noOfChannels;				//skips entire time sample if flagged
+		{
+			place(0,nUpper,slot);
+			siftUp(0,nUpper++);
+		}
 	}
-	
-	//Finding number of time samples added to each channel bin
-	for(int i=0;i<l;i++,ptrTimeFlags++)
-		if(!(*ptrTimeFlags))		
-			count++;
-	
+	else if(position[slot]>=0)
+		siftDown(1,siftUp(1,position[slot]));
+	else
+		siftDown(0,siftUp(0,-1-position[slot]));
+	exchangeRoots();
+	nAdded++;
+	return window[lower[0]];
 }
-void BasicAnalysis::calculateCumulativeBandshapes()
+
+/*******************************************************************
+*Detection of a boxcar above the threshold in one series and a 
+*candidate made of a cluster of detections.
+*******************************************************************/
+struct SinglePulseDetection
 {
-	float *ptrBandshape,*ptrMeanToRmsBandshape;
-	int nChan= info.stopChannel-info.startChannel;
-	ptrBandshape=&bandshape[info.startChannel];	
-	ptrMeanToRmsBandshape=&meanToRmsBandshape[info.startChannel];
-	minMeanToRmsBandshape=minBandshape=1e8;
-	maxMeanToRmsBandshape=maxBandshape=0;
+	long long int	sample;		//First time sample of the boxcar (unscrunched samples since the start)
+	int		width;		//Width of the boxcar in unscrunched samples
+	int		series;		//Series the boxcar is in
+	float		snr;		//Signal to noise ratio
+};
+struct SinglePulseCandidate
+{
+	double		mjd;		//MJD of the first sample of the brightest boxcar
+	float		dm;		//DM of the brightest boxcar
+	float		snr;		//Signal to noise ratio of the brightest boxcar
+	float		widthMs;	//Width of the brightest boxcar in ms
+	long long int	sample;		//First time sample of the brightest boxcar
+	int		nDetections;	//Number of detections in the cluster
+};
 
-	
-	double *ptrSumBandshape=&sumBandshape[polarIndex][info.startChannel];
-	double *ptrSquareBandshape=&squareBandshape[polarIndex][info.startChannel];
-	long long int *ptrCountBandshape=&countBandshape[polarIndex][info.startChannel];
-	/*************************************************************************************
-	*Calculation of cumulative values, current mean bandshape, mean-to-rms bandshape.
-	*Also computes the max and min of each of these bandshapes.
-	*These max-min values are used for plotting purposes.
-	*The cumulative values are used to calculate the mean and the mean-to-rms bandshape
-	*over the entire run of the program.
-	**************************************************************************************/
-	for(int j=0;j<nChan;j++,ptrBandshape++,ptrSumBandshape++,ptrSquareBandshape++,ptrCountBandshape++,ptrMeanToRmsBandshape++)
-	{
-		//Computation of cumulative values: 
-		*ptrSumBandshape+=*ptrBandshape/cumBandshapeScale;
-		*ptrSquareBandshape+=*ptrMeanToRmsBandshape/(cumBandshapeScale*cumBandshapeScale);
-		*ptrCountBandshape+=count;	
-		
-		//Computation of mean bandshape:
-		*ptrBandshape/=(float)count;
-		if(*ptrBandshape>maxBandshape)
-			maxBandshape=*ptrBandshape;
-		if(*ptrBandshape<minBandshape)		
-			minBandshape=*ptrBandshape;
-		if(*ptrBandshape==0)
-		{
-			*ptrMeanToRmsBandshape=0;
-			minMeanToRmsBandshape=0;
-			continue;
-		}
-		//Computation of mean-to-rms bandshape:
-		*ptrMeanToRmsBandshape=(*ptrBandshape)/sqrt(*ptrMeanToRmsBandshape/count-pow(*ptrBandshape,2));
+/*******************************************************************
+CLASS: SinglePulseSearch
+*Searches the dedispersed series for single pulses. The series are 
+*fullDM and, with -dmsearch, the series of every trial DM.
+*Each series is detrended by subtracting its running median over 
+*8 times the widest boxcar plus one sample (see RunningMedian). 
+*Boxcars of widths 1,2,4.. up to the widest are matched filtered with prefix sums, with the noise rms of the block
+*estimated from the median absolute deviation. Above the threshold 
+*only the peak of a run of consecutive boxcars is kept. Detections 
+*that overlap in time (within the wider of them) at nearby DMs (within
+*two series) are clustered into one candidate, that of the brightest
+*boxcar. The detrending, the last samples of each series (for boxcars
+*across blocks) and the detections of clusters still open at the end
+*of the block are carried to the next block.
+*******************************************************************/
+class SinglePulseSearch
+{
+	public:
+		//Static variables:
+		static Information	info;			//contains all input parameters
+		static int		nSeries;		//Number of series searched (fullDM and the trial DMs)
+		static int*		seriesScrunch;		//Number of time samples added to each sample of each series
+		static int*		seriesMaxWidth;		//Widest boxcar of each series in its samples
+		static float*		seriesDM;		//DM of each series
+		static int*		seriesRank;		//Position of each series in the order of DM
+		static RunningMedian***	medians;		//Running median of each series, one set for each polarization
+		static float***		carry;			//Last seriesMaxWidth-1 detrended samples of each series, one set for each polarization
+		static vector<SinglePulseDetection>* pending;	//Detections of clusters open at the end of the last block, one for each polarization
 		
+		//Variables:
+		int		polarIndex;		//Index of polarization to process
+		long long int	startSample;		//Number of time samples before the block
+		long int	length;			//Number of time samples of the block
+		vector<SinglePulseCandidate> candidates;	//Candidates completed in the block
 		
-		if(*ptrMeanToRmsBandshape>maxMeanToRmsBandshape)
-			maxMeanToRmsBandshape=*ptrMeanToRmsBandshape;
-		if(*ptrMeanToRmsBandshape<minMeanToRmsBandshape)		
-			minMeanToRmsBandshape=*ptrMeanToRmsBandshape;
+		//Functions:
+		SinglePulseSearch(Information info_);	//Constructor for first intialization
+		SinglePulseSearch(int polarIndex_,long long int startSample_,long int length_);	//constructor
+		void search(float* fullDM,char* dedispFlags,long int firstSample,DMSearch* dmSearch);	//Searches the series of the block
+		void write(const char* filename);	//Writes out the candidates
 		
+		private:
+		void searchSeries(int series,const float* data,const char* flags,long int n,long long int firstSample,vector<SinglePulseDetection>& detections);	//Finds the boxcars above the threshold in a series
+		void cluster(vector<SinglePulseDetection>& detections);	//Clusters the detections into candidates
+};
+
+//implementation of SinglePulseSearch methods begins
+
+//Declaration of static variables.
+Information SinglePulseSearch::info;
+int SinglePulseSearch::nSeries;
+int* SinglePulseSearch::seriesScrunch;
+int* SinglePulseSearch::seriesMaxWidth;
+float* SinglePulseSearch::seriesDM;
+int* SinglePulseSearch::seriesRank;
+RunningMedian*** SinglePulseSearch::medians;
+float*** SinglePulseSearch::carry;
+vector<SinglePulseDetection>* SinglePulseSearch::pending;
+/*******************************************************************
+*CONSTRUCTOR: SinglePulseSearch::SinglePulseSearch(Information _info)
+*Information _info: All input parameters are contained in this object
+*Series 0 is fullDM, series k+1 the trial k of DMSearch. DMSearch must
+*be initialized first.
+*******************************************************************/
+SinglePulseSearch::SinglePulseSearch(Information info_)
+{
+	info=info_;
+	nSeries=1+(info.doDMSearch?DMSearch::nTrials:0);
+	int maxWidth=1;
+	while(maxWidth*2*info.samplingInterval*1000.0<=info.singlePulseMaxWidthMs)
+		maxWidth*=2;
+	seriesScrunch=new int[nSeries];
+	seriesMaxWidth=new int[nSeries];
+	seriesDM=new float[nSeries];
+	seriesRank=new int[nSeries];
+	for(int q=0;q<nSeries;q++)
+	{
+		seriesScrunch[q]=(q==0)?1:DMSearch::trialScrunch[q-1];
+		seriesDM[q]=(q==0)?info.dispersionMeasure:DMSearch::trialDM[q-1];
+		seriesMaxWidth[q]=(maxWidth>seriesScrunch[q])?maxWidth/seriesScrunch[q]:1;
+		seriesRank[q]=0;
+		for(int r=0;r<q;r++)
+		{
+			if(seriesDM[r]<=seriesDM[q])
+				seriesRank[q]++;
+			else
+				seriesRank[r]++;
+		}
 	}
-	if((int)info.bandshapeToUse==2 || info.doUseNormalizedData)
+	medians=new RunningMedian**[info.noOfPol];
+	carry=new float**[info.noOfPol];
+	pending=new vector<SinglePulseDetection>[info.noOfPol];
+	for(int k=0;k<info.noOfPol;k++)
 	{
-		if(info.normalizationProcedure==1)
-			smoothAndNormalizeBandshape();
-		else
-			normalizeBandshape();
+		medians[k]=new RunningMedian*[nSeries];
+		carry[k]=new float*[nSeries];
+		for(int q=0;q<nSeries;q++)
+		{
+			medians[k][q]=new RunningMedian(8*seriesMaxWidth[q]+1);
+			carry[k][q]=new float[seriesMaxWidth[q]];
+			memset(carry[k][q],0,seriesMaxWidth[q]*sizeof(float));
+		}
 	}
-			
 }
-void BasicAnalysis::quicksort(float* x,long int first,long int last)
+/*******************************************************************
+*CONSTRUCTOR: SinglePulseSearch::SinglePulseSearch(int polarIndex_,long long int startSample_,long int length_)
+*int polarIndex_		:Index of current polarization to process
+*long long int startSample_	:Number of time samples before the block
+*long int length_		:Number of time samples of the block
+*******************************************************************/
+SinglePulseSearch::SinglePulseSearch(int polarIndex_,long long int startSample_,long int length_)
 {
-    int pivot,j,i;
-    float temp;
-
-     if(first<last){
-         pivot=first;
-         i=first;
-         j=last;
-
-         while(i<j){
-             while(x[i]<=x[pivot]&&i<last)
-                 i++;
-             while(x[j]>x[pivot])
-                 j--;
-             if(i<j){
-                 temp=x[i];
-                  x[i]=x[j];
-                  x[j]=temp;
-             }
-         }
-
-         temp=x[pivot];
-         x[pivot]=x[j];
-         x[j]=temp;
-         quicksort(x,first,j-1);
-         quicksort(x,j+1,last);
-
-	}
+	polarIndex=polarIndex_;
+	startSample=startSample_;
+	length=length_;
 }
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::smoothAndNormalizeBandshape()
-*Smoothens the mean bandshape and uses it to find the normalized 
-*bandshape.
-*The smooth bandshape here is used as an approximation to filtering
-*response where smoothing ensures that the impact of RFI is minimized.
-*Normilization inverts the effect of filter response to bring the power
-*levels of each channel to roughly 1.
-*Normalization helps in both time and frequency domain filtering.
-*Refer to documentations on it for more details.
+*FUNCTION: void SinglePulseSearch::search(float* fullDM,char* dedispFlags,long int firstSample,DMSearch* dmSearch)
+*float* fullDM		:Normalized dedispersed series of the block (NULL
+*			 if the block has none, it is then taken as flagged)
+*char* dedispFlags	:Samples of fullDM marked 1 are left out.
+*long int firstSample	:First sample of fullDM that is complete
+*DMSearch* dmSearch	:Series of the trial DMs (NULL without -dmsearch)
+*The blocks of a polarization must be searched in block order.
 *******************************************************************/
-void BasicAnalysis::smoothAndNormalizeBandshape() 
+void SinglePulseSearch::search(float* fullDM,char* dedispFlags,long int firstSample,DMSearch* dmSearch)
 {
-	int startChannel=info.startChannel;
-	int nChan= info.stopChannel-startChannel;
-	double *ptrSmoothSumBandshape=&smoothSumBandshape[polarIndex][startChannel];
-	float *ptrSmoothBandshape=&smoothBandshape[startChannel];
-	float *ptrNormalizedBandshape=&normalizedBandshape[startChannel];
-	float *ptrBandshape=&bandshape[startChannel];	
-	long long *ptrCountBandshape=&countBandshape[polarIndex][startChannel];
-	for(int i=0;i<info.noOfChannels;i++)
-		smoothBandshape[i]=0;
-	int wSize=info.smoothingWindowLength/2;
-	float* tempArray=new float[info.smoothingWindowLength];
-	minNormalizedBandshape=maxNormalizedBandshape=0;
+	vector<SinglePulseDetection>* detections=new vector<SinglePulseDetection>[nSeries];
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(int q=0;q<nSeries;q++)
+	{
+		if(q==0)
+			searchSeries(0,(fullDM!=NULL)?fullDM+firstSample:NULL,dedispFlags+firstSample,length-firstSample,startSample+firstSample,detections[0]);
+		else
+			searchSeries(q,dmSearch->series[q-1],NULL,length/seriesScrunch[q],startSample,detections[q]);
+	}
+	vector<SinglePulseDetection> all;
+	all.swap(pending[polarIndex]);
+	for(int q=0;q<nSeries;q++)
+		all.insert(all.end(),detections[q].begin(),detections[q].end());
+	delete[] detections;
+	cluster(all);
+}
+/*******************************************************************
+*FUNCTION: void SinglePulseSearch::searchSeries(int series,const float* data,const char* flags,long int n,long long int firstSample,vector<SinglePulseDetection>& detections)
+*int series		:Index of the series
+*const float* data	:n samples of the series (NULL if all are flagged)
+*const char* flags	:Samples marked 1 are left out (NULL if none are)
+*long long int firstSample:Unscrunched time sample of data[0]
+*Detrends the series and adds its boxcars above the threshold to 
+*detections. Flagged samples are detrended to 0.
+*******************************************************************/
+void SinglePulseSearch::searchSeries(int series,const float* data,const char* flags,long int n,long long int firstSample,vector<SinglePulseDetection>& detections)
+{
+	int maxWidth=seriesMaxWidth[series];
+	int scrunch=seriesScrunch[series];
+	long int carryLength=maxWidth-1;
+	RunningMedian* median=medians[polarIndex][series];
+	float* seriesCarry=carry[polarIndex][series];
+	
+	//Detrended samples after the carried samples of the last block.
+	float* detrended=new float[carryLength+n];
+	memcpy(detrended,seriesCarry,carryLength*sizeof(float));
+	float* ptrDetrended=detrended+carryLength;
+	for(long int i=0;i<n;i++,ptrDetrended++)
+	{
+		if(data==NULL || (flags!=NULL && flags[i]))
+			*ptrDetrended=0;
+		else
+			*ptrDetrended=data[i]-median->add(data[i]);
+	}
+	memcpy(seriesCarry,detrended+n,carryLength*sizeof(float));
+	
+	//Noise rms from the median absolute deviation of the unflagged samples of the block.
+	float* deviation=new float[n];
+	long int nUnflagged=0;
+	for(long int i=0;i<n;i++)
+		if(data!=NULL && (flags==NULL || !flags[i]))
+			deviation[nUnflagged++]=fabs(detrended[carryLength+i]);
+	nth_element(deviation,deviation+nUnflagged/2,deviation+nUnflagged);
+	double rms=(nUnflagged>0)?1.4826*deviation[nUnflagged/2]:0;
+	delete[] deviation;
+	if(rms<=0)
+	{
+		delete[] detrended;
+		return;
+	}
 	
-	for(int j=0;j<nChan;j++,ptrBandshape++,ptrSmoothBandshape++,ptrNormalizedBandshape++,ptrSmoothSumBandshape++,ptrCountBandshape++)
+	double* prefixSum=new double[carryLength+n+1];
+	prefixSum[0]=0;
+	for(long int i=0;i<carryLength+n;i++)
+		prefixSum[i+1]=prefixSum[i]+detrended[i];
+	for(int width=1;width<=maxWidth;width*=2)
 	{
-		int tempCnt=0;	
-		for(int i=-1*wSize;i<wSize;i++)
+		double scale=1.0/(rms*sqrt((double)width));
+		SinglePulseDetection peak;
+		peak.snr=0;
+		for(long int end=carryLength;end<=carryLength+n;end++)
 		{
-			if(i+j>=nChan)
-				break;
-			if(i+j>=0)
+			float snr=(end<carryLength+n)?(prefixSum[end+1]-prefixSum[end+1-width])*scale:0;
+			if(snr>=info.singlePulseThreshold)
+			{
+				if(snr>peak.snr)
+				{
+					peak.sample=firstSample+(long long int)(end-width+1-carryLength)*scrunch;
+					peak.width=width*scrunch;
+					peak.series=series;
+					peak.snr=snr;
+				}
+			}
+			else if(peak.snr>0)
 			{
-				tempArray[tempCnt]=*(ptrBandshape+i);
-				tempCnt++;	
+				detections.push_back(peak);
+				peak.snr=0;
 			}
 		}
-		quicksort(tempArray,0,tempCnt-1);
-		*ptrSmoothBandshape=tempArray[tempCnt/2];
-		
-		*ptrSmoothSumBandshape+=(*ptrSmoothBandshape)*blockLength/cumBandshapeScale;
-		*ptrSmoothBandshape=(*ptrSmoothSumBandshape)*cumBandshapeScale/(*ptrCountBandshape);
-		*ptrNormalizedBandshape=*ptrBandshape/(*ptrSmoothBandshape);
-		if(*ptrNormalizedBandshape<minNormalizedBandshape)
-			minNormalizedBandshape=*ptrNormalizedBandshape;
-		if(*ptrNormalizedBandshape>maxNormalizedBandshape)
-			maxNormalizedBandshape=*ptrNormalizedBandshape;
-		if(*ptrSmoothBandshape==0)
+	}
+	delete[] prefixSum;
+	delete[] detrended;
+}
+/*******************************************************************
+*FUNCTION: void SinglePulseSearch::cluster(vector<SinglePulseDetection>& detections)
+*Friends of friends clustering of the detections in time and DM. A
+*cluster that started in this block and may go on into the next one 
+*is left in pending for the next block, the others become candidates.
+*******************************************************************/
+void SinglePulseSearch::cluster(vector<SinglePulseDetection>& detections)
+{
+	int n=detections.size();
+	vector<pair<long long int,int> > order(n);
+	for(int i=0;i<n;i++)
+		order[i]=make_pair(detections[i].sample,i);
+	sort(order.begin(),order.end());
+	int* root=new int[n];
+	for(int i=0;i<n;i++)
+		root[i]=i;
+	//Detections are linked to the earlier ones that are still within reach, longest boxcar decides the reach.
+	int maxWidth=1;
+	for(int i=0;i<n;i++)
+		maxWidth=(detections[i].width>maxWidth)?detections[i].width:maxWidth;
+	for(int a=0;a<n;a++)
+	{
+		SinglePulseDetection& x=detections[order[a].second];
+		for(int b=a-1;b>=0 && order[b].first+2*maxWidth>=x.sample;b--)
 		{
-			*ptrSmoothBandshape=1;
-			*ptrNormalizedBandshape=0;
+			SinglePulseDetection& y=detections[order[b].second];
+			int reach=(x.width>y.width)?x.width:y.width;
+			if(y.sample+y.width+reach<x.sample || abs(seriesRank[x.series]-seriesRank[y.series])>2)
+				continue;
+			int rx=order[a].second,ry=order[b].second;
+			while(root[rx]!=rx)
+				rx=root[rx];
+			while(root[ry]!=ry)
+				ry=root[ry];
+			root[rx]=ry;
 		}
 	}
-	delete[] tempArray;
+	//Brightest detection, extent and size of each cluster.
+	int* brightest=new int[n];
+	long long int* first=new long long int[n];
+	long long int* last=new long long int[n];
+	int* size=new int[n];
+	for(int i=0;i<n;i++)
+		size[i]=0;
+	for(int i=0;i<n;i++)
+	{
+		int r=i;
+		while(root[r]!=r)
+			r=root[r];
+		root[i]=r;
+		SinglePulseDetection& x=detections[i];
+		if(size[r]==0 || x.snr>detections[brightest[r]].snr)
+			brightest[r]=i;
+		if(size[r]==0 || x.sample<first[r])
+			first[r]=x.sample;
+		if(size[r]==0 || x.sample+x.width>last[r])
+			last[r]=x.sample+x.width;
+		size[r]++;
+	}
+	long long int endSample=startSample+length;
+	for(int i=0;i<n;i++)
+	{
+		int r=root[i];
+		if(first[r]>=startSample && last[r]+2*maxWidth>=endSample)
+		{
+			pending[polarIndex].push_back(detections[i]);
+			continue;
+		}
+		if(r!=i)
+			continue;
+		SinglePulseDetection& x=detections[brightest[r]];
+		SinglePulseCandidate candidate;
+		candidate.sample=x.sample;
+		candidate.mjd=info.MJDObs+(info.startBlockIndex*info.blockSizeSec+x.sample*info.samplingInterval)/86400.0;
+		candidate.dm=seriesDM[x.series];
+		candidate.snr=x.snr;
+		candidate.widthMs=x.width*info.samplingInterval*1000.0;
+		candidate.nDetections=size[r];
+		candidates.push_back(candidate);
+	}
+	delete[] root;
+	delete[] brightest;
+	delete[] first;
+	delete[] last;
+	delete[] size;
+}
+/*******************************************************************
+*FUNCTION: void SinglePulseSearch::write(const char*  filename)
+*const char*  fileName: Filename to write to.
+*Appends the candidates of the block to a file.
+*******************************************************************/
+void SinglePulseSearch::write(const char*  filename)
+{
+	ofstream candidateFile(filename,ios::app);
+	for(unsigned int i=0;i<candidates.size();i++)
+		candidateFile<<setprecision(15)<<candidates[i].mjd<<"\t"<<setprecision(6)<<candidates[i].dm<<"\t"<<candidates[i].snr<<"\t"<<candidates[i].widthMs<<"\t"<<candidates[i].sample<<"\t"<<candidates[i].nDetections<<endl;
+	candidateFile.close();
 }
 
+//implementation of SinglePulseSearch methods ends
+
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::normalizeBandshape()
-*Normalizes bandshape using externally supplied bandshape
-*Normalization inverts the effect of filter response to bring the power
-*levels of each channel to roughly 1.
-*Normalization helps in both time and frequency domain filtering.
-*Refer to documentations on it for more details.
+CLASS: ScratchFile
+*Anonymous scratch file shared by several growing OutOfCoreArrays, 
+*which take pages of pageLength elements from it as they grow, so they
+*hold a single file descriptor between them. Pages are read and 
+*written with pread() and pwrite(), so one thread can extend an array
+*while another reads what it already holds.
 *******************************************************************/
-void BasicAnalysis::normalizeBandshape() 
+class ScratchFile
 {
-	
-	int nChan= info.stopChannel-info.startChannel;
-	float *ptrSmoothBandshape=&smoothBandshape[info.startChannel];
-	float *ptrNormalizedBandshape=&normalizedBandshape[info.startChannel];
-	float *ptrBandshape=&bandshape[info.startChannel];
-	for(int j=0;j<nChan;j++,ptrBandshape++,ptrSmoothBandshape++,ptrNormalizedBandshape++)
+	public:
+		static const long int	pageLength;	//Elements in a page
+		FILE*		file;		//Scratch file, removed when it is closed
+		long long int	nPages;		//Pages handed out so far
+		
+		ScratchFile();	//constructor
+		~ScratchFile();
+		long long int newPage();	//Returns the index of a new page of the file
+};
+
+//implementation of ScratchFile methods begins
+
+const long int ScratchFile::pageLength=1<<16;	//256 kB of floats
+ScratchFile::ScratchFile()
+{
+	nPages=0;
+	file=tmpfile();
+	if(file==NULL)
 	{
-		if(*ptrSmoothBandshape==0)
-			*ptrNormalizedBandshape=0;
-		*ptrNormalizedBandshape=*ptrBandshape/(*ptrSmoothBandshape);
-		if(*ptrNormalizedBandshape<minNormalizedBandshape)
-			minNormalizedBandshape=*ptrNormalizedBandshape;
-		if(*ptrNormalizedBandshape>maxNormalizedBandshape)
-			maxNormalizedBandshape=*ptrNormalizedBandshape;
+		cout<<"Cannot create a scratch file."<<endl;
+		exit(1);
+	}
+}
+ScratchFile::~ScratchFile()
+{
+	fclose(file);
+}
+long long int ScratchFile::newPage()
+{
+	if(ftruncate(fileno(file),(off_t)((nPages+1)*pageLength*sizeof(float)))!=0)
+	{
+		cout<<"Cannot extend scratch file. Disk full?"<<endl;
+		exit(1);
 	}
+	return nPages++;
 }
 
+//implementation of ScratchFile methods ends
+
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::NormalizeData()
-*Normalizes data based on smooth bandshape.
+CLASS: OutOfCoreArray
+*Array of floats kept in memory or, when it is too long for memory, in
+*an anonymous scratch file that is removed when it is closed. Ranges
+*of the array are copied in and out with read() and write(); writing
+*past the end of an array kept in a file extends it.
+*An array that grows as it is written can also be kept in pages of a
+*ScratchFile shared with other arrays. Its pages are only appended, 
+*one thread may write past the end of it while others read ranges 
+*already written.
 *******************************************************************/
-void BasicAnalysis::normalizeData()
-{	
-	int startChannel=info.startChannel;
-	int nChan= info.stopChannel-startChannel;
-	int endExclude=info.noOfChannels-info.stopChannel;
-	float *ptrSmoothBandshape=&smoothBandshape[startChannel];
-	float *ptrRawData=rawData;	
-	for(int i=0;i<blockLength;i++)
-	{							
-		ptrRawData+=startChannel;
-		ptrSmoothBandshape=&smoothBandshape[startChannel];
-		for(int j=0;j<nChan;j++,ptrRawData++,ptrSmoothBandshape++)
-			(*ptrRawData)=(*ptrRawData)/(*ptrSmoothBandshape);		
-		ptrRawData+=endExclude;
+class OutOfCoreArray
+{
+	public:
+		long long int	length;		//Number of elements
+		float*		data;		//Elements in memory (NULL if they are in the file)
+		FILE*		file;		//Scratch file of the elements (NULL if they are in memory or in scratch)
+		ScratchFile*	scratch;	//Shared scratch file of the elements (NULL if not shared)
+		vector<long long int> pages;	//Page of scratch holding each pageLength elements
 		
+		OutOfCoreArray(long long int length_,char inMemory);	//constructor
+		OutOfCoreArray(ScratchFile* scratch_);	//constructor of an empty array in a shared scratch file
+		~OutOfCoreArray();
+		void read(long long int offset,long int n,float* out);		//Copies n elements from offset on to out
+		void write(long long int offset,long int n,const float* in);	//Copies n elements from in to offset on
+};
+
+//implementation of OutOfCoreArray methods begins
+
+/*******************************************************************
+*CONSTRUCTOR: OutOfCoreArray::OutOfCoreArray(long long int length_,char inMemory)
+*long long int length_	:Number of elements, all set to 0
+*char inMemory		:1-> elements kept in memory 0-> in a scratch file
+*******************************************************************/
+OutOfCoreArray::OutOfCoreArray(long long int length_,char inMemory)
+{
+	length=length_;
+	data=NULL;
+	file=NULL;
+	scratch=NULL;
+	if(inMemory)
+	{
+		data=new float[length];
+		memset(data,0,length*sizeof(float));
+		return;
+	}
+	file=tmpfile();
+	if(file==NULL || ftruncate(fileno(file),(off_t)(length*sizeof(float)))!=0)
+	{
+		cout<<"Cannot create a scratch file of "<<length*sizeof(float)<<" bytes."<<endl;
+		exit(1);
 	}
 }
-
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::computeZeroDM(char* freqFlags)
-*char* freqFlags : The channels marked 1 in this array is not 
-*included while computing zeroDM (or are clipped)
-*For no flagging, a char* variable with all 0's is passed on to this 
-*function
-*Subtracts the zero DM time series from each channel
+*CONSTRUCTOR: OutOfCoreArray::OutOfCoreArray(ScratchFile* scratch_)
+*ScratchFile* scratch_	:Shared scratch file, the array starts empty
 *******************************************************************/
-void BasicAnalysis::subtractZeroDM(char* freqFlags,float centralTendency)
+OutOfCoreArray::OutOfCoreArray(ScratchFile* scratch_)
 {
-	float*	ptrZeroDM;
-	float*	ptrCorrelationBandshape;
-	float*	ptrMeanToRmsBandshape;
-	float*  ptrNormalizedBandshape;
-	float* 	ptrRawData;
-	float 	count=0;					//Stores the number of channels added to get each time sample	
-	int 	startChannel=info.startChannel;
-	int 	nChan= info.stopChannel-startChannel;		//Number of channels to use
-	int 	endExclude=info.noOfChannels-info.stopChannel;	//Number of channels to exclude from the end of the band
-	int 	l= blockLength;
-	float 	zeroDMMean,zeroDMRMS;
-	for(int i=0;i<nChan;i++)
-		if(!freqFlags[i])
-			count++;
-	ptrZeroDM=zeroDM;
-	zeroDMMean=0.0;	
-	zeroDMRMS=0.0;
-	for(int i=0;i<l;i++,ptrZeroDM++)
+	length=0;
+	data=NULL;
+	file=NULL;
+	scratch=scratch_;
+}
+OutOfCoreArray::~OutOfCoreArray()
+{
+	if(data!=NULL)
+		delete[] data;
+	if(file!=NULL)
+		fclose(file);
+}
+void OutOfCoreArray::read(long long int offset,long int n,float* out)
+{
+	if(n<=0)
+		return;
+	if(data!=NULL)
 	{
-		zeroDMMean+=*ptrZeroDM;
-		zeroDMRMS+=(*ptrZeroDM)*(*ptrZeroDM);
+		memcpy(out,data+offset,n*sizeof(float));
+		return;
 	}
-	zeroDMMean/=l;
-	zeroDMRMS=zeroDMRMS/l-zeroDMMean*zeroDMMean;
-	ptrZeroDM=zeroDM;
-	ptrRawData=rawData;
-	ptrCorrelationBandshape=correlationBandshape;
-	for(int j=0;j<info.noOfChannels;j++,ptrCorrelationBandshape++)		
-		*ptrCorrelationBandshape=0;
-	for(int i=0;i<l;i++,ptrZeroDM++)
-	{	
-		ptrRawData+=startChannel;			//startChannel number of channels skipped at the start of the band
-		ptrCorrelationBandshape=correlationBandshape+startChannel;
-		ptrNormalizedBandshape=normalizedBandshape+startChannel;
-		for(int j=0;j<nChan;j++,ptrRawData++,ptrCorrelationBandshape++,ptrNormalizedBandshape++)		
-			*ptrCorrelationBandshape+=(*ptrZeroDM-zeroDMMean)*(*ptrRawData-*ptrNormalizedBandshape);
-		ptrRawData+=endExclude;				//endExclude number of channels skipped at the end of the band
+	if(scratch!=NULL)
+	{
+		int fd=fileno(scratch->file);
+		while(n>0)
+		{
+			long long int page;
+			long int pageOffset=offset%ScratchFile::pageLength;
+			long int m=(n<ScratchFile::pageLength-pageOffset)?n:ScratchFile::pageLength-pageOffset;
+			#pragma omp critical(scratchPages)
+			page=pages[offset/ScratchFile::pageLength];
+			if(pread(fd,out,m*sizeof(float),(off_t)((page*ScratchFile::pageLength+pageOffset)*sizeof(float)))!=(ssize_t)(m*sizeof(float)))
+			{
+				cout<<"Cannot read scratch file."<<endl;
+				exit(1);
+			}
+			offset+=m;
+			out+=m;
+			n-=m;
+		}
+		return;
 	}
-	ptrZeroDM=zeroDM;
-	ptrRawData=rawData;
-	for(int i=0;i<l;i++,ptrZeroDM++)
-	{	
-		ptrRawData+=startChannel;			//startChannel number of channels skipped at the start of the band
-		ptrCorrelationBandshape=correlationBandshape+startChannel;
-		ptrNormalizedBandshape=normalizedBandshape+startChannel;
-		ptrMeanToRmsBandshape=meanToRmsBandshape+startChannel;
-		for(int j=0;j<nChan;j++,ptrRawData++,ptrNormalizedBandshape++,ptrCorrelationBandshape++,ptrMeanToRmsBandshape++)		
-			*ptrRawData=(*ptrRawData-*ptrNormalizedBandshape)-(*ptrZeroDM-zeroDMMean)*(*ptrCorrelationBandshape/l)/zeroDMRMS+*ptrNormalizedBandshape;
-		ptrRawData+=endExclude;				//endExclude number of channels skipped at the end of the band
+	if(fseeko(file,(off_t)(offset*sizeof(float)),SEEK_SET)!=0 || fread(out,sizeof(float),n,file)!=(size_t)n)
+	{
+		cout<<"Cannot read scratch file."<<endl;
+		exit(1);
 	}
 }
-/*******************************************************************
-*FUNCTION: void BasicAnalysis::getFilteredRawData(float replacementValue)
-*float replacementValue - 0 or median/mode of zeroDM series
-*Replaces flagged values by zero or median when 2d time-freq data
-*is to be written out
-*******************************************************************/
-void BasicAnalysis::getFilteredRawData(char* timeFlags,char* freqFlags,float replacementValue)
+void OutOfCoreArray::write(long long int offset,long int n,const float* in)
 {
-	float* ptrRawData=rawData;
-	char* ptrTimeFlags=timeFlags;
-	char* ptrFreqFlags;
-	
-	long int pos;
-
-	int startChannel=info.startChannel;
-	int stopChannel=info.stopChannel;
-	int totalChan=info.noOfChannels;
-	int endExclude=info.noOfChannels-stopChannel;
-	filteredRawData=new short int[blockLength*totalChan];
-	short int* ptrFilteredRawData=filteredRawData;
-	for(long int i=0;i<blockLength;i++,ptrTimeFlags++)
+	if(n<=0)
+		return;
+	if(data!=NULL)
 	{
-			ptrFreqFlags=freqFlags;	
-			for(int j=0;j<startChannel;j++,ptrRawData++,ptrFilteredRawData++)
-				*ptrFilteredRawData=(short int)(replacementValue*info.meanval);
-
-			for(int j=startChannel;j<stopChannel;j++,ptrRawData++,ptrFreqFlags++,ptrFilteredRawData++)
+		memcpy(data+offset,in,n*sizeof(float));
+		return;
+	}
+	if(scratch!=NULL)
+	{
+		int fd=fileno(scratch->file);
+		long long int end=offset+n;
+		while(n>0)
+		{
+			long long int page;
+			long int pageOffset=offset%ScratchFile::pageLength;
+			long int m=(n<ScratchFile::pageLength-pageOffset)?n:ScratchFile::pageLength-pageOffset;
+			#pragma omp critical(scratchPages)
 			{
-
-				if((!*ptrTimeFlags)&(!*ptrFreqFlags))
-					*ptrFilteredRawData=(short int)((*ptrRawData)*info.meanval);
-				else
-					*ptrFilteredRawData=(short int)(replacementValue*info.meanval);					
+				while((long long int)pages.size()<=offset/ScratchFile::pageLength)
+					pages.push_back(scratch->newPage());
+				page=pages[offset/ScratchFile::pageLength];
 			}
-
-			for(int j=stopChannel;j<totalChan;j++,ptrRawData++,ptrFilteredRawData++)
-				*ptrFilteredRawData=(short int)(replacementValue*info.meanval);
+			if(pwrite(fd,in,m*sizeof(float),(off_t)((page*ScratchFile::pageLength+pageOffset)*sizeof(float)))!=(ssize_t)(m*sizeof(float)))
+			{
+				cout<<"Cannot write scratch file. Disk full?"<<endl;
+				exit(1);
+			}
+			offset+=m;
+			in+=m;
+			n-=m;
+		}
+		if(end>length)
+			length=end;
+		return;
+	}
+	if(fseeko(file,(off_t)(offset*sizeof(float)),SEEK_SET)!=0 || fwrite(in,sizeof(float),n,file)!=(size_t)n)
+	{
+		cout<<"Cannot write scratch file. Disk full?"<<endl;
+		exit(1);
 	}
+	if(offset+n>length)
+		length=offset+n;
 }
+
+//implementation of OutOfCoreArray methods ends
+
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags)
-*Replaces flagged values by the smooth bandshape value for that channel
+*Peak of the harmonically summed power spectrum of a segment.
 *******************************************************************/
-void BasicAnalysis::getFilteredRawDataSmoothBshape(char* timeFlags,char* freqFlags)
+struct PeriodicityCandidate
 {
-	float* ptrRawData=rawData;
-	char* ptrTimeFlags=timeFlags;
-	char* ptrFreqFlags;
-	
-	long int pos;
-
-	int startChannel=info.startChannel;
-	int stopChannel=info.stopChannel;
-	int totalChan=info.noOfChannels;
-	int endExclude=info.noOfChannels-stopChannel;
-	filteredRawData=new short int[blockLength*totalChan];
-	short int* ptrFilteredRawData=filteredRawData;
-	float *ptrSmoothBandshape;
-	for(long int i=0;i<blockLength;i++,ptrTimeFlags++)
-	{
-			ptrFreqFlags=freqFlags;	
-			ptrSmoothBandshape=smoothBandshape;
-			for(int j=0;j<startChannel;j++,ptrRawData++,ptrFilteredRawData++,ptrSmoothBandshape++)
-				*ptrFilteredRawData=*ptrSmoothBandshape;
+	double		mjd;		//MJD of the first sample of the segment
+	float		dm;		//DM of the series
+	double		frequency;	//Fundamental frequency in Hz
+	int		harmonics;	//Number of harmonics summed
+	float		sigma;		//Gaussian equivalent significance of the summed power
+	float		power;		//Summed whitened power
+	float		segmentSec;	//Length of the segment in seconds
+};
 
-			for(int j=startChannel;j<stopChannel;j++,ptrRawData++,ptrFreqFlags++,ptrFilteredRawData++,ptrSmoothBandshape++)
-			{
+/*******************************************************************
+CLASS: PeriodicitySearch
+*FFT search for periodic signals in the dedispersed series of a 
+*polarization: fullDM and, with -dmsearch, the series of every trial 
+*DM. Each series is appended block by block to the scratch file the 
+*series of the polarization share, time samples without data (before
+*the first complete sample, in flagged blocks or flagged in 
+*dedispFlags) are kept as NaN.
+*The series are searched in consecutive segments of segmentLength 
+*samples, or as a whole at the end of the observation. add() only 
+*queues the segments the blocks complete, they are searched by 
+*searchQueued() on the periodicity thread (see 
+*Runtime::periodicityTasks()) while the pipeline goes on.
+*A segment is mean subtracted (samples without data hold the last 
+*sample with data), zero padded to a power of 2 and transformed as a
+*half length complex FFT. Segments longer than 
+*maxInCoreLength complex points are transformed out of core with the
+*four-step FFT on scratch files, so that at most a few times 
+*maxInCoreLength points are in memory.
+*The power spectrum is whitened by the median power of frequency 
+*blocks that widen logarithmically, which removes red noise, and is 
+*then incoherently summed over 1,2,4.. up to periodicityHarmonics 
+*harmonics. The peaks of runs of sums above the threshold are ranked
+*by significance, harmonics of a stronger peak are dropped, and the 
+*rest are appended to periodicity.gpt.
+*******************************************************************/
+class PeriodicitySearch
+{
+	public:
+		//Static variables:
+		static Information	info;			//contains all input parameters
+		static int		nSeries;		//Number of series searched (fullDM and the trial DMs)
+		static int*		seriesScrunch;		//Number of time samples added to each sample of each series
+		static float*		seriesDM;		//DM of each series
+		static long long int	segmentLength;		//Time samples in a segment (0-> whole observation)
+		static float*		stageThreshold;		//Summed power at the threshold for 1,2,4.. harmonics
+		static const long int	maxInCoreLength;	//Longest complex FFT done in memory, also the points in memory in an out of core pass
+		static const int	maxCandidates;		//Most candidates written for a segment of a series
+		static const double	minFrequency;		//Lowest fundamental frequency searched in Hz
+		
+		//Variables:
+		int		polarIndex;		//Index of polarization to process
+		ScratchFile*	scratch;		//Scratch file shared by the series
+		OutOfCoreArray** series;		//Samples of each series so far
+		volatile long long int	queuedLength;	//Time samples up to the end of the last segment added (set by add())
+		long long int	searchedLength;		//Time samples up to the end of the last searched segment (set by searchQueued() and finish())
+		
+		//Functions:
+		PeriodicitySearch(Information info_);	//Constructor for first intialization
+		PeriodicitySearch(int polarIndex_);	//constructor
+		~PeriodicitySearch();
+		void add(float* fullDM,char* dedispFlags,long int firstSample,long int length,DMSearch* dmSearch);	//Appends the series of a block
+		char searchQueued();	//Searches the next segment added, if there is one
+		void finish();	//Searches what is left after the last segment
+		static double equivalentSigma(double power,int harmonics);	//Significance of summed whitened power
+		
+		private:
+		void searchSegment(long long int start,long long int length);	//Searches a segment of all series and writes out the candidates
+		void searchSeries(int q,long long int start,long long int length,vector<PeriodicityCandidate>& candidates);	//Searches a segment of a series
+		static void fourStepFFT(OutOfCoreArray* z,long long int n,OutOfCoreArray* out);	//Out of core complex FFT
+		static void realPowers(OutOfCoreArray* z,long long int n,OutOfCoreArray* powers);	//Power spectrum of a real series from its packed FFT
+		static void whiten(OutOfCoreArray* powers);	//Normalizes the power spectrum to unit mean noise power
+		static void harmonicSum(OutOfCoreArray* powers,double duration,vector<PeriodicityCandidate>& candidates);	//Finds the peaks of the harmonic sums
+};
 
-				if((!*ptrTimeFlags)&(!*ptrFreqFlags))
-					*ptrFilteredRawData=(short int)(*ptrRawData);
-				else
-					*ptrFilteredRawData=(short int)(*ptrSmoothBandshape);					
-			}
+//implementation of PeriodicitySearch methods begins
 
-			for(int j=stopChannel;j<totalChan;j++,ptrRawData++,ptrFilteredRawData++,ptrSmoothBandshape++)
-				*ptrFilteredRawData=*ptrSmoothBandshape;
+//Declaration of static variables.
+Information PeriodicitySearch::info;
+int PeriodicitySearch::nSeries;
+int* PeriodicitySearch::seriesScrunch;
+float* PeriodicitySearch::seriesDM;
+long long int PeriodicitySearch::segmentLength;
+float* PeriodicitySearch::stageThreshold;
+const long int PeriodicitySearch::maxInCoreLength=1<<22;	//32 MB of complex floats
+const int PeriodicitySearch::maxCandidates=200;
+const double PeriodicitySearch::minFrequency=0.1;
+/*******************************************************************
+*CONSTRUCTOR: PeriodicitySearch::PeriodicitySearch(Information _info)
+*Information _info: All input parameters are contained in this object
+*Series 0 is fullDM, series k+1 the trial k of DMSearch. DMSearch must
+*be initialized first.
+*******************************************************************/
+PeriodicitySearch::PeriodicitySearch(Information info_)
+{
+	info=info_;
+	series=NULL;
+	nSeries=1+(info.doDMSearch?DMSearch::nTrials:0);
+	seriesScrunch=new int[nSeries];
+	seriesDM=new float[nSeries];
+	for(int q=0;q<nSeries;q++)
+	{
+		seriesScrunch[q]=(q==0)?1:DMSearch::trialScrunch[q-1];
+		seriesDM[q]=(q==0)?info.dispersionMeasure:DMSearch::trialDM[q-1];
+	}
+	segmentLength=(long long int)(info.periodicitySegmentSec/info.samplingInterval+0.5);
+	//The significance grows with the summed power, the power at the threshold is found by bisection.
+	int nStages=0;
+	for(int harmonics=1;harmonics<=info.periodicityHarmonics;harmonics*=2)
+		nStages++;
+	stageThreshold=new float[nStages];
+	for(int stage=0;stage<nStages;stage++)
+	{
+		int harmonics=1<<stage;
+		double low=0,high=harmonics+10.0*info.periodicityThreshold*(sqrt((double)harmonics)+info.periodicityThreshold);
+		for(int i=0;i<60;i++)
+		{
+			double mid=(low+high)/2;
+			if(equivalentSigma(mid,harmonics)<info.periodicityThreshold)
+				low=mid;
+			else
+				high=mid;
+		}
+		stageThreshold[stage]=high;
 	}
 }
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::writeFilteredRawData(const char*  filename)
-*const char*  fileName: Filename to write to.
-*Writes out filtered rawdata where flagged samples have been replaced by 
-*zeros
+*CONSTRUCTOR: PeriodicitySearch::PeriodicitySearch(int polarIndex_)
+*int polarIndex_	:Index of current polarization to process
 *******************************************************************/
-void BasicAnalysis::writeFilteredRawData(const char*  filename)
+PeriodicitySearch::PeriodicitySearch(int polarIndex_)
 {
-	FILE* filteredRawDataFile;    
-	filteredRawDataFile = fopen(filename, "ab");
-	fwrite(filteredRawData, sizeof(short int), blockLength*info.noOfChannels, filteredRawDataFile); 
-	fclose(filteredRawDataFile); 
+	polarIndex=polarIndex_;
+	queuedLength=0;
+	searchedLength=0;
+	scratch=new ScratchFile();
+	series=new OutOfCoreArray*[nSeries];
+	for(int q=0;q<nSeries;q++)
+		series[q]=new OutOfCoreArray(scratch);
+}
+PeriodicitySearch::~PeriodicitySearch()
+{
+	if(series==NULL)
+		return;
+	for(int q=0;q<nSeries;q++)
+		delete series[q];
+	delete[] series;
+	delete scratch;
 }
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::writeBandshape(char* filename)
-*char* filename: Name of the file to which mean, mean smooth and rms bandshape will 
-*be written out.
-*Writes out the mean, mean smooth and rms bandshape (over the entire run of the program)
-*to the specified file.
+*FUNCTION: void PeriodicitySearch::add(float* fullDM,char* dedispFlags,long int firstSample,long int length,DMSearch* dmSearch)
+*float* fullDM		:Normalized dedispersed series of the block (NULL
+*			 if the block has none)
+*char* dedispFlags	:Samples of fullDM marked 1 have no data.
+*long int firstSample	:First sample of fullDM that is complete
+*long int length	:Number of time samples of the block
+*DMSearch* dmSearch	:Series of the trial DMs (NULL without -dmsearch)
+*The blocks of a polarization must be added in block order, from one 
+*thread. The segments the block completes are queued for 
+*searchQueued().
 *******************************************************************/
-void BasicAnalysis::writeBandshape(const char* filename)
+void PeriodicitySearch::add(float* fullDM,char* dedispFlags,long int firstSample,long int length,DMSearch* dmSearch)
 {
-	ofstream meanFile;
-	meanFile.open(filename);
-	double sMean,mean,rms;
-	meanFile<<"# chan_no \t smooth_bshape \t mean_bshape \t rms_bshape"<<endl;
-	for(int i=0;i<info.noOfChannels;i++)
+	float* samples=new float[length];
+	for(long int i=0;i<length;i++)
 	{
-		if(countBandshape[polarIndex][i]!=0)		
-		{
-			sMean=smoothSumBandshape[polarIndex][i]/countBandshape[polarIndex][i];	
-			mean=sumBandshape[polarIndex][i]/countBandshape[polarIndex][i];	
-			rms=sqrt((squareBandshape[polarIndex][i]/countBandshape[polarIndex][i])-pow(mean,2));	
-		}		
+		if(fullDM==NULL || i<firstSample || (dedispFlags!=NULL && dedispFlags[i]))
+			samples[i]=NAN;
 		else
-		{
-			sMean=0;
-			mean=0;
-			rms=-1;
-		}
-		meanFile<<i<<" "<<sMean*cumBandshapeScale<<" "<<mean*cumBandshapeScale<<" "<<rms*cumBandshapeScale<<endl;	
-			
-	}
-	meanFile.close();
+			samples[i]=fullDM[i];
+	}
+	series[0]->write(series[0]->length,length,samples);
+	delete[] samples;
+	for(int q=1;q<nSeries;q++)
+		series[q]->write(series[q]->length,length/seriesScrunch[q],dmSearch->series[q-1]);
+	long long int completedLength=queuedLength;
+	while(segmentLength>0 && series[0]->length>=completedLength+segmentLength)
+		completedLength+=segmentLength;
+	#pragma omp flush
+	queuedLength=completedLength;
 }
-
 /*******************************************************************
-*FUNCTION: void BasicAnalysis::writeBandshape(char* filename)
-*char* filename: Name of the file to which mean bandshape will 
-*be written out.
-*Writes out the mean bandshape (for current block)
-*to the specified file.
+*FUNCTION: char PeriodicitySearch::searchQueued()
+*returns 1 if a segment was searched, 0 if none was waiting.
+*Searches the oldest segment queued by add() that is not searched yet.
+*Segments of a polarization are searched from one thread, in order.
 *******************************************************************/
-void BasicAnalysis::writeCurBandshape(const char* filename)
+char PeriodicitySearch::searchQueued()
 {
-	ofstream meanFile;
-	meanFile.open(filename,ios::app);
-	meanFile<<blockLength<<" ";
-	if((int)info.bandshapeToUse==2 || info.doUseNormalizedData)
-		for(int i=0;i<info.noOfChannels;i++)
-		{			
-			if(smoothBandshape[i]==0)
-				meanFile<<0.0<<" ";	
-			else
-				meanFile<<bandshape[i]/smoothBandshape[i]<<" ";			
-		}	
-	else	
-		for(int i=0;i<info.noOfChannels;i++)
-		{			
-				meanFile<<bandshape[i]<<" ";				
-		}	
-	
-	meanFile<<endl;
-	meanFile.close();
+	if(searchedLength>=queuedLength)
+		return 0;
+	#pragma omp flush
+	searchSegment(searchedLength,segmentLength);
+	searchedLength+=segmentLength;
+	return 1;
 }
-
-//implementation of BasicAnalysis methods ends
-
 /*******************************************************************
-CLASS: RFIFiltering
-*Handles detecting and flagging Radio Frequency Interference (RFI) in
-*input data.
-*Contains methods to find the central tendency as well as the rms of 
-*the current block. Can be expanded to include multiple algorithms
-*to do so.
-*It also generates and writes flags.
+*FUNCTION: void PeriodicitySearch::finish()
+*Searches the whole observation, or with segments the samples after 
+*the last segment if they make at least half a segment. All blocks 
+*must have been added and the queued segments searched.
 *******************************************************************/
-class RFIFiltering
+void PeriodicitySearch::finish()
 {
-	
-	public:
-	float histogramInterval;
-	float*	input;			//Input array from which outliers are to be detected
-	int	inputSize;		//Size of input array
-	float	inputMax;		//Maximum and minimum elements of the array. Used by certain algorithms.
-	float	inputMin;		
-	float	centralTendency;	//Computed central tendency of the input data.
-	float	rms;			//Computer rms of the input data.
-	float	cutoff;			//Threshold above which samples are flagged.
-	float	cutoffToRms;		//Threshold to rms ratio.
-	char*	flags;			//Array where flags are stored. 1 implies outlier. 0 implies normal.
-	float*  sFlags;
-	//These variables are used when histogram based filtering is done
-	float*	histogram;
-	float*	histogramAxis;
-	int 	histogramSize;
-	int	histogramMax;
-	
-	
-	RFIFiltering(float* input_,int inputSize_);			//Constructor	
-	~RFIFiltering();						//Destructor
-	void computeStatistics(int algorithmCode);			//Wrapper to call appropiate function to find the central tendency and rms
-	void smoothFlags(int windowLength,float threshold);
-	void flagData();						//Function to generate flags once rms and central tendency has been found
-	void multiPointFlagData(float* multiCutoff);
-	void generateBlankFlags();					//Generates blank flags in case of no flagging
-	void writeFlags(const char* fileName);				//Writes out flags to a file
-	void writeFlags(const char* filename,char* startFlags,int nStartFlags,char* endFlags,int nEndFlags); //Writes out flags to a file with startFlags and endFlags appeneded at the beginning and end respectively.
-	void generateManualFlags(int nBadChanBlocks,int* badChanBlocks,int offset);	//flags user specified blocks
-	private:
-	void histogramBased();						//Finds mode for central tendency and rms based on finding the distribution
-	void MADBased();						//Finds median for central tendency and median absolute deviation for rms
-	void quicksort(float* x,long int first,long int last);		//Sorting routine used by MADBased() to sort the input
-	
-};
-//implementation of RFIFiltering methods
-
+	long long int remaining=series[0]->length-searchedLength;
+	if(remaining>0 && 2*remaining>=segmentLength)
+		searchSegment(searchedLength,remaining);
+	searchedLength=series[0]->length;
+}
 /*******************************************************************
-*CONSTRUCTOR: RFIFiltering::RFIFiltering(float* input_,int inputSize_)
-*float* input_  : Array from which outliers are to be detected.
-*int inputSize_ : Size of the input array
+*FUNCTION: double PeriodicitySearch::equivalentSigma(double power,int harmonics)
+*The whitened power of a bin is exponentially distributed with mean 1,
+*a sum of harmonics bins has the chance exp(-power)*sum(power^i/i!) 
+*(i<harmonics) of reaching power from noise. Returns the number of 
+*sigma of a gaussian with the same tail probability, from the 
+*asymptotic expansion of the gaussian tail (good above 2 sigma).
 *******************************************************************/
-RFIFiltering::RFIFiltering(float* input_,int inputSize_)
+double PeriodicitySearch::equivalentSigma(double power,int harmonics)
 {
-	input=input_;
-	inputSize=inputSize_;
-	flags=new char[inputSize];
-	sFlags=new float[inputSize];
-	histogram=NULL;
-	histogramAxis=NULL;
-	generateBlankFlags();  	
+	if(power<=0)
+		return 0;
+	double logTerm=0,logSum=0;
+	for(int i=1;i<harmonics;i++)
+	{
+		logTerm+=log(power/i);
+		logSum=(logTerm>logSum)?logTerm+log1p(exp(logSum-logTerm)):logSum+log1p(exp(logTerm-logSum));
+	}
+	double logChance=-power+logSum;
+	if(logChance>=log(0.5))
+		return 0;
+	double t=-2.0*logChance-log(2.0*M_PI);
+	double sigma=sqrt(-2.0*logChance);
+	for(int i=0;i<5;i++)
+		sigma=sqrt(t-2.0*log(sigma)>0?t-2.0*log(sigma):0);
+	return sigma;
 }
-
-
 /*******************************************************************
-*DESTRUCTOR: RFIFiltering::~RFIFiltering()
-*frees used memory
+*FUNCTION: void PeriodicitySearch::searchSegment(long long int start,long long int length)
+*long long int start	:First time sample of the segment
+*long long int length	:Time samples in the segment
+*Searches the segment of all series, the series in parallel, and 
+*appends the candidates to the file.
 *******************************************************************/
-RFIFiltering::~RFIFiltering()
+void PeriodicitySearch::searchSegment(long long int start,long long int length)
+{
+	vector<PeriodicityCandidate>* candidates=new vector<PeriodicityCandidate>[nSeries];
+	#pragma omp parallel for schedule(dynamic, 1) if(nSeries>1)
+	for(int q=0;q<nSeries;q++)
+		searchSeries(q,start,length,candidates[q]);
+	ostringstream filename;
+	if(info.doPolarMode)
+		filename<<"periodicity"<<polarIndex+1<<".gpt";
+	else
+		filename<<"periodicity.gpt";
+	ofstream candidateFile(filename.str().c_str(),ios::app);
+	for(int q=0;q<nSeries;q++)
+		for(unsigned int i=0;i<candidates[q].size();i++)
+		{
+			PeriodicityCandidate& x=candidates[q][i];
+			candidateFile<<setprecision(15)<<x.mjd<<"\t"<<setprecision(6)<<x.dm<<"\t"<<setprecision(10)<<1000.0/x.frequency<<"\t"<<x.frequency<<"\t"<<x.harmonics<<"\t"<<setprecision(6)<<x.sigma<<"\t"<<x.power<<"\t"<<x.segmentSec<<endl;
+		}
+	candidateFile.close();
+	delete[] candidates;
+}
+/*******************************************************************
+*FUNCTION: void PeriodicitySearch::searchSeries(int q,long long int start,long long int length,vector<PeriodicityCandidate>& candidates)
+*int q			:Index of the series
+*long long int start	:First time sample of the segment
+*long long int length	:Time samples in the segment
+*******************************************************************/
+void PeriodicitySearch::searchSeries(int q,long long int start,long long int length,vector<PeriodicityCandidate>& candidates)
 {
-	if(histogram!=NULL)
+	int scrunch=seriesScrunch[q];
+	long long int first=start/scrunch;
+	long long int n=length/scrunch;
+	if(first+n>series[q]->length)
+		n=series[q]->length-first;
+	if(n<64)
+		return;
+	long long int fftLength=64;
+	while(fftLength<n)
+		fftLength*=2;
+	long long int nComplex=fftLength/2;
+	char inMemory=(nComplex<=maxInCoreLength);
+	long int chunk=(n<maxInCoreLength)?n:maxInCoreLength;
+	float* buffer=new float[chunk];
+	
+	//Samples without data (NaN) hold the last sample with data, or the mean before the first, so that they add little power under red noise.
+	double sum=0;
+	long long int nData=0;
+	for(long long int i=0;i<n;i+=chunk)
+	{
+		long int m=(n-i<chunk)?n-i:chunk;
+		series[q]->read(first+i,m,buffer);
+		for(long int j=0;j<m;j++)
+			if(buffer[j]==buffer[j])
+			{
+				sum+=buffer[j];
+				nData++;
+			}
+	}
+	if(nData<n/2)
 	{
-		delete[] histogram;
-		delete[] histogramAxis;
+		delete[] buffer;
+		return;
+	}
+	float mean=sum/nData;
+	OutOfCoreArray* z=new OutOfCoreArray(fftLength,inMemory);
+	float last=0;
+	for(long long int i=0;i<n;i+=chunk)
+	{
+		long int m=(n-i<chunk)?n-i:chunk;
+		series[q]->read(first+i,m,buffer);
+		for(long int j=0;j<m;j++)
+		{
+			if(buffer[j]==buffer[j])
+				last=buffer[j]-mean;
+			buffer[j]=last;
+		}
+		z->write(i,m,buffer);
+	}
+	delete[] buffer;
+	
+	//Real samples 2m and 2m+1 are the real and imaginary parts of complex point m.
+	if(inMemory)
+	{
+		float* twiddle=twiddleTable(nComplex);
+		complexFFT(z->data,nComplex,twiddle);
+		delete[] twiddle;
+	}
+	else
+	{
+		OutOfCoreArray* transformed=new OutOfCoreArray(fftLength,0);
+		fourStepFFT(z,nComplex,transformed);
+		delete z;
+		z=transformed;
+	}
+	OutOfCoreArray* powers=new OutOfCoreArray(nComplex,inMemory);
+	realPowers(z,nComplex,powers);
+	delete z;
+	whiten(powers);
+	double duration=fftLength*info.samplingInterval*scrunch;
+	vector<PeriodicityCandidate> peaks;
+	harmonicSum(powers,duration,peaks);
+	delete powers;
+	
+	//Strongest first, peaks at a/b times the frequency of a stronger one (a,b up to the harmonics summed) are dropped.
+	vector<pair<float,int> > order(peaks.size());
+	for(unsigned int i=0;i<peaks.size();i++)
+		order[i]=make_pair(-peaks[i].sigma,i);
+	sort(order.begin(),order.end());
+	double resolution=1.0/duration;
+	for(unsigned int a=0;a<order.size() && (int)candidates.size()<maxCandidates;a++)
+	{
+		PeriodicityCandidate& x=peaks[order[a].second];
+		char isHarmonic=0;
+		for(unsigned int b=0;b<candidates.size() && !isHarmonic;b++)
+		{
+			PeriodicityCandidate& y=candidates[b];
+			for(int denominator=1;denominator<=info.periodicityHarmonics && !isHarmonic;denominator++)
+			{
+				double numerator=floor(denominator*x.frequency/y.frequency+0.5);
+				double tolerance=(1.0+(double)denominator/x.harmonics+numerator/y.harmonics)*resolution;
+				isHarmonic=(numerator>=1 && numerator<=info.periodicityHarmonics && fabs(denominator*x.frequency-numerator*y.frequency)<=tolerance);
+			}
+		}
+		if(isHarmonic)
+			continue;
+		x.mjd=info.MJDObs+(info.startBlockIndex*info.blockSizeSec+start*info.samplingInterval)/86400.0;
+		x.dm=seriesDM[q];
+		x.segmentSec=length*info.samplingInterval;
+		candidates.push_back(x);
 	}
-	delete[] flags;
-	delete[] sFlags;
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::computeStatistics(int algorithmCode)
-*int algorithmCode: algorithm to use 
-*Wrapper to select algorithm to find central tendency and rms.
+*FUNCTION: void PeriodicitySearch::fourStepFFT(OutOfCoreArray* z,long long int n,OutOfCoreArray* out)
+*OutOfCoreArray* z	:n interleaved complex points, overwritten
+*OutOfCoreArray* out	:FFT of z
+*n=rows*columns, point r*columns+c is taken as row r and column c.
+*The columns are transformed in bands of columns that fit in memory
+*and multiplied by the twiddle factors exp(-2 pi i r*c/n), then the
+*rows in bands of rows. Row r of the result holds frequencies 
+*r+rows*c, which are written out in natural order.
 *******************************************************************/
-void RFIFiltering::computeStatistics(int algorithmCode)
+void PeriodicitySearch::fourStepFFT(OutOfCoreArray* z,long long int n,OutOfCoreArray* out)
 {
-	switch(algorithmCode)
-	{
-		case 1:
-			histogramBased();
-			break;
-		case 2:
-			MADBased();
-			break;
+	long int rows=1;
+	while((long long int)rows*rows*4<=n)
+		rows*=2;
+	long int columns=n/rows;
+	long int bandWidth=maxInCoreLength/rows;
+	bandWidth=(bandWidth<1)?1:((bandWidth>columns)?columns:bandWidth);
+	float* band=new float[2*rows*bandWidth];
+	float* transposed=new float[2*rows*bandWidth];
+	float* twiddle=twiddleTable(rows);
+	for(long int c0=0;c0<columns;c0+=bandWidth)
+	{
+		for(long int r=0;r<rows;r++)
+			z->read(2*((long long int)r*columns+c0),2*bandWidth,band+2*r*bandWidth);
+		#pragma omp parallel for
+		for(long int j=0;j<bandWidth;j++)
+		{
+			float* column=transposed+2*j*rows;
+			for(long int r=0;r<rows;r++)
+			{
+				column[2*r]=band[2*(r*bandWidth+j)];
+				column[2*r+1]=band[2*(r*bandWidth+j)+1];
+			}
+			complexFFT(column,rows,twiddle);
+			double stepRe=cos(2.0*M_PI*(c0+j)/n),stepIm=-sin(2.0*M_PI*(c0+j)/n);
+			double wRe=1,wIm=0;
+			for(long int r=0;r<rows;r++)
+			{
+				double re=column[2*r],im=column[2*r+1];
+				band[2*(r*bandWidth+j)]=re*wRe-im*wIm;
+				band[2*(r*bandWidth+j)+1]=re*wIm+im*wRe;
+				double t=wRe*stepRe-wIm*stepIm;
+				wIm=wRe*stepIm+wIm*stepRe;
+				wRe=t;
+			}
+		}
+		for(long int r=0;r<rows;r++)
+			z->write(2*((long long int)r*columns+c0),2*bandWidth,band+2*r*bandWidth);
+	}
+	delete[] band;
+	delete[] transposed;
+	delete[] twiddle;
+	
+	long int bandHeight=maxInCoreLength/columns;
+	bandHeight=(bandHeight<1)?1:((bandHeight>rows)?rows:bandHeight);
+	band=new float[2*bandHeight*columns];
+	transposed=new float[2*bandHeight];
+	twiddle=twiddleTable(columns);
+	for(long int r0=0;r0<rows;r0+=bandHeight)
+	{
+		z->read(2*(long long int)r0*columns,2*bandHeight*columns,band);
+		#pragma omp parallel for
+		for(long int i=0;i<bandHeight;i++)
+			complexFFT(band+2*i*columns,columns,twiddle);
+		for(long int c=0;c<columns;c++)
+		{
+			for(long int i=0;i<bandHeight;i++)
+			{
+				transposed[2*i]=band[2*(i*columns+c)];
+				transposed[2*i+1]=band[2*(i*columns+c)+1];
+			}
+			out->write(2*((long long int)c*rows+r0),2*bandHeight,transposed);
+		}
 	}
+	delete[] band;
+	delete[] transposed;
+	delete[] twiddle;
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::quicksort(float* x,long int first,long int last)
-*sorts a given array using quicksort algorithm.
-/*******************************************************************/
-void RFIFiltering::quicksort(float* x,long int first,long int last)
+*FUNCTION: void PeriodicitySearch::realPowers(OutOfCoreArray* z,long long int n,OutOfCoreArray* powers)
+*OutOfCoreArray* z	:FFT Z of n complex points packed from 2n reals
+*OutOfCoreArray* powers	:Powers of frequencies 0 to n-1 of the reals
+*The spectrum of the reals is X(k)=E(k)+exp(-pi i k/n)O(k), with 
+*E(k)=(Z(k)+Z*(n-k))/2 and O(k)=(Z(k)-Z*(n-k))/2i. Z(k) and Z(n-k) 
+*are read in chunks from both ends. The power of frequency 0 is 0.
+*******************************************************************/
+void PeriodicitySearch::realPowers(OutOfCoreArray* z,long long int n,OutOfCoreArray* powers)
 {
-    int pivot,j,i;
-    float temp;
-
-     if(first<last){
-         pivot=first;
-         i=first;
-         j=last;
-
-         while(i<j){
-             while(x[i]<=x[pivot]&&i<last)
-                 i++;
-             while(x[j]>x[pivot])
-                 j--;
-             if(i<j){
-                 temp=x[i];
-                  x[i]=x[j];
-                  x[j]=temp;
-             }
-         }
-
-         temp=x[pivot];
-         x[pivot]=x[j];
-         x[j]=temp;
-         quicksort(x,first,j-1);
-         quicksort(x,j+1,last);
-
-    }
+	long int chunk=(n<maxInCoreLength)?n:maxInCoreLength;
+	float* front=new float[2*chunk];
+	float* back=new float[2*chunk];
+	float* power=new float[chunk];
+	for(long long int k0=0;k0<n;k0+=chunk)
+	{
+		long int m=(n-k0<chunk)?n-k0:chunk;
+		z->read(2*k0,2*m,front);
+		//back holds Z(n-k0-m+1) to Z(n-k0), Z(n) being Z(0).
+		if(k0==0)
+		{
+			z->read(2*(n-m+1),2*(m-1),back);
+			z->read(0,2,back+2*(m-1));
+		}
+		else
+			z->read(2*(n-k0-m+1),2*m,back);
+		double stepRe=cos(M_PI/n),stepIm=-sin(M_PI/n);
+		double wRe=cos(M_PI*k0/n),wIm=-sin(M_PI*k0/n);
+		for(long int i=0;i<m;i++)
+		{
+			double a=front[2*i],b=front[2*i+1];
+			double c=back[2*(m-1-i)],d=back[2*(m-1-i)+1];
+			double evenRe=(a+c)/2,evenIm=(b-d)/2;
+			double oddRe=(b+d)/2,oddIm=(c-a)/2;
+			double re=evenRe+wRe*oddRe-wIm*oddIm;
+			double im=evenIm+wRe*oddIm+wIm*oddRe;
+			power[i]=re*re+im*im;
+			double t=wRe*stepRe-wIm*stepIm;
+			wIm=wRe*stepIm+wIm*stepRe;
+			wRe=t;
+		}
+		if(k0==0)
+			power[0]=0;
+		powers->write(k0,m,power);
+	}
+	delete[] front;
+	delete[] back;
+	delete[] power;
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::MADBased()
-*Median Absolute Deviation (MAD) based algorithm to calculate
-*mean and rms of the underlying gaussian from which the dataset 
-*is derived. It uses median to estimate the central tendency and
-*MAD to estimate the variance. 
+*FUNCTION: void PeriodicitySearch::whiten(OutOfCoreArray* powers)
+*Divides the powers by the median power of blocks of frequencies, 
+*starting at 16 bins and 20% wider for each next block up to 2048 
+*bins. The median of exponentially distributed noise power is ln 2 
+*times its mean, so noise power ends up with mean 1.
 *******************************************************************/
-void RFIFiltering::MADBased()
+void PeriodicitySearch::whiten(OutOfCoreArray* powers)
 {
-	float *ptrInput=input;
-	float *tempInput=new float[inputSize];
-	float *ptrTempInput=tempInput;
-	/*Copies the input array to another array for sorting.
-	*This is done to avoid scrambling the original array 
-	*which may be in use by other objects*/
-	for(long int i=0;i<inputSize;i++,ptrInput++,ptrTempInput++)
-		*ptrTempInput=*ptrInput;
-
-	quicksort(tempInput,0,inputSize-1); //sorts the entire array
-	//median is calculated
-	if(inputSize%2==0)
-		centralTendency=(tempInput[inputSize/2-1]+tempInput[inputSize/2])/2.0;
-	else
-		centralTendency=tempInput[inputSize/2];
-	ptrTempInput=tempInput;
-	//Deviations from the median is calculated and its median used to estimate rms
-	for(long int i=0;i<inputSize;i++,ptrTempInput++)
-		*ptrTempInput=fabs(*ptrTempInput-centralTendency);
-	quicksort(tempInput,0,inputSize-1);
-	
-	if(inputSize%2==0)
-		rms=(tempInput[inputSize/2-1]+tempInput[inputSize/2])/2.0;
-	else
-		rms=tempInput[inputSize/2];
-	rms=rms*1.4826;
-	cutoff=rms*cutoffToRms;
-	delete[] tempInput;
+	const long int maxWidth=2048;
+	long long int n=powers->length;
+	float* block=new float[2*maxWidth];
+	float* sorted=new float[2*maxWidth];
+	double width=16;
+	for(long long int k0=1;k0<n;)
+	{
+		long int w=(long int)width;
+		if(n-k0<2*w)
+			w=n-k0;
+		powers->read(k0,w,block);
+		memcpy(sorted,block,w*sizeof(float));
+		nth_element(sorted,sorted+w/2,sorted+w);
+		float scale=(sorted[w/2]>0)?log(2.0)/sorted[w/2]:0.0f;
+		for(long int i=0;i<w;i++)
+			block[i]*=scale;
+		powers->write(k0,w,block);
+		k0+=w;
+		width=(width*1.2<maxWidth)?width*1.2:maxWidth;
+	}
+	delete[] block;
+	delete[] sorted;
+}
+/*******************************************************************
+*FUNCTION: void PeriodicitySearch::harmonicSum(OutOfCoreArray* powers,double duration,vector<PeriodicityCandidate>& candidates)
+*OutOfCoreArray* powers	:Whitened powers, bin k at frequency k/duration
+*The sum of h harmonics at bin k adds the powers of bins jk/h (rounded)
+*for j=1..h, its fundamental is at k/h. The sum of 2h harmonics is 
+*that of h harmonics plus the odd j, so each stage only adds the odd
+*harmonics to the sums of the stage before. Bins are taken up in 
+*chunks, the powers the odd harmonics of a chunk need are contiguous.
+*The peak of each run of sums above the threshold of a stage is a 
+*candidate, only the strongest 4*maxCandidates are kept.
+*******************************************************************/
+void PeriodicitySearch::harmonicSum(OutOfCoreArray* powers,double duration,vector<PeriodicityCandidate>& candidates)
+{
+	long long int n=powers->length;
+	long int chunk=(n<maxInCoreLength/4)?n:maxInCoreLength/4;
+	long long int minBin=(long long int)ceil(minFrequency*duration);
+	minBin=(minBin<2)?2:minBin;
+	int nStages=0;
+	for(int harmonics=1;harmonics<=info.periodicityHarmonics;harmonics*=2)
+		nStages++;
+	float* sum=new float[chunk];
+	float* harmonic=new float[chunk+2];
+	PeriodicityCandidate* peak=new PeriodicityCandidate[nStages];
+	for(int stage=0;stage<nStages;stage++)
+		peak[stage].power=0;
+	for(long long int k0=0;k0<n;k0+=chunk)
+	{
+		long int m=(n-k0<chunk)?n-k0:chunk;
+		memset(sum,0,m*sizeof(float));
+		for(int stage=0;stage<nStages;stage++)
+		{
+			int harmonics=1<<stage;
+			for(int j=1;j<harmonics || j==1;j+=2)
+			{
+				long long int low=(j*k0+harmonics/2)/harmonics;
+				long long int high=(j*(k0+m-1)+harmonics/2)/harmonics;
+				powers->read(low,high-low+1,harmonic);
+				for(long int i=0;i<m;i++)
+					sum[i]+=harmonic[(j*(k0+i)+harmonics/2)/harmonics-low];
+			}
+			long int i=(harmonics*minBin>k0)?harmonics*minBin-k0:0;
+			for(;i<m;i++)
+			{
+				if(sum[i]>=stageThreshold[stage])
+				{
+					if(sum[i]>peak[stage].power)
+					{
+						peak[stage].frequency=(k0+i)/(harmonics*duration);
+						peak[stage].harmonics=harmonics;
+						peak[stage].power=sum[i];
+					}
+				}
+				else if(peak[stage].power>0)
+				{
+					peak[stage].sigma=equivalentSigma(peak[stage].power,harmonics);
+					candidates.push_back(peak[stage]);
+					peak[stage].power=0;
+				}
+			}
+		}
+		if((int)candidates.size()>8*maxCandidates)
+		{
+			vector<pair<float,int> > order(candidates.size());
+			for(unsigned int i=0;i<candidates.size();i++)
+				order[i]=make_pair(-candidates[i].sigma,i);
+			nth_element(order.begin(),order.begin()+4*maxCandidates,order.end());
+			vector<PeriodicityCandidate> strongest;
+			for(int i=0;i<4*maxCandidates;i++)
+				strongest.push_back(candidates[order[i].second]);
+			candidates.swap(strongest);
+		}
+	}
+	for(int stage=0;stage<nStages;stage++)
+		if(peak[stage].power>0)
+		{
+			peak[stage].sigma=equivalentSigma(peak[stage].power,peak[stage].harmonics);
+			candidates.push_back(peak[stage]);
+		}
+	delete[] sum;
+	delete[] harmonic;
+	delete[] peak;
 }
+
+//implementation of PeriodicitySearch methods ends
+
 /*******************************************************************
-*FUNCTION: void RFIFiltering::histogramBased()
-*This algorithm bins datapoints to form a histogram of size histogramSize.
-*It then uses the modal point of the histogram to estimate the central 
-*tendency and then uses it along with the width at half maximum to find
-*variance.
+CLASS: SubintCube
+*Folds the 2-D data into a (subint x subband x polarization x bin) 
+*cube. Sample i of channel j goes into dedispersed sample 
+*startSample+i+delayTable[j], so every block folds its own samples at
+*the phases of the dedispersed samples they belong to, with no carry
+*between blocks. This is the same as folding dedispersed subband series
+*aligned like fullDM. Phases and subints are counted from the first
+*folded sample (maxDelay), as for the profile.
+*Each block folds into a partial cube of the subints it adds to. The
+*partial cubes are merged in block order and a subint is written once
+*no later block can add to it.
+*File format (native byte order):
+*	header	:char[8] "GPTCUBE", int nSubbands, int nPol, int nBins,
+*		 double subint length (s), double sampling interval (s),
+*		 double MJD of the first folded sample, double period (ms),
+*		 double DM, double centre frequency of each subband (MHz)
+*	subint	:int subint index, float number of samples folded 
+*		 [subband][pol], float mean [subband][pol][bin] (0 for 
+*		 empty bins)
 *******************************************************************/
-void RFIFiltering::histogramBased()
-{	
-	float *ptrInput,interval;
-	int modeHeight,modeIndex;
-	int p;
-	interval=histogramInterval;
-	histogramSize=(inputMax-inputMin)/(interval);
-	histogramSize++;
-	histogram=new float[histogramSize];
-	histogramAxis=new float[histogramSize];
-	for (int i=0;i<histogramSize;i++)
-		 histogram[i]=0;
-	ptrInput=&(input[0]);
-	for(int i=0;i< inputSize;i++,ptrInput++)
-		 histogram[(int)((*ptrInput-inputMin)/interval)]++; //Computing histogram
+class SubintCube
+{
+	public:
+		//Static variables:
+		static Information	info;			//contains all input parameters
+		static int		nSubbands;		//Number of subbands
+		static int		nBins;			//Number of bins in a period
+		static long int		subintSamples;		//Length of a subint in samples
+		static int*		channelSubband;		//Subband of each channel (from startChannel)
+		static int*		delayTable;		//Delay of each channel (AdvancedAnalysis::delayTable)
+		static int		maxDelay;		//Largest delay (AdvancedAnalysis::maxDelay)
+		static int		tileLength;		//Number of time samples per channel major tile in fold() (AdvancedAnalysis::dedispersionTileLength)
+		static double		initPhasePolyco;	//Polyco phase of the first folded sample
+		static map<long int,double*>	pendingSums;	//Sums of the subints not yet written ([subband][pol][bin])
+		static map<long int,double*>	pendingCounts;	//Number of samples in each bin of the subints not yet written
+		static string		fileName;		//File the cube is written to
+		
+		//Variables:
+		int		polarIndex;		//Index of polarization to process
+		long long int	startSample;		//Number of time samples before the block
+		long int	length;			//Number of time samples of the block
+		long int	firstSubint;		//First subint the block adds to
+		int		nSubints;		//Number of subints the block adds to
+		float*		sums;			//Partial cube of the block ([subint][subband][bin])
+		int*		counts;			//Number of samples in each bin of the partial cube
+		long int*	offset;			//Offset into the partial cube of each dedispersed sample the block adds to, -1 if not folded (during fold())
+		
+		//Functions:
+		SubintCube(Information info_,int* delayTable_,int maxDelay_,int tileLength_);	//Constructor for first intialization
+		SubintCube(int polarIndex_,long long int startSample_,long int length_);	//constructor
+		~SubintCube();
+		void fold(float* rawData,char* timeFlags,char* freqFlags,char* sampleFlags);	//Folds the block into its partial cube
+		void addRow(int j,const float* row,const float* weight,int n,long int first);	//Folds a channel row of a tile (see walkChannelRows())
+		void merge();				//Adds the partial cube to the subints not yet written
+		static void writeHeader(const char* filename);	//Starts the cube file
+		static void writeComplete(long long int endSample,char flush);	//Writes the subints the blocks after endSample do not add to
+};
 
+//implementation of SubintCube methods begins
 
-	modeHeight=0;
-	modeIndex=0;
-	//finding modal point
-	for (int i=0;i<histogramSize;i++)
-	{
-		if(histogram[i]>modeHeight)
-		{
-			modeHeight=histogram[i];
-			modeIndex=i;
-		}
-	}
-	if(modeHeight==0) 
-		return;
-	histogramMax=modeHeight;
-	p=0;	
-	while(histogram[modeIndex+p]>=histogram[modeIndex]/2.0) //finding index of half on the right
-		p++;
-	int q=0;
-	while(histogram[modeIndex+q]>=histogram[modeIndex]/2.0) //finding index of half on the left
-		q--;
-	
-	centralTendency=(modeIndex+0.5)*interval+inputMin;
-	/*rms=(p*interval)/(sqrt(2*log(histogram[modeIndex]/(float)histogram[modeIndex+p])));
-	rms+=(p*interval)/(sqrt(2*log(histogram[modeIndex]/(float)histogram[modeIndex-p])));
-	rms/=2.0;*/
-	rms=(p-q)*interval/2.355;
-	for (int i=0;i<histogramSize;i++)
-		histogramAxis[i]=(i*interval+inputMin-centralTendency)/rms;
-	
-	cutoff=rms*cutoffToRms;
-	histogramInterval=(4.0*rms)/(pow(inputSize,1/3.0));	
-}
+//Declaration of static variables.
+Information SubintCube::info;
+int SubintCube::nSubbands;
+int SubintCube::nBins;
+long int SubintCube::subintSamples;
+int* SubintCube::channelSubband;
+int* SubintCube::delayTable;
+int SubintCube::maxDelay;
+int SubintCube::tileLength;
+double SubintCube::initPhasePolyco;
+map<long int,double*> SubintCube::pendingSums;
+map<long int,double*> SubintCube::pendingCounts;
+string SubintCube::fileName;
 /*******************************************************************
-*FUNCTION: void RFIFiltering::smoothFlags()
-*Generates a smooth version of the flags
+*CONSTRUCTOR: SubintCube::SubintCube(Information _info,int* delayTable_,int maxDelay_,int tileLength_)
+*Information _info: All input parameters are contained in this object
+*int* delayTable_	:Delay table of the dedispersion
+*int maxDelay_		:Largest delay of the dedispersion
+*int tileLength_	:Tile length of the dedispersion
 *******************************************************************/
-void RFIFiltering::smoothFlags(int windowLength,float threshold)
+SubintCube::SubintCube(Information info_,int* delayTable_,int maxDelay_,int tileLength_)
 {
-	float* ptrSmoothFlags;
-	char* ptrFlags;
-	ptrFlags=flags;	 
-	ptrSmoothFlags=sFlags;
-	float sum;
-	int count;
-	int s=windowLength/2;
-	
-	for(int i=0;i< inputSize;i++,ptrFlags++,ptrSmoothFlags++)
-	{
-		sum=0;
-		count=0;
-	       for(int j=-s;j<=s && i+j<inputSize;j++)	
-	       {
-	       		if(i+j<0)
-	       			continue;
-	       		sum+=(*(ptrFlags+j));
-	       		count++;
-	       }
-	       *ptrSmoothFlags=1.0-(sum/count);
-	}
-	ptrFlags=flags;	 
-	ptrSmoothFlags=sFlags;
-	for(int i=0;i< inputSize;i++,ptrFlags++,ptrSmoothFlags++)
+	info=info_;
+	delayTable=delayTable_;
+	maxDelay=maxDelay_;
+	tileLength=tileLength_;
+	nSubints=0;
+	sums=NULL;
+	counts=NULL;
+	int nChan=info.stopChannel-info.startChannel;
+	nSubbands=(info.cubeSubbands<nChan)?info.cubeSubbands:nChan;
+	nBins=info.periodInSamples;
+	subintSamples=(long int)(info.cubeSubintSec/info.samplingInterval+0.5);
+	if(subintSamples<1)
+		subintSamples=1;
+	channelSubband=new int[nChan];
+	for(int j=0;j<nChan;j++)
+		channelSubband[j]=(long int)j*nSubbands/nChan;
+	if(!info.doFixedPeriodFolding)
 	{
-		if(*ptrSmoothFlags<threshold)
-		{
-		 	for(int j=-s;j<=s && i+j<inputSize;j++)	
-	       		{
-	       			if(i+j<0)
-	       				continue;
-	       			*(ptrFlags+j)=1;
-	       		}
-	       		
-	       	}
-	       
+		long double phase;
+		double slope,curvature;
+		info.expandPolyco(maxDelay*info.samplingInterval*1000.0,phase,slope,curvature);
+		initPhasePolyco=(double)(phase-floorl(phase));
 	}
-	
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::generateManualFlags(int nBadChanBlocks,int* badChanBlocks)
-*Flags blocks specified by user (usually blocks of channels)
+*CONSTRUCTOR: SubintCube::SubintCube(int polarIndex_,long long int startSample_,long int length_)
+*int polarIndex_		:Index of current polarization to process
+*long long int startSample_	:Number of time samples before the block
+*long int length_		:Number of time samples of the block
+*The block adds to dedispersed samples startSample to 
+*startSample+length+maxDelay-1.
 *******************************************************************/
-void RFIFiltering::generateManualFlags(int nBadChanBlocks,int* badChanBlocks,int offset)
+SubintCube::SubintCube(int polarIndex_,long long int startSample_,long int length_)
 {
-	for(int i=0;i<nBadChanBlocks;i++)
-	{		
-		for(int j=badChanBlocks[i*2];j<badChanBlocks[i*2+1];j++)
-		{	
-			if(j-offset<0 or j-offset>=inputSize)	
-				continue;	
-			flags[j-offset]=1;
-		}
-	}
+	polarIndex=polarIndex_;
+	startSample=startSample_;
+	length=length_;
+	long long int first=startSample-maxDelay;
+	long long int last=startSample+length-1;
+	if(first<0)
+		first=0;
+	nSubints=0;
+	firstSubint=first/subintSamples;
+	if(last>=first)
+		nSubints=last/subintSamples-firstSubint+1;
+	sums=new float[(long int)nSubints*nSubbands*nBins];
+	counts=new int[(long int)nSubints*nSubbands*nBins];
+	memset(sums,0,(long int)nSubints*nSubbands*nBins*sizeof(float));
+	memset(counts,0,(long int)nSubints*nSubbands*nBins*sizeof(int));
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::generateBlankFlags()
-*In cases when an array containing blank flags (all zeroes,no flagging)
-*is required by other functions.
+*DESTRUCTOR: SubintCube::~SubintCube()
+*frees up used memory.
 *******************************************************************/
-void RFIFiltering::generateBlankFlags()
+SubintCube::~SubintCube()
 {
-	float* ptrInput;
-	char* ptrFlags;
-	ptrFlags=flags;	 
-	for(int i=0;i< inputSize;i++,ptrFlags++)
-	       *ptrFlags=0;	
+	delete[] sums;
+	delete[] counts;
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::generateBlankFlags()
-*Flagging of data based on its deviation from central tendency being
-*above a certain threshold.
+*FUNCTION: void SubintCube::fold(float* rawData,char* timeFlags,char* freqFlags,char* sampleFlags)
+*float* rawData		:2-D data of the block
+*char* timeFlags	:Time samples marked 1 are left out.
+*char* freqFlags	:Channels (from startChannel) marked 1 are left out.
+*char* sampleFlags	:Individual samples marked 1 are left out (NULL if
+*			 none are)
+*The bin and subint of each dedispersed sample the block adds to are 
+*found once. The block is then walked channel row by channel row (see
+*walkChannelRows()), each row reads them at its delay.
 *******************************************************************/
-void RFIFiltering::flagData()
+void SubintCube::fold(float* rawData,char* timeFlags,char* freqFlags,char* sampleFlags)
 {
-	float* ptrInput;
-	char* ptrFlags;
-	ptrInput=input;
-	ptrFlags=flags;
-	for(int i=0;i< inputSize;i++,ptrInput++,ptrFlags++)
+	long int span=length+maxDelay;
+	offset=new long int[span];
+	long int firstFolded=(startSample<maxDelay)?maxDelay-startSample:0;
+	if(firstFolded>span)
+		firstFolded=span;
+	int* bins=new int[span-firstFolded];
+	double samplingIntervalMs=info.samplingInterval*1000.0;
+	foldingBins(info,maxDelay*samplingIntervalMs,(startSample+firstFolded-maxDelay)*samplingIntervalMs,initPhasePolyco,span-firstFolded,bins);
+	for(long int p=0;p<span;p++)
 	{
-		if(fabs(*ptrInput-centralTendency)>cutoff)
-			*ptrFlags=1;
+		long long int sample=startSample+p;
+		if(p<firstFolded)
+			offset[p]=-1;
+		else
+			offset[p]=((sample-maxDelay)/subintSamples-firstSubint)*nSubbands*nBins+bins[p-firstFolded];
 	}
+	delete[] bins;
+	walkChannelRows(info,rawData,timeFlags,freqFlags,sampleFlags,0,length,tileLength,0,*this);
+	delete[] offset;
+	offset=NULL;
 }
 /*******************************************************************
-*FUNCTION: void RFIFiltering::generateBlankFlags()
-*Flagging of data based on its deviation from central tendency being
-*above a certain threshold.
+*FUNCTION: void SubintCube::addRow(int j,const float* row,const float* weight,int n,long int first)
+*Folds n samples of channel j from time sample first into the subband
+*of the channel, at the offsets of the dedispersed samples they go to.
 *******************************************************************/
-/*void RFIFiltering::multiPointFlagData(float* multiCutoff)
+void SubintCube::addRow(int j,const float* row,const float* weight,int n,long int first)
 {
-	float* ptrInput;
-	char* ptrFlags;
-	char thisFlag=0;
-	short last=3;
-	ptrInput=input;
-	ptrFlags=flags;
-	for(int i=0;i< inputSize;i++,ptrFlags++)
-		*ptrFlags=0;
-	ptrFlags=flags;
-	for(int i=0;i< inputSize;i++,ptrInput++,ptrFlags++)
+	long int subband=channelSubband[j]*nBins;
+	foldRow(row,weight,n,&offset[first+delayTable[j+info.startChannel]],&sums[subband],&counts[subband]);
+}
+/*******************************************************************
+*FUNCTION: void SubintCube::merge()
+*Adds the partial cube of the block to the subints not yet written.
+*Called from the I/O thread in block order.
+*******************************************************************/
+void SubintCube::merge()
+{
+	long int subintSize=(long int)nSubbands*info.noOfPol*nBins;
+	for(int q=0;q<nSubints;q++)
 	{
-		last=3;
-		if(i+last>inputSize)
-			last=inputSize-i;
-		for(int k=0;k<last;k++)
+		long int subint=firstSubint+q;
+		if(pendingSums.find(subint)==pendingSums.end())
 		{
-			thisFlag=1;
-			for(int p=0;p<k;p++)
-				if(thisFlag && (fabs(*(ptrInput+p)-centralTendency)>multiCutoff[k]*rms))
-					thisFlag=1;
-				else
-					thisFlag=0;
-			for(int p=0;p<k;p++)
+			pendingSums[subint]=new double[subintSize];
+			pendingCounts[subint]=new double[subintSize];
+			memset(pendingSums[subint],0,subintSize*sizeof(double));
+			memset(pendingCounts[subint],0,subintSize*sizeof(double));
+		}
+		double* subintSums=pendingSums[subint];
+		double* subintCounts=pendingCounts[subint];
+		for(int s=0;s<nSubbands;s++)
+		{
+			float* ptrSums=&sums[((long int)q*nSubbands+s)*nBins];
+			int* ptrCounts=&counts[((long int)q*nSubbands+s)*nBins];
+			long int pos=((long int)s*info.noOfPol+polarIndex)*nBins;
+			for(int b=0;b<nBins;b++)
 			{
-				if(thisFlag)
-					*(ptrFlags+p)=1;
+				subintSums[pos+b]+=ptrSums[b];
+				subintCounts[pos+b]+=ptrCounts[b];
 			}
 		}
 	}
+}
+/*******************************************************************
+*FUNCTION: void SubintCube::writeHeader(const char* filename)
+*const char* filename	:File to write the cube to
+*******************************************************************/
+void SubintCube::writeHeader(const char* filename)
+{
+	fileName=filename;
+	FILE* cubeFile=fopen(filename,"wb");
+	char magic[8]="GPTCUBE";
+	int nPol=info.noOfPol;
+	double subintSec=subintSamples*info.samplingInterval;
+	double mjd=info.MJDObs+(info.startBlockIndex*info.blockSizeSec+maxDelay*info.samplingInterval)/86400.0;
+	double dm=info.dispersionMeasure;
+	fwrite(magic,sizeof(char),8,cubeFile);
+	fwrite(&nSubbands,sizeof(int),1,cubeFile);
+	fwrite(&nPol,sizeof(int),1,cubeFile);
+	fwrite(&nBins,sizeof(int),1,cubeFile);
+	fwrite(&subintSec,sizeof(double),1,cubeFile);
+	fwrite(&info.samplingInterval,sizeof(double),1,cubeFile);
+	fwrite(&mjd,sizeof(double),1,cubeFile);
+	fwrite(&info.periodInMs,sizeof(double),1,cubeFile);
+	fwrite(&dm,sizeof(double),1,cubeFile);
+	//Centre frequency of each subband from the centres of its channels.
+	int nChan=info.stopChannel-info.startChannel;
+	double channelWidth=info.bandwidth/info.noOfChannels;
+	double* frequency=new double[nSubbands];
+	int* nInSubband=new int[nSubbands];
+	for(int s=0;s<nSubbands;s++)
+	{
+		frequency[s]=0;
+		nInSubband[s]=0;
+	}
+	for(int j=0;j<nChan;j++)
+	{
+		int channel=j+info.startChannel;
+		if(info.sidebandFlag!=1)
+			channel=info.noOfChannels-channel-1;
+		frequency[channelSubband[j]]+=info.lowestFrequency+(channel+0.5)*channelWidth;
+		nInSubband[channelSubband[j]]++;
+	}
+	for(int s=0;s<nSubbands;s++)
+		frequency[s]/=nInSubband[s];
+	fwrite(frequency,sizeof(double),nSubbands,cubeFile);
+	delete[] frequency;
+	delete[] nInSubband;
+	fclose(cubeFile);
+}
+/*******************************************************************
+*FUNCTION: void SubintCube::writeComplete(long long int endSample,char flush)
+*long long int endSample	:Number of time samples merged so far
+*char flush			:1-> all subints are written (end of run)
+*A sample of a later block goes into dedispersed samples from 
+*endSample onwards, so subints that end before it are complete.
+*******************************************************************/
+void SubintCube::writeComplete(long long int endSample,char flush)
+{
+	long int subintSize=(long int)nSubbands*info.noOfPol*nBins;
+	FILE* cubeFile=fopen(fileName.c_str(),"ab");
+	float* weights=new float[nSubbands*info.noOfPol];
+	float* means=new float[subintSize];
+	while(!pendingSums.empty())
+	{
+		map<long int,double*>::iterator it=pendingSums.begin();
+		int subint=it->first;
+		if(!flush && maxDelay+(long long int)(subint+1)*subintSamples>endSample)
+			break;
+		double* subintSums=it->second;
+		double* subintCounts=pendingCounts[subint];
+		for(int sp=0;sp<nSubbands*info.noOfPol;sp++)
+		{
+			double total=0;
+			for(int b=0;b<nBins;b++)
+			{
+				long int pos=(long int)sp*nBins+b;
+				means[pos]=(subintCounts[pos]>0)?subintSums[pos]/subintCounts[pos]:0;
+				total+=subintCounts[pos];
+			}
+			weights[sp]=total;
+		}
+		fwrite(&subint,sizeof(int),1,cubeFile);
+		fwrite(weights,sizeof(float),nSubbands*info.noOfPol,cubeFile);
+		fwrite(means,sizeof(float),subintSize,cubeFile);
+		delete[] subintSums;
+		delete[] subintCounts;
+		pendingSums.erase(it);
+		pendingCounts.erase(subint);
+	}
+	delete[] weights;
+	delete[] means;
+	fclose(cubeFile);
+}
+
+//implementation of SubintCube methods ends
 
-}*/
-void RFIFiltering::multiPointFlagData(float* multiCutoff)
+/*******************************************************************
+*CLASS: CircularAccumulators
+*The circular dedispersion accumulators of a polarization, seen from 
+*one block. All blocks of a polarization are dedispersed into the same
+*accumulators at their start sample (modulo length), so what a block 
+*adds past its end waits in place for the blocks that follow. Rows 
+*are added by walkChannelRows() through addRow() and the completed 
+*samples of the block are taken out with drain().
+*Used by AdvancedAnalysis and PulsarPipeline, which own the arrays.
+*******************************************************************/
+class CircularAccumulators
 {
-	float* ptrInput;
-	char* ptrFlags;
-	ptrInput=input;
-	ptrFlags=flags;
-	for(int i=0;i< inputSize;i++,ptrFlags++)
-		*ptrFlags=0;
-	ptrFlags=flags;
-	for(int i=0;i< inputSize-1;i++,ptrInput++,ptrFlags++)
+	public:
+		long int	length;			//Length of the accumulators
+		float*		sum;			//Filtered sums
+		int*		sumCount;		//Number of samples in each filtered sum
+		float*		sumAll;			//Unfiltered sums
+		int*		sumAllCount;		//Number of samples in each unfiltered sum
+		const int*	delayTable;		//Delay of each channel (from startChannel)
+		long int	startPos;		//Position of the first sample of the block
+		
+		CircularAccumulators(long int length_,float* sum_,int* sumCount_,float* sumAll_,int* sumAllCount_,const int* delayTable_,long long int startSample);
+		void add(const float* row,const float* weight,int n,long int pos);	//Adds a shifted channel row
+		void addRow(int j,const float* row,const float* weight,int n,long int first);	//Adds a channel row of a tile at the delay of the channel (see walkChannelRows())
+		void drain(long int n,float* series,int* count,float* seriesUnfiltered,int* countUnfiltered);	//Moves the first n samples of the block out
+};
+
+//implementation of CircularAccumulators methods begins
+
+/*******************************************************************
+*CONSTRUCTOR: CircularAccumulators::CircularAccumulators(long int length_,float* sum_,int* sumCount_,float* sumAll_,int* sumAllCount_,const int* delayTable_,long long int startSample)
+*long int length_		:Length of the accumulators
+*const int* delayTable_		:Delay of each channel from startChannel
+*long long int startSample	:Number of time samples before the block
+*******************************************************************/
+CircularAccumulators::CircularAccumulators(long int length_,float* sum_,int* sumCount_,float* sumAll_,int* sumAllCount_,const int* delayTable_,long long int startSample)
+{
+	length=length_;
+	sum=sum_;
+	sumCount=sumCount_;
+	sumAll=sumAll_;
+	sumAllCount=sumAllCount_;
+	delayTable=delayTable_;
+	startPos=startSample%length;
+}
+/*******************************************************************
+*FUNCTION: void CircularAccumulators::add(const float* row,const float* weight,int n,long int pos)
+*const float* row	:n time samples of a channel
+*const float* weight	:weights of the samples in the filtered sums
+*			 (NULL -> the channel is flagged)
+*long int pos		:shifted position of the first sample from the 
+*			 start of the block, less than length
+*The row is split where it wraps around the end of the accumulators.
+*******************************************************************/
+void CircularAccumulators::add(const float* row,const float* weight,int n,long int pos)
+{
+	pos+=startPos;
+	if(pos>=length)
+		pos-=length;
+	int nFirst=(pos+n>length)?length-pos:n;
+	if(weight!=NULL)
 	{
-		if(fabs(*(ptrInput)-centralTendency)>multiCutoff[1]*rms && fabs(*(ptrInput+1)-centralTendency)>multiCutoff[1]*rms)
-			*(ptrFlags)=*(ptrFlags+1)=1;
+		shiftAddRow(row,weight,nFirst,&sum[pos],&sumCount[pos],&sumAll[pos],&sumAllCount[pos]);
+		shiftAddRow(row+nFirst,weight+nFirst,n-nFirst,sum,sumCount,sumAll,sumAllCount);
+	}
+	else
+	{
+		shiftAddFlaggedRow(row,nFirst,&sumAll[pos],&sumAllCount[pos]);
+		shiftAddFlaggedRow(row+nFirst,n-nFirst,sumAll,sumAllCount);
 	}
-
 }
-
 /*******************************************************************
-*FUNCTION: void RFIFiltering::writeFlags(const char* filename)
-*const char* filename: Name of file to which flags are written.
+*FUNCTION: void CircularAccumulators::addRow(int j,const float* row,const float* weight,int n,long int first)
+*Adds n samples of channel j from time sample first, shifted by the 
+*delay of the channel.
 *******************************************************************/
-void RFIFiltering::writeFlags(const char* filename)
+void CircularAccumulators::addRow(int j,const float* row,const float* weight,int n,long int first)
 {
-	FILE* flagFile;    
-    	flagFile = fopen(filename, "ab");
-        fwrite(flags, sizeof(char), inputSize, flagFile);    
-    	fclose(flagFile);    	
+	add(row,weight,n,first+delayTable[j]);
 }
-
 /*******************************************************************
-*FUNCTION: void RFIFiltering::writeFlags(const char* filename)
-*const char* filename: Name of file to which flags are written.
-*char* startFlags: Initial flags at the beginning 
-*int nStartFlags: number of flags (1s) to write before flags
-*char* endFlags: flags appeneded at the end
-*int nEndFlags: number of flags (1s) to write after flags
-*This is used to write channel flag file where some channels
-*at the start and the end have been marked bad by the user. 
+*FUNCTION: void CircularAccumulators::drain(long int n,float* series,int* count,float* seriesUnfiltered,int* countUnfiltered)
+*Copies the first n samples of the block out of the accumulators and
+*clears them for the blocks that follow. All earlier blocks must have
+*been added.
 *******************************************************************/
-void RFIFiltering::writeFlags(const char* filename,char* startFlags,int nStartFlags,char* endFlags,int nEndFlags)
+void CircularAccumulators::drain(long int n,float* series,int* count,float* seriesUnfiltered,int* countUnfiltered)
 {
-	FILE* flagFile;    
-    	flagFile = fopen(filename, "ab");
-	fwrite(startFlags, sizeof(char), nStartFlags, flagFile);    
-        fwrite(flags, sizeof(char), inputSize, flagFile);  
-	fwrite(endFlags, sizeof(char), nEndFlags, flagFile);     
-    	fclose(flagFile);    	
+	long int nFirst=(startPos+n>length)?length-startPos:n;
+	float* accumulators[2]={sum,sumAll};
+	float* seriesOut[2]={series,seriesUnfiltered};
+	int* accumulatorCounts[2]={sumCount,sumAllCount};
+	int* countsOut[2]={count,countUnfiltered};
+	for(int k=0;k<2;k++)
+	{
+		memcpy(seriesOut[k],&accumulators[k][startPos],nFirst*sizeof(float));
+		memcpy(&seriesOut[k][nFirst],accumulators[k],(n-nFirst)*sizeof(float));
+		memset(&accumulators[k][startPos],0,nFirst*sizeof(float));
+		memset(accumulators[k],0,(n-nFirst)*sizeof(float));
+		memcpy(countsOut[k],&accumulatorCounts[k][startPos],nFirst*sizeof(int));
+		memcpy(&countsOut[k][nFirst],accumulatorCounts[k],(n-nFirst)*sizeof(int));
+		memset(&accumulatorCounts[k][startPos],0,nFirst*sizeof(int));
+		memset(accumulatorCounts[k],0,(n-nFirst)*sizeof(int));
+	}
 }
 
-
-//implementation of RFIFiltering methods ends
-
+//implementation of CircularAccumulators methods ends
 
 /*******************************************************************
 CLASS: AdvancedAnalysis
@@ -3393,6 +7450,17 @@ class AdvancedAnalysis
 		static Information 	info;			//contains all input parameters
 		static int*		delayTable;		//An array that stores the delay of each frequency channel
 		static int 		maxDelay;		//The maximum delay encountered
+		static int		dedispersionTileLength;	//Number of time samples per channel major tile in calculateFullDM()
+		static long int		accumulatorLength;	//Length of the circular dedispersion accumulators
+		//The following arrays are circular accumulators, one for each polarization, that all blocks are dedispersed into (see calculateFullDM())
+		static float**		accumulatedFullDM;
+		static int**		accumulatedCount;
+		static float**		accumulatedFullDMUnfiltered;
+		static int**		accumulatedCountUnfiltered;
+		static long long int*	nextStartSample;	//Start sample of the next block to be created, one for each polarization
+		//In overlap-save mode the following circular histories, one for each polarization, are used instead of the accumulators (see calculateFullDMOverlapSave())
+		static float**		history;		//Selected channels of the recent time samples in channel major order
+		static char**		historyFlags;		//Flags of the samples in history (1-> flagged in time, channel or individually)
 		static double		initPhasePolyco;	//Initial phase for polyco folding
 		//The following three variables points to different arrays(variables), one for each polarization mode.
 		static float** 		foldedProfile;		//Pointers to arrays containing the folded profiles
@@ -3407,19 +7475,21 @@ class AdvancedAnalysis
 				
 		//Variables:
 		long int	blockIndex;		//Index of current block(window) being processed.
+		long long int	startSample;		//Number of time samples before this block, i.e its position in the accumulators
 		int		polarIndex;		//Index of polarization to process. Decides foldedProfile, countProfile & curPosMsStatic indexes.
 		double		curPosMs;		//Time upto which time series have been folded for the CURRENT polarization.
-		int		polycoRowIndex;		//Row index of polycoTable for polyco based folding
 		float*		rawData;		//2-D time frequency data to process
 		long int 	length;			//length of time series to process
 		float*		fullDM;			//Array that stores the dedispersed time series
 		int*		count;			//Number of data points in each bin of fullDM array
 		char*		dedispFlags;
-		float*		excess;			//The excess from the previous block (details given later)
-		int*		countExcess;		//Number of data points in each bin of excess array
 		float*		curFoldedProfile;	//Mean Folded profile of the current polarization, upto the current window (used for plotting)
 		char		hasEnoughDedispersedData; //Used to tell the folding routine when to start profile calculation.
 		int		foldingStartIndex;	  ///Used to comunicate the start index of first block for which dedispersed data is available across all channels.
+		char		isFlaggedBlock;		//1-> block is mostly flagged, it is not dedispersed or folded (fullDM holds only what earlier blocks added to its samples)
+		DMSearch*	dmSearch;		//Series of the trial DMs of the block (NULL if not searched)
+		SinglePulseSearch* singlePulseSearch;	//Single pulse candidates of the block (NULL if not searched)
+		SubintCube*	cube;			//Partial folded cube of the block (NULL if not folded)
 		//Maximum and minimum of the profile array and the fullDM array. Used for plotting.
 		float 		maxProfile;		
 		float 		minProfile;
@@ -3429,9 +7499,7 @@ class AdvancedAnalysis
 		//Following are the unfiltered counterpart of the above variables:
 
 		float*		fullDMUnfiltered;			//Array that stores the dedispersed time series
-		float*		excessUnfiltered;			//The excess from the previous block (details given later)
 		int*		countUnfiltered;			//Number of data points in each bin of fullDM array
-		int*		countExcessUnfiltered;		//Number of data points in each bin of excess array
 		float*		curFoldedProfileUnfiltered;	//Mean Folded profile of the current polarization, upto the current window (used for plotting)
 		float 		maxProfileUnfiltered;		
 		float 		minProfileUnfiltered;
@@ -3439,23 +7507,25 @@ class AdvancedAnalysis
 		float		minFullDMUnfiltered;
 
 		//Functions:
-		AdvancedAnalysis(Information info_);	//Constructor for first intialization
+		AdvancedAnalysis(Information info_,int nBlocks);	//Constructor for first intialization
 		AdvancedAnalysis(long int blockIndex_,int polarIndex_,float* rawData_,long int length_); //constructor
 		~AdvancedAnalysis();	//Destructor
-		void calculateDelayTable();	//Calculates the delay table, a table containing shifts (in number of samples) of each channel.
+		static int calculateDelayTable(Information& pulsarInfo,int* table);	//Calculates the delay table, a table containing shifts (in number of samples) of each channel.
 		void calculateFullDM(char* timeFlag,char *freqFlag); //Calculates the dedispersed time series
+		void calculateFullDM(char* timeFlag,char *freqFlag,char* sampleFlag); //Calculates the dedispersed time series excluding flagged individual samples
+		void calculateFullDM(char* timeFlag,char *freqFlag,char* sampleFlag,long int firstSample,long int nSamples); //Dedisperses a range of time samples of the block
 		void calculateFullDM(short int* filteredRawData); //Calculates the dedispersed time series for replaced by median DM.
-		void mergeExcess(float* excess_,int* countExcess_,float* excessUnfiltered_,int* countExcessUnfiltered_);
+		void calculateFullDM(short int* filteredRawData,long int firstSample,long int nSamples); //Dedisperses a range of time samples of the filtered raw data
+		CircularAccumulators accumulators();	//The accumulators of the polarization, seen from the block
+		void drainAccumulators();	//Moves the completed dedispersed series of the block out of the accumulators
+		void saveHistory(char* timeFlag,char* freqFlag,char* sampleFlag);	//Adds the block to the history (overlap-save mode)
+		void calculateFullDMOverlapSave();	//Calculates the complete dedispersed time series of the block from the history
 		void normalizeFullDM();
-		void calculateProfile();	//Calculates the folded profile
+		int* calculateFoldingBins();	//Calculates the profile bin of each folded sample, shared by all polarizations
+		void calculateProfile(int* bins);	//Calculates the folded profile
 		void writeProfile(const char* filename,const char* filenameUnfiltered);	//Writes out the folded profile
 		void writeFullDM(const char* filename,const char* filenameUnfiltered);		//Writes out the dedispersed time series		
 		void writeFullDMCount(const char*  filename);	//Writes out the number of samples in each dedispersed time series bin
-
-		private:
-		double calculateFixedPeriodPhase();		//Calculates phase of current sample for folding (based on a given fixed period)
-		double calculatePolycoPhase();			//Calculates phase of current sample for folding (based on a polyCo file)
-	
 	
 };
 
@@ -3470,19 +7540,68 @@ float** AdvancedAnalysis::foldedProfileUnfiltered;
 int** AdvancedAnalysis::countProfileUnfiltered;
 double* AdvancedAnalysis::curPosMsStatic;
 int AdvancedAnalysis::maxDelay;
+int AdvancedAnalysis::dedispersionTileLength;
+long int AdvancedAnalysis::accumulatorLength;
+float** AdvancedAnalysis::accumulatedFullDM;
+int** AdvancedAnalysis::accumulatedCount;
+float** AdvancedAnalysis::accumulatedFullDMUnfiltered;
+int** AdvancedAnalysis::accumulatedCountUnfiltered;
+long long int* AdvancedAnalysis::nextStartSample;
+float** AdvancedAnalysis::history;
+char** AdvancedAnalysis::historyFlags;
 double AdvancedAnalysis::initLagMs=0.0;
 double AdvancedAnalysis::initPhasePolyco=-1;
 /*******************************************************************
-*CONSTRUCTOR: AdvancedAnalysis::AdvancedAnalysis(Information _info)
+*CONSTRUCTOR: AdvancedAnalysis::AdvancedAnalysis(Information _info,int nBlocks)
 *Information _info: All input parameters are contained in this object
+*int nBlocks: Number of blocks that are dedispersed together
 *Computation of delay table and 
 *initialization of static variables is done in this constructor
 *******************************************************************/
-AdvancedAnalysis::AdvancedAnalysis(Information info_)
+AdvancedAnalysis::AdvancedAnalysis(Information info_,int nBlocks)
 {
 	info=info_;
 	delayTable=new int[info.noOfChannels];
-	calculateDelayTable();
+	maxDelay=calculateDelayTable(info,delayTable);
+	//A tile of the selected channels and their sample flags is sized to the L2 cache, at least 64 samples so that the rows are long enough to vectorize.
+	long int cacheSize=sysconf(_SC_LEVEL2_CACHE_SIZE);
+	if(cacheSize<=0)
+		cacheSize=256*1024;
+	dedispersionTileLength=cacheSize/((info.stopChannel-info.startChannel)*(sizeof(float)+1));
+	dedispersionTileLength=(dedispersionTileLength<64)?64:((dedispersionTileLength>1024)?1024:dedispersionTileLength);
+	dedispersionTileLength-=dedispersionTileLength%16;
+	/*The accumulators hold the blocks dedispersed together and the maxDelay samples they spill into the next blocks.
+	*The histories hold the blocks dedispersed together and the maxDelay samples before them.*/
+	accumulatorLength=nBlocks*info.blockSizeSamples+maxDelay;
+	accumulatedFullDM=new float*[info.noOfPol];
+	accumulatedCount=new int*[info.noOfPol];
+	accumulatedFullDMUnfiltered=new float*[info.noOfPol];
+	accumulatedCountUnfiltered=new int*[info.noOfPol];
+	history=new float*[info.noOfPol];
+	historyFlags=new char*[info.noOfPol];
+	nextStartSample=new long long int[info.noOfPol];
+	for(int k=0;k<info.noOfPol;k++)
+	{
+		nextStartSample[k]=0;
+		if(info.doOverlapSave)
+		{
+			history[k]=new float[accumulatorLength*(info.stopChannel-info.startChannel)];
+			historyFlags[k]=new char[accumulatorLength*(info.stopChannel-info.startChannel)];
+			accumulatedFullDM[k]=accumulatedFullDMUnfiltered[k]=NULL;
+			accumulatedCount[k]=accumulatedCountUnfiltered[k]=NULL;
+			continue;
+		}
+		history[k]=NULL;
+		historyFlags[k]=NULL;
+		accumulatedFullDM[k]=new float[accumulatorLength];
+		accumulatedCount[k]=new int[accumulatorLength];
+		accumulatedFullDMUnfiltered[k]=new float[accumulatorLength];
+		accumulatedCountUnfiltered[k]=new int[accumulatorLength];
+		memset(accumulatedFullDM[k],0,accumulatorLength*sizeof(float));
+		memset(accumulatedCount[k],0,accumulatorLength*sizeof(int));
+		memset(accumulatedFullDMUnfiltered[k],0,accumulatorLength*sizeof(float));
+		memset(accumulatedCountUnfiltered[k],0,accumulatorLength*sizeof(int));
+	}
 	foldedProfile=new float*[info.noOfPol];
 	countProfile=new int*[info.noOfPol];
 	curPosMsStatic=new double[info.noOfPol];
@@ -3507,19 +7626,19 @@ AdvancedAnalysis::AdvancedAnalysis(Information info_)
 			countProfileUnfiltered[k][i]=0;
 		}
 	}
-	excess=NULL;
-	countExcess=NULL;
 	fullDM=NULL;
 	count=NULL;
 	curFoldedProfile=NULL;
 
-	excessUnfiltered=NULL;
-	countExcessUnfiltered=NULL;
 	fullDMUnfiltered=NULL;
 	countUnfiltered=NULL;
 	curFoldedProfileUnfiltered=NULL;
 
 	dedispFlags=NULL;
+	isFlaggedBlock=0;
+	dmSearch=NULL;
+	singlePulseSearch=NULL;
+	cube=NULL;
 }
 /*******************************************************************
 *General comments about calculation of dedispersed time series:
@@ -3530,19 +7649,21 @@ AdvancedAnalysis::AdvancedAnalysis(Information info_)
 *
 *While doing so the shifted position of some channels of 
 *the time samples whose index is greater than length-maxDelay 
-*will cross the last index of the fullDM array. These are then stored in
-*the excess array and added with the dedispersed series of the
-*next block. 
+*will cross into the following blocks. Hence all blocks of a 
+*polarization are added into circular accumulators at their start 
+*sample (modulo accumulatorLength). Once the earlier blocks have been
+*added a block takes its completed part out with drainAccumulators(),
+*what spills over stays in place for the next blocks.
 *******************************************************************/
 
 /*******************************************************************
-*CONSTRUCTOR: AdvancedAnalysis:AdvancedAnalysis(long int blockIndex_,int polarIndex_,unsigned short int* rawData_,long int length_,float* excess_,int* countExcess_)
+*CONSTRUCTOR: AdvancedAnalysis:AdvancedAnalysis(long int blockIndex_,int polarIndex_,float* rawData_,long int length_)
 *long int blockIndex_		:Index of current block(window) to process
 *int polarIndex_		:Index of current polarization to process
 *float* rawData_		:2-D raw data.
 *long int length_		:length of time sample to dedisperse
-*float* excess_			:excess from the previous block
-*int* countExcess_		:number of data points in each bin of excess_ array
+*Blocks of a polarization must be created in block order, this fixes
+*their start samples.
 *******************************************************************/
 AdvancedAnalysis::AdvancedAnalysis(long int blockIndex_,int polarIndex_,float* rawData_,long int length_)
 {
@@ -3550,51 +7671,32 @@ AdvancedAnalysis::AdvancedAnalysis(long int blockIndex_,int polarIndex_,float* r
 	rawData=rawData_;
 	blockIndex=blockIndex_;
 	polarIndex=polarIndex_;	
-	fullDM=new float[length+maxDelay];
-	excess=new float[maxDelay];
-	count=new int[length+maxDelay];
-	countExcess=new int[maxDelay];
+	startSample=nextStartSample[polarIndex];
+	nextStartSample[polarIndex]+=length;
+	fullDM=new float[length];
+	count=new int[length];
 	curFoldedProfile=new float[info.periodInSamples];
 	dedispFlags=new char[length];
 
-	fullDMUnfiltered=new float[length+maxDelay];
-	excessUnfiltered=new float[maxDelay];
-	countUnfiltered=new int[length+maxDelay];
-	countExcessUnfiltered=new int[maxDelay];
+	fullDMUnfiltered=new float[length];
+	countUnfiltered=new int[length];
 	curFoldedProfileUnfiltered=new float[info.periodInSamples];
 	hasEnoughDedispersedData=1;
 	foldingStartIndex=0;
+	isFlaggedBlock=0;
+	dmSearch=NULL;
+	singlePulseSearch=NULL;
+	cube=NULL;
 
-	float* ptrFullDM=fullDM;
-	float* ptrExcess=excess;
-	int* ptrCount=count;
-	int* ptrCountExcess=countExcess;
-	char* ptrDedispFlags=dedispFlags;
+	memset(fullDM,0,length*sizeof(float));
+	memset(count,0,length*sizeof(int));
+	memset(fullDMUnfiltered,0,length*sizeof(float));
+	memset(countUnfiltered,0,length*sizeof(int));
 
-	float* ptrFullDMUnfiltered=fullDMUnfiltered;
-	float* ptrExcessUnfiltered=excessUnfiltered;
-	int* ptrCountUnfiltered=countUnfiltered;
-	int* ptrCountExcessUnfiltered=countExcessUnfiltered;
-	
-	//intializing fullDM and count
-	for(int i=0;i<length+maxDelay;i++,ptrFullDM++,ptrCount++,ptrFullDMUnfiltered++,ptrCountUnfiltered++)
-		*ptrFullDM=*ptrCount=*ptrFullDMUnfiltered=*ptrCountUnfiltered=0;
-	
+	char* ptrDedispFlags=dedispFlags;
 	//intializing dedispersion flag
 	for(int i=0;i<length;i++,ptrDedispFlags++)
 		*ptrDedispFlags=0;
-	
-	//excess_==NULL implies that this is the first block to get dedispersed	
-
-	
-	//copying of excess of last block to fullDM of this block
-	/*
-	memcpy(fullDM,excess_,maxDelay*sizeof(float));
-	memcpy(count,countExcess_,maxDelay*sizeof(int));
-
-	memcpy(fullDMUnfiltered,excessUnfiltered_,maxDelay*sizeof(float));
-	memcpy(countUnfiltered,countExcessUnfiltered_,maxDelay*sizeof(int));
-	*/
 }
 /*******************************************************************
 *DESTRUCTOR: AdvancedAnalysis::~AdvancedAnalysis()
@@ -3605,61 +7707,67 @@ AdvancedAnalysis::~AdvancedAnalysis()
 	delete[] curFoldedProfile;	
 	delete[] fullDM;
 	delete[] count;
-	delete[] excess;
-	delete[] countExcess;
 	delete[] curFoldedProfileUnfiltered;	
 	delete[] fullDMUnfiltered;
 	delete[] countUnfiltered;
-	delete[] excessUnfiltered;
-	delete[] countExcessUnfiltered;
 	delete[] dedispFlags;
-	
+	if(dmSearch!=NULL)
+		delete dmSearch;
+	if(singlePulseSearch!=NULL)
+		delete singlePulseSearch;
+	if(cube!=NULL)
+		delete cube;
 
 }
 /*******************************************************************
-*FUNCTION: void AdvancedAnalysis::calculateDelayTable()
+*FUNCTION: int AdvancedAnalysis::calculateDelayTable(Information& pulsarInfo,int* table)
+*Information& pulsarInfo	:parameters of the pulsar (DM) and the band
+*int* table			:output, noOfChannels elements
+*returns the maximum delay.
 *Calculates the amount of shift of each channel with respect to the
 *lowest frequency. This shift corrects for the smearing of pulse
 *that occurs when the signal travels through interstellar plasma.
-*Note that this function is called only once and the table calculated
-*is stored in a static array delayTable.
+*Note that this function is called only once for each pulsar, the 
+*table of the main pulsar is stored in the static array delayTable.
 *******************************************************************/
-void AdvancedAnalysis::calculateDelayTable()
+int AdvancedAnalysis::calculateDelayTable(Information& pulsarInfo,int* table)
 {
 	int j;	
-	float lowestFrequency=info.lowestFrequency;
-	float KDM=4.148808*pow(10,3)*info.dispersionMeasure;
-	float freqInterval=(info.bandwidth)/(float)(info.noOfChannels);
+	int maxShift;
+	float lowestFrequency=pulsarInfo.lowestFrequency;
+	float KDM=4.148808*pow(10,3)*pulsarInfo.dispersionMeasure;
+	float freqInterval=(pulsarInfo.bandwidth)/(float)(pulsarInfo.noOfChannels);
 	lowestFrequency+=freqInterval/2.0;	
 	
-	for(int i=0;i<info.noOfChannels;i++)
+	for(int i=0;i<pulsarInfo.noOfChannels;i++)
 	{
-		if(info.sidebandFlag==1)	//if sidebandFlag is one(zero) then the first(last) channel is of the lowest frequency 
+		if(pulsarInfo.sidebandFlag==1)	//if sidebandFlag is one(zero) then the first(last) channel is of the lowest frequency 
 			j=i;
 		else
-			j=info.noOfChannels-i-1;
-		if(info.refFrequency==0)
-			delayTable[i]=(int)(((1.0/pow(lowestFrequency,2))-(1.0/pow(lowestFrequency+j*freqInterval,2)))*KDM/info.samplingInterval+0.5);
+			j=pulsarInfo.noOfChannels-i-1;
+		if(pulsarInfo.refFrequency==0)
+			table[i]=(int)(((1.0/pow(lowestFrequency,2))-(1.0/pow(lowestFrequency+j*freqInterval,2)))*KDM/pulsarInfo.samplingInterval+0.5);
 		else
-			delayTable[i]=(int)((-(1.0/pow(lowestFrequency+j*freqInterval,2))+(1.0/pow(lowestFrequency+info.bandwidth,2)))*KDM/info.samplingInterval+0.5);
+			table[i]=(int)((-(1.0/pow(lowestFrequency+j*freqInterval,2))+(1.0/pow(lowestFrequency+pulsarInfo.bandwidth,2)))*KDM/pulsarInfo.samplingInterval+0.5);
 			
 	}
-	if(info.refFrequency==0)
+	if(pulsarInfo.refFrequency==0)
 	{
-		if(info.sidebandFlag==1)
-			maxDelay=delayTable[info.noOfChannels-1];
+		if(pulsarInfo.sidebandFlag==1)
+			maxShift=table[pulsarInfo.noOfChannels-1];
 		else
-			maxDelay=delayTable[0];	
+			maxShift=table[0];	
 	}
 	else
 	{
-		if(info.sidebandFlag==0)
-			maxDelay=-delayTable[info.noOfChannels-1];
+		if(pulsarInfo.sidebandFlag==0)
+			maxShift=-table[pulsarInfo.noOfChannels-1];
 		else
-			maxDelay=-delayTable[0];
-		for(int i=0;i<info.noOfChannels;i++)
-			delayTable[i]+=maxDelay;
+			maxShift=-table[0];
+		for(int i=0;i<pulsarInfo.noOfChannels;i++)
+			table[i]+=maxShift;
 	}	
+	return maxShift;
 }
 /*******************************************************************
 *FUNCTION: AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags)
@@ -3671,52 +7779,50 @@ void AdvancedAnalysis::calculateDelayTable()
 *******************************************************************/
 void AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags)
 {
-	
-	float* ptrRawData=rawData;
-	char* ptrTimeFlags=timeFlags;
-	char* ptrFreqFlags;
-	long int pos;
-
-	int startChannel=info.startChannel;
-	int stopChannel=info.stopChannel;
-	int totalChan=info.noOfChannels;
-	int endExclude=info.noOfChannels-stopChannel;
-
-	for(long int i=0;i<length;i++,ptrTimeFlags++)
-	{
-		ptrRawData+=startChannel;
-		ptrFreqFlags=freqFlags;	
-			for(int j=startChannel;j<stopChannel;j++,ptrRawData++,ptrFreqFlags++)
-			{
-
-				pos=i+delayTable[j];	//shift to correct for dispersion.
-				if(!(*ptrFreqFlags)&!(*ptrTimeFlags))
-				{
-					fullDM[pos]+=(*ptrRawData);
-					count[pos]++;
-				}
-				else
-				{
-					fullDMUnfiltered[pos]+=(*ptrRawData);
-					countUnfiltered[pos]++;
-				}
-			}
-		
-		ptrRawData+=endExclude;
-	}
-	float* ptrFullDM=fullDM;
-	float* ptrFullDMUnfiltered=fullDMUnfiltered;
-	int* ptrCount=count;
-	int* ptrCountUnfiltered=countUnfiltered;
-	
-
-	for(int i=0;i<length+maxDelay;i++,ptrFullDM++,ptrFullDMUnfiltered++,ptrCount++,ptrCountUnfiltered++)
-	{
-
-		(*ptrFullDMUnfiltered)+=(*ptrFullDM);
-		(*ptrCountUnfiltered)+=(*ptrCount);		
-	}        
-
+	calculateFullDM(timeFlags,freqFlags,NULL);
+}
+/*******************************************************************
+*FUNCTION: AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags,char* sampleFlags)
+*char* sampleFlags	:Samples of the 2-D data marked 1 are ignored
+*			 (NULL if individual samples are not flagged).
+*As calculateFullDM(timeFlags,freqFlags) with individual time-frequency
+*samples flagged as well (see BasicAnalysis::flagSumThreshold()).
+*
+*The block is dedispersed channel by channel on tiles of 
+*dedispersionTileLength time samples. Each tile is transposed to 
+*channel major order, then every channel row is shifted by its delay 
+*and added to the contiguous range of the accumulators it falls on, so
+*the adds vectorize instead of scattering single samples. Flagged time
+*samples (and individual samples) get weight 0 in the filtered sum, 
+*flagged channels and tiles in which all time samples are flagged are
+*only added to the unfiltered series. The unfiltered series is 
+*accumulated directly over all samples.
+*******************************************************************/
+void AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags,char* sampleFlags)
+{
+	calculateFullDM(timeFlags,freqFlags,sampleFlags,0,length);
+}
+/*******************************************************************
+*FUNCTION: AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags,char* sampleFlags,long int firstSample,long int nSamples)
+*long int firstSample	:first time sample of the range
+*long int nSamples	:number of time samples in the range
+*Dedisperses a range of time samples of the block into the 
+*accumulators. The ranges of a block may be added in any order, 
+*tiled execution adds each tile right after it is filtered.
+*******************************************************************/
+void AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags,char* sampleFlags,long int firstSample,long int nSamples)
+{
+	CircularAccumulators target=accumulators();
+	walkChannelRows(info,rawData,timeFlags,freqFlags,sampleFlags,firstSample,nSamples,dedispersionTileLength,1,target);
+}
+/*******************************************************************
+*FUNCTION: CircularAccumulators AdvancedAnalysis::accumulators()
+*returns the accumulators of the polarization with the block at its
+*start sample.
+*******************************************************************/
+CircularAccumulators AdvancedAnalysis::accumulators()
+{
+	return CircularAccumulators(accumulatorLength,accumulatedFullDM[polarIndex],accumulatedCount[polarIndex],accumulatedFullDMUnfiltered[polarIndex],accumulatedCountUnfiltered[polarIndex],delayTable+info.startChannel,startSample);
 }
 /*******************************************************************
 *FUNCTION: AdvancedAnalysis::calculateFullDM(unsigned short int* filteredRawData)
@@ -3725,209 +7831,217 @@ void AdvancedAnalysis::calculateFullDM(char* timeFlags,char* freqFlags)
 *******************************************************************/
 void AdvancedAnalysis::calculateFullDM(short int* filteredRawData)
 {
-	
-
-	
+	calculateFullDM(filteredRawData,0,length);
+}
+/*******************************************************************
+*FUNCTION: AdvancedAnalysis::calculateFullDM(short int* filteredRawData,long int firstSample,long int nSamples)
+*As calculateFullDM(filteredRawData) for a range of time samples of 
+*the block.
+*******************************************************************/
+void AdvancedAnalysis::calculateFullDM(short int* filteredRawData,long int firstSample,long int nSamples)
+{
 	long int pos;
 
 	int startChannel=info.startChannel;
 	int stopChannel=info.stopChannel;
 	int totalChan=info.noOfChannels;
 	int endExclude=info.noOfChannels-stopChannel;
-	float* ptrRawData=rawData;
-	short int* ptrFilteredRawData=filteredRawData;
-	for(long int i=0;i<length;i++)
+	long int startPos=startSample%accumulatorLength;
+	float* sum=accumulatedFullDM[polarIndex];
+	int* sumCount=accumulatedCount[polarIndex];
+	float* sumAll=accumulatedFullDMUnfiltered[polarIndex];
+	int* sumAllCount=accumulatedCountUnfiltered[polarIndex];
+	float* ptrRawData=rawData+firstSample*totalChan;
+	short int* ptrFilteredRawData=filteredRawData+firstSample*totalChan;
+	for(long int i=firstSample;i<firstSample+nSamples;i++)
 	{
 			ptrFilteredRawData+=startChannel;	
 			ptrRawData+=startChannel;	
 			for(int j=startChannel;j<stopChannel;j++,ptrRawData++,ptrFilteredRawData++)
 			{
 
-				pos=i+delayTable[j];	//shift to correct for dispersion.
+				pos=startPos+i+delayTable[j];	//shift to correct for dispersion.
+				if(pos>=accumulatorLength)
+					pos-=accumulatorLength;
 				
-				fullDM[pos]+=(*ptrFilteredRawData);
-				count[pos]++;
+				sum[pos]+=(*ptrFilteredRawData);
+				sumCount[pos]++;
 				
 				
-				fullDMUnfiltered[pos]+=(*ptrRawData)*info.meanval;
-				countUnfiltered[pos]++;
+				sumAll[pos]+=(*ptrRawData)*info.meanval;
+				sumAllCount[pos]++;
 			}
 			ptrRawData+=endExclude;
 			ptrFilteredRawData+=endExclude;
 			
 	}
 }
-void AdvancedAnalysis::mergeExcess(float* excess_,int* countExcess_,float* excessUnfiltered_,int* countExcessUnfiltered_)
+/*******************************************************************
+*FUNCTION: void AdvancedAnalysis::saveHistory(char* timeFlags,char* freqFlags,char* sampleFlags)
+*char* sampleFlags	:Samples of the 2-D data marked 1 are flagged
+*			 (NULL if individual samples are not flagged).
+*Overlap-save mode: the selected channels of the block are transposed
+*into the history of the polarization at its start sample (modulo 
+*accumulatorLength), with the time, channel and sample flags combined
+*into historyFlags. Tiles are cut where the history wraps around.
+*******************************************************************/
+void AdvancedAnalysis::saveHistory(char* timeFlags,char* freqFlags,char* sampleFlags)
+{
+	int startChannel=info.startChannel;
+	int totalChan=info.noOfChannels;
+	int nChan=info.stopChannel-startChannel;
+	float* rows=history[polarIndex];
+	char* flags=historyFlags[polarIndex];
+	long int pos=startSample%accumulatorLength;
+	for(long int first=0;first<length;)
+	{
+		int n=dedispersionTileLength;
+		if(length-first<n)
+			n=length-first;
+		if(accumulatorLength-pos<n)
+			n=accumulatorLength-pos;
+		transposeTile(rawData+first*totalChan+startChannel,totalChan,n,nChan,&rows[pos],accumulatorLength);
+		if(sampleFlags!=NULL)
+			transposeTile(sampleFlags+first*totalChan+startChannel,totalChan,n,nChan,&flags[pos],accumulatorLength);
+		for(int j=0;j<nChan;j++)
+			combineFlags(&timeFlags[first],freqFlags[j],sampleFlags!=NULL,n,&flags[j*accumulatorLength+pos]);
+		first+=n;
+		pos+=n;
+		if(pos==accumulatorLength)
+			pos=0;
+	}
+}
+/*******************************************************************
+*FUNCTION: void AdvancedAnalysis::calculateFullDMOverlapSave()
+*Overlap-save mode: calculates the complete dedispersed time series of
+*the block. Sample i of a channel with delay d is the history sample 
+*startSample+i-d, so each channel adds a contiguous range of its 
+*history row (the last d samples of it from the blocks before) to 
+*fullDM. No other block adds to fullDM, so the blocks of a batch can
+*be dedispersed in any order once all of them are in the history.
+*Samples from before the start of observation are left out.
+*******************************************************************/
+void AdvancedAnalysis::calculateFullDMOverlapSave()
 {
-	float* ptrFullDM=fullDM;
-	float* ptrFullDMUnfiltered=fullDMUnfiltered;
-	int* ptrCount=count;
-	int* ptrCountUnfiltered=countUnfiltered;
-	float* ptrExcess=excess_;
-	float* ptrExcessUnfiltered=excessUnfiltered_;
-	int* ptrCountExcess=countExcess_;
-	int* ptrCountExcessUnfiltered=countExcessUnfiltered_;
-	if(excess_)
-	{
-		for(int i=0;i<maxDelay;i++,ptrFullDM++,ptrFullDMUnfiltered++,ptrExcess++,ptrExcessUnfiltered++,ptrCount++,ptrCountUnfiltered++,ptrCountExcess++,ptrCountExcessUnfiltered++)
+	int nChan=info.stopChannel-info.startChannel;
+	int *ptrDelay=delayTable+info.startChannel;
+	for(int j=0;j<nChan;j++)
+	{
+		float* row=&history[polarIndex][j*accumulatorLength];
+		char* flags=&historyFlags[polarIndex][j*accumulatorLength];
+		long int i=(startSample<ptrDelay[j])?ptrDelay[j]-startSample:0;
+		while(i<length)
 		{
-			(*ptrFullDM)+=(*ptrExcess);
-			(*ptrFullDMUnfiltered)+=(*ptrExcessUnfiltered);
-			(*ptrCount)+=(*ptrCountExcess);
-			(*ptrCountUnfiltered)+=(*ptrCountExcessUnfiltered);		
+			long int pos=(startSample+i-ptrDelay[j])%accumulatorLength;
+			long int n=(length-i<accumulatorLength-pos)?length-i:accumulatorLength-pos;
+			shiftAddMaskedRow(&row[pos],&flags[pos],n,&fullDM[i],&count[i],&fullDMUnfiltered[i],&countUnfiltered[i]);
+			i+=n;
 		}
 	}
-	memcpy(excess,&fullDM[length],maxDelay*sizeof(float));
-	memcpy(excessUnfiltered,&fullDMUnfiltered[length],maxDelay*sizeof(float));
-	memcpy(countExcess,&count[length],maxDelay*sizeof(int));	
-	memcpy(countExcessUnfiltered,&countUnfiltered[length],maxDelay*sizeof(int));
+}
+/*******************************************************************
+*FUNCTION: void AdvancedAnalysis::drainAccumulators()
+*Copies the dedispersed series of the block out of the accumulators 
+*and clears them for the blocks that follow. All earlier blocks of 
+*the polarization must have been added to the accumulators.
+*******************************************************************/
+void AdvancedAnalysis::drainAccumulators()
+{
+	accumulators().drain(length,fullDM,count,fullDMUnfiltered,countUnfiltered);
 }
 void AdvancedAnalysis::normalizeFullDM()
 {
 	float* ptrFullDM;
 	float* ptrFullDMUnfiltered;
 	int* ptrCount;
-	int* ptrCountUnfiltered;
 	int nChan= info.stopChannel-info.startChannel;
 	double samplingIntervalMs=info.samplingInterval*1000.0;
-		/*******************************************************************
-		*The following is the logic for folding to start. Folding is started
-		*only when the pulse ariving on all channels is guaranteed, i.e
-		*when maxDelay number of samples have elapsed. If the window-length
-		*is less than maxDelay then maxDelay/length number of windows must
-		*be skipped.
-		*******************************************************************/
-		if(length<maxDelay && ((blockIndex+1)*length<maxDelay))
-		{	
-			hasEnoughDedispersedData=0;	
-			initLagMs+=length*samplingIntervalMs;		
-		}
-		/*******************************************************************
-		*The if clause determines if this is the first block for which
-		*folding will be performed. In case window(block) length is greater
-		*than maxDelay then it suffices to check if blockIndex==0.
-		*if length is lesser than maxDelay then the logic checks if it is
-		*the first block to process.
-		*******************************************************************/
-		else if(blockIndex==0 || (length<maxDelay && int((blockIndex+1)*length/maxDelay)==1 && (blockIndex+1)*length%maxDelay<length))
-		{		
-			/*******************************************************************
-			*maxDelay%length number of samples in the first block to process is
-			*skipped to ensure that atleast maxDelay number of time samples have
-			*been recorded since the start of observation.
-							*******************************************************************/			
-			foldingStartIndex=maxDelay%length;	
-			initLagMs+=samplingIntervalMs*foldingStartIndex;
-		}
+	/*******************************************************************
+	*Folding is started only when the pulse arriving on all channels is
+	*guaranteed, i.e when maxDelay number of samples have elapsed since
+	*the start of observation. Blocks that end before that are not 
+	*folded, in the block that crosses it folding starts at sample 
+	*maxDelay.
+	*******************************************************************/
+	if(startSample+length<=maxDelay)
+	{	
+		hasEnoughDedispersedData=0;	
+		#pragma omp atomic
+		initLagMs+=length*samplingIntervalMs;		
+	}
+	else if(startSample<maxDelay)
+	{		
+		foldingStartIndex=maxDelay-startSample;	
+		#pragma omp atomic
+		initLagMs+=samplingIntervalMs*foldingStartIndex;
+	}
 	
 	/*******************************************************************
 	*The dedispersed time series is averaged over the number of samples 
-	*added in each bin. Minimum and maximum of the series is found.
-	*These are used while plotting the series.
+	*added in each bin (see normalizeDedispersedSeries()). Minimum and 
+	*maximum of the series is found. These are used while plotting the 
+	*series.
 	*******************************************************************/
+	normalizeDedispersedSeries(fullDM,count,fullDMUnfiltered,countUnfiltered,length,nChan,dedispFlags);
 	ptrFullDM=fullDM;
 	ptrFullDMUnfiltered=fullDMUnfiltered;
 	ptrCount=count;
-	ptrCountUnfiltered=countUnfiltered;
 	minFullDM=minFullDMUnfiltered=33554434;
 	maxFullDM=maxFullDMUnfiltered=0;
 	char* ptrDedispFlags=dedispFlags;
 	
-	for(long int i=0;i<length;i++,ptrFullDM++,ptrCount++,ptrDedispFlags++,ptrFullDMUnfiltered++,ptrCountUnfiltered++)
+	for(long int i=0;i<length;i++,ptrFullDM++,ptrCount++,ptrDedispFlags++,ptrFullDMUnfiltered++)
 	{	
-
-
 		if(*ptrCount==0)
-		{
-			*ptrDedispFlags=1;
-			*ptrFullDM=0;
 			continue;
-		}
-		else
-		{
-			(*ptrFullDM)/=(*ptrCount);		
-			if((*ptrCount)<=0.4*nChan)
-				*ptrDedispFlags=1;
-			else
-			{
-							
-				if(*ptrFullDM>maxFullDM)
-					maxFullDM=*ptrFullDM;
-				if(*ptrFullDM<minFullDM)
-					minFullDM=*ptrFullDM;
-			}
-		}
-
-		if(*ptrCountUnfiltered==0)
+		if(!(*ptrDedispFlags))
 		{
-			*ptrFullDMUnfiltered=0;
+			if(*ptrFullDM>maxFullDM)
+				maxFullDM=*ptrFullDM;
+			if(*ptrFullDM<minFullDM)
+				minFullDM=*ptrFullDM;
 		}
-		else
-		{
-			(*ptrFullDMUnfiltered)/=(*ptrCountUnfiltered);
-			if(*ptrFullDMUnfiltered>maxFullDMUnfiltered)
-				maxFullDMUnfiltered=*ptrFullDMUnfiltered;
-			if(*ptrFullDMUnfiltered<minFullDMUnfiltered)
-				minFullDMUnfiltered=*ptrFullDMUnfiltered;
-		}
-
-		
-		
+		if(*ptrFullDMUnfiltered>maxFullDMUnfiltered)
+			maxFullDMUnfiltered=*ptrFullDMUnfiltered;
+		if(*ptrFullDMUnfiltered<minFullDMUnfiltered)
+			minFullDMUnfiltered=*ptrFullDMUnfiltered;
 	}
 	
 }
 /*******************************************************************
-*FUNCTION: double AdvancedAnalysis::calculatePolycoPhase()
-*returns double phase: folding phase for current time sample
-*between 0 and 1.
-*computes the phase of the current time sample using a polyco table.
-*******************************************************************/
-double AdvancedAnalysis::calculatePolycoPhase()
-{
-	
-	//Check the time of the current sample wrt polyco start time (dt)	
-	double dt = (initLagMs+curPosMs)/60000.0+ (double)((info.MJDObs - info.polycoTable[polycoRowIndex*(3+info.nCoeffPolyco)+0]) * 1440);
-	//Logic to check if the time difference has crossed the span of current set.
-	
-	while(dt > info.spanPolyco/2.0)
-  	{
-    		dt -= info.spanPolyco;
-    		polycoRowIndex += 1;
-  	}
-  	//Find the folding phase for the current time
-  	double* polycoSet=&(info.polycoTable[polycoRowIndex*(3+info.nCoeffPolyco)]);
-  	double phase = (polycoSet[1] + (dt*60*polycoSet[2])); 	//Ref phase + 0th order frequency
-  	for(int i=0;i<info.nCoeffPolyco;i++)  	
-    		phase += polycoSet[3+i] * pow(dt,i);
-  	
-  	
-  	double F_Temp;
-
-	//The following statement ensures that the first sample of the time series 
-	//goes to the first profile bin.
-  	if(initPhasePolyco == -1)  	
-  		initPhasePolyco = modf( (modf(phase , &F_Temp)+ 1.0) , &F_Temp);
-	//Calculates the fractional phase w.r.t the intial phase
-  	phase -= initPhasePolyco;
-  	double frac_phase = modf((modf(phase , &F_Temp)+ 1.0) , &F_Temp) ;  	
-  	return frac_phase;
-}
-/*******************************************************************
-*FUNCTION: double AdvancedAnalysis::calculateFixedPeriodPhase()
-*returns double phase: folding phase for current time sample
-*between 0 and 1.
+*FUNCTION: int* AdvancedAnalysis::calculateFoldingBins()
+*returns int* bins: profile bin of each sample of the block from 
+*foldingStartIndex onwards (NULL if there are none). The caller frees
+*it.
+*The bins depend only on the time of the samples, so they are found
+*once for a block and used for all polarizations. The samples of a
+*block are at (startSample+i-maxDelay) sampling intervals after the 
+*first folded sample.
 *******************************************************************/
-double AdvancedAnalysis::calculateFixedPeriodPhase()
+int* AdvancedAnalysis::calculateFoldingBins()
 {
-	double periodInMs=info.periodInMs;
-	int noOfPeriods=(int)floor(curPosMs/periodInMs);
-	return (curPosMs/periodInMs)-noOfPeriods;
+	if(hasEnoughDedispersedData==0)
+		return NULL;
+	double samplingIntervalMs=info.samplingInterval*1000.0;
+	//The polyco phase of the first folded sample goes to the first profile bin.
+	if(!info.doFixedPeriodFolding && initPhasePolyco==-1)
+	{
+		long double phase;
+		double slope,curvature;
+		info.expandPolyco(initLagMs,phase,slope,curvature);
+		initPhasePolyco=(double)(phase-floorl(phase));
+	}
+	long int n=length-foldingStartIndex;
+	int* bins=new int[n];
+	foldingBins(info,initLagMs,(startSample+foldingStartIndex-maxDelay)*samplingIntervalMs,initPhasePolyco,n,bins);
+	return bins;
 }
 /*******************************************************************
-*FUNCTION: void AdvancedAnalysis::calculateProfile()
+*FUNCTION: void AdvancedAnalysis::calculateProfile(int* bins)
+*int* bins	:Profile bins from calculateFoldingBins()
 *Folds the dedispersed time series to get the pulsar profile.
 *******************************************************************/
-void AdvancedAnalysis::calculateProfile()
+void AdvancedAnalysis::calculateProfile(int* bins)
 {
 	//if hasEnoughDedispersedData=0 then folding must not begin, see comments in calculateFullDM() function.
 	if(hasEnoughDedispersedData==0)
@@ -3935,11 +8049,6 @@ void AdvancedAnalysis::calculateProfile()
 	int periodInSamples=info.periodInSamples;
 	double offset=info.profileOffset;
 	double samplingIntervalMs=info.samplingInterval*1000.0;
-	double phase;
-	char* ptrDedispFlags=&dedispFlags[foldingStartIndex];	
-	float* ptrFullDM=&fullDM[foldingStartIndex];
-	float* ptrFullDMUnfiltered=&fullDMUnfiltered[foldingStartIndex];
-	int noOfPeriods,index;
 	//finds the appropiate static variables for given polarization (polarIndex)
 	
 	float* thisFoldedProfile,*thisFoldedProfileUnfiltered;
@@ -3955,33 +8064,10 @@ void AdvancedAnalysis::calculateProfile()
 	thisCountProfileUnfiltered=countProfileUnfiltered[polarIndex];
 
 
-	if(!info.doFixedPeriodFolding)
-		polycoRowIndex= info.polycoRowIndex; 	
-
-	for(long int i=foldingStartIndex;i<length;i++,ptrFullDM++,ptrFullDMUnfiltered++,ptrDedispFlags++,curPosMs+=samplingIntervalMs)
-	{	
-		
-		if(info.doFixedPeriodFolding)	
-			phase=calculateFixedPeriodPhase()+offset;
-		else
-			phase=calculatePolycoPhase()+offset;
-		if(*ptrDedispFlags)
-			continue;
-		if(phase>=1)
-			phase=phase-1;	
-		//logic to convert phase to sample index with given offset.
-		index=(int)(phase*periodInSamples+0.5);	
-		if(index==periodInSamples)
-			index=0;
-		thisFoldedProfile[index]+=(*ptrFullDM);
-		thisFoldedProfileUnfiltered[index]+=(*ptrFullDMUnfiltered);
-		thisCountProfileUnfiltered[index]++;
-		thisCountProfile[index]++;
-		
-		
-		
-	}
-
+	//A flagged block is not folded, the folding time is only moved past it.
+	if(!isFlaggedBlock)
+		foldDedispersedSeries(&fullDM[foldingStartIndex],&fullDMUnfiltered[foldingStartIndex],&dedispFlags[foldingStartIndex],bins,length-foldingStartIndex,thisFoldedProfile,thisCountProfile,thisFoldedProfileUnfiltered,thisCountProfileUnfiltered);
+	curPosMs+=(length-foldingStartIndex)*samplingIntervalMs;
 	curPosMsStatic[polarIndex]=curPosMs;
 	//Calculates the folded profile generate till the current block. This is used to plot.
 	minProfile=maxProfile=thisFoldedProfile[(int)(offset*periodInSamples)+1]/thisCountProfile[(int)(offset*periodInSamples)+1]; //The slightly non-intuitive index is given here to ensure that countprofile is not zero, which can be the case if the first element was used to initialize the minimum. Such a situation can arise in the intial blocks with a non-zero phase offset.
@@ -4075,6 +8161,262 @@ void AdvancedAnalysis::writeProfile(const char*  filename,const char* filenameUn
 
 //implementation of AdvancedAnalysis methods ends
 
+/*******************************************************************
+*CLASS: PulsarPipeline
+*Dedisperses and folds the filtered data for one of the additional 
+*pulsars of the -pulsars list. Reading, float conversion, bandshape 
+*and RFI filtering are done once per block for all pulsars, so each 
+*additional pulsar only costs its own dedispersion and folding. Each
+*pulsar has its own delay table, circular dedispersion accumulators
+*and folded profiles. The blocks go through the same tile walk, 
+*accumulators and folding as those of AdvancedAnalysis (see 
+*walkChannelRows(), CircularAccumulators, normalizeDedispersedSeries()
+*and foldDedispersedSeries()). Plots, searches and the other outputs 
+*are only made for the pulsar of gptool.in.
+*The blocks of a polarization must be added in block order, 
+*different polarizations can be added in parallel.
+*******************************************************************/
+class PulsarPipeline
+{
+	public:
+	Information info;			//Parameters of the pulsar (name, period or polycos, DM, bins), the rest as in the main run
+	int*	delayTable;			//Delay of each channel at the DM of the pulsar
+	int	maxDelay;			//The maximum delay encountered
+	double	initPhasePolyco;		//Polyco phase of the first folded sample
+	long long int*	nextStartSample;	//Start sample of the next block, one for each polarization
+	long int	accumulatorLength;	//Length of the circular dedispersion accumulators
+	//Circular accumulators that the blocks are dedispersed into, one for each polarization
+	float**	accumulatedFullDM;
+	int**	accumulatedCount;
+	float**	accumulatedFullDMUnfiltered;
+	int**	accumulatedCountUnfiltered;
+	//Folded profiles and the number of samples in each bin, one for each polarization
+	float**	foldedProfile;
+	int**	countProfile;
+	float**	foldedProfileUnfiltered;
+	int**	countProfileUnfiltered;
+	
+	PulsarPipeline(Information info_);
+	~PulsarPipeline();
+	void addBlock(int polarIndex,float* rawData,long int length,char* timeFlags,char* freqFlags,char* sampleFlags,char isFlaggedBlock);	//Dedisperses a block and folds its completed samples
+	void writeProfile(int polarIndex,const char* filename,const char* filenameUnfiltered);	//Writes out the folded profiles
+	static vector<PulsarPipeline*> readPulsarList(Information& info_);	//Sets up a pipeline for each pulsar of the list
+};
+
+//implementation of PulsarPipeline methods begins
+
+/*******************************************************************
+*CONSTRUCTOR: PulsarPipeline::PulsarPipeline(Information info_)
+*Information info_	:Parameters of the run with those of the pulsar
+*			 (see Information::initializeFolding())
+*******************************************************************/
+PulsarPipeline::PulsarPipeline(Information info_)
+{
+	info=info_;
+	delayTable=new int[info.noOfChannels];
+	maxDelay=AdvancedAnalysis::calculateDelayTable(info,delayTable);
+	initPhasePolyco=0;
+	if(!info.doFixedPeriodFolding)
+	{
+		long double phase;
+		double slope,curvature;
+		info.expandPolyco(maxDelay*info.samplingInterval*1000.0,phase,slope,curvature);
+		initPhasePolyco=(double)(phase-floorl(phase));
+	}
+	//The blocks of a polarization are added one at a time, in block order.
+	accumulatorLength=info.blockSizeSamples+maxDelay;
+	nextStartSample=new long long int[info.noOfPol];
+	accumulatedFullDM=new float*[info.noOfPol];
+	accumulatedCount=new int*[info.noOfPol];
+	accumulatedFullDMUnfiltered=new float*[info.noOfPol];
+	accumulatedCountUnfiltered=new int*[info.noOfPol];
+	foldedProfile=new float*[info.noOfPol];
+	countProfile=new int*[info.noOfPol];
+	foldedProfileUnfiltered=new float*[info.noOfPol];
+	countProfileUnfiltered=new int*[info.noOfPol];
+	for(int k=0;k<info.noOfPol;k++)
+	{
+		nextStartSample[k]=0;
+		accumulatedFullDM[k]=new float[accumulatorLength];
+		accumulatedCount[k]=new int[accumulatorLength];
+		accumulatedFullDMUnfiltered[k]=new float[accumulatorLength];
+		accumulatedCountUnfiltered[k]=new int[accumulatorLength];
+		memset(accumulatedFullDM[k],0,accumulatorLength*sizeof(float));
+		memset(accumulatedCount[k],0,accumulatorLength*sizeof(int));
+		memset(accumulatedFullDMUnfiltered[k],0,accumulatorLength*sizeof(float));
+		memset(accumulatedCountUnfiltered[k],0,accumulatorLength*sizeof(int));
+		foldedProfile[k]=new float[info.periodInSamples];
+		countProfile[k]=new int[info.periodInSamples];
+		foldedProfileUnfiltered[k]=new float[info.periodInSamples];
+		countProfileUnfiltered[k]=new int[info.periodInSamples];
+		memset(foldedProfile[k],0,info.periodInSamples*sizeof(float));
+		memset(countProfile[k],0,info.periodInSamples*sizeof(int));
+		memset(foldedProfileUnfiltered[k],0,info.periodInSamples*sizeof(float));
+		memset(countProfileUnfiltered[k],0,info.periodInSamples*sizeof(int));
+	}
+}
+/*******************************************************************
+*DESTRUCTOR: PulsarPipeline::~PulsarPipeline()
+*frees up used memory.
+*******************************************************************/
+PulsarPipeline::~PulsarPipeline()
+{
+	for(int k=0;k<info.noOfPol;k++)
+	{
+		delete[] accumulatedFullDM[k];
+		delete[] accumulatedCount[k];
+		delete[] accumulatedFullDMUnfiltered[k];
+		delete[] accumulatedCountUnfiltered[k];
+		delete[] foldedProfile[k];
+		delete[] countProfile[k];
+		delete[] foldedProfileUnfiltered[k];
+		delete[] countProfileUnfiltered[k];
+	}
+	delete[] accumulatedFullDM;
+	delete[] accumulatedCount;
+	delete[] accumulatedFullDMUnfiltered;
+	delete[] accumulatedCountUnfiltered;
+	delete[] foldedProfile;
+	delete[] countProfile;
+	delete[] foldedProfileUnfiltered;
+	delete[] countProfileUnfiltered;
+	delete[] nextStartSample;
+	delete[] delayTable;
+}
+/*******************************************************************
+*FUNCTION: void PulsarPipeline::addBlock(int polarIndex,float* rawData,long int length,char* timeFlags,char* freqFlags,char* sampleFlags,char isFlaggedBlock)
+*int polarIndex		:Index of the polarization of the block
+*float* rawData		:2-D data of the block
+*long int length	:Number of time samples of the block
+*char* timeFlags	:Time samples marked 1 are left out.
+*char* freqFlags	:Channels (from startChannel) marked 1 are left out.
+*char* sampleFlags	:Individual samples marked 1 are left out (NULL if
+*			 none are)
+*char isFlaggedBlock	:1-> the block is mostly flagged and is neither 
+*			 dedispersed nor folded
+*The block is dedispersed into the accumulators of the polarization 
+*as in AdvancedAnalysis::calculateFullDM(). Its length samples are 
+*then complete, they are drained and folded as in 
+*AdvancedAnalysis::normalizeFullDM() and calculateProfile(). What the
+*block adds past its end stays in the accumulators for the next block.
+*******************************************************************/
+void PulsarPipeline::addBlock(int polarIndex,float* rawData,long int length,char* timeFlags,char* freqFlags,char* sampleFlags,char isFlaggedBlock)
+{
+	long long int startSample=nextStartSample[polarIndex];
+	nextStartSample[polarIndex]+=length;
+	CircularAccumulators accumulators(accumulatorLength,accumulatedFullDM[polarIndex],accumulatedCount[polarIndex],accumulatedFullDMUnfiltered[polarIndex],accumulatedCountUnfiltered[polarIndex],delayTable+info.startChannel,startSample);
+	if(!isFlaggedBlock)
+		walkChannelRows(info,rawData,timeFlags,freqFlags,sampleFlags,0,length,AdvancedAnalysis::dedispersionTileLength,1,accumulators);
+	float* fullDM=new float[length];
+	int* count=new int[length];
+	float* fullDMUnfiltered=new float[length];
+	int* countUnfiltered=new int[length];
+	accumulators.drain(length,fullDM,count,fullDMUnfiltered,countUnfiltered);
+	//Folding starts at sample maxDelay.
+	long int firstFolded=(startSample<maxDelay)?maxDelay-startSample:0;
+	if(!isFlaggedBlock && firstFolded<length)
+	{
+		long int n=length-firstFolded;
+		char* dedispFlags=new char[n];
+		normalizeDedispersedSeries(&fullDM[firstFolded],&count[firstFolded],&fullDMUnfiltered[firstFolded],&countUnfiltered[firstFolded],n,info.stopChannel-info.startChannel,dedispFlags);
+		double samplingIntervalMs=info.samplingInterval*1000.0;
+		int* bins=new int[n];
+		foldingBins(info,maxDelay*samplingIntervalMs,(startSample+firstFolded-maxDelay)*samplingIntervalMs,initPhasePolyco,n,bins);
+		foldDedispersedSeries(&fullDM[firstFolded],&fullDMUnfiltered[firstFolded],dedispFlags,bins,n,foldedProfile[polarIndex],countProfile[polarIndex],foldedProfileUnfiltered[polarIndex],countProfileUnfiltered[polarIndex]);
+		delete[] bins;
+		delete[] dedispFlags;
+	}
+	delete[] fullDM;
+	delete[] count;
+	delete[] fullDMUnfiltered;
+	delete[] countUnfiltered;
+}
+/*******************************************************************
+*FUNCTION: void PulsarPipeline::writeProfile(int polarIndex,const char* filename,const char* filenameUnfiltered)
+*Writes out the mean folded profiles of a polarization in the format
+*of AdvancedAnalysis::writeProfile().
+*******************************************************************/
+void PulsarPipeline::writeProfile(int polarIndex,const char* filename,const char* filenameUnfiltered)
+{
+	ofstream profileFile,profileFileUnfiltered;
+	profileFile.open(filename);
+	profileFile<<"#phase\tvalue"<<endl;
+	for(int i=0;i<info.periodInSamples;i++)
+	{
+		float value=(countProfile[polarIndex][i]!=0)?foldedProfile[polarIndex][i]/countProfile[polarIndex][i]:0;
+		profileFile<<i/float(info.periodInSamples)<<"\t"<<setprecision(20)<<" "<<value<<endl;
+	}
+	profileFileUnfiltered.open(filenameUnfiltered);
+	profileFileUnfiltered<<"#phase\tvalue"<<endl;
+	for(int i=0;i<info.periodInSamples;i++)
+	{
+		float value=(countProfileUnfiltered[polarIndex][i]!=0)?foldedProfileUnfiltered[polarIndex][i]/countProfileUnfiltered[polarIndex][i]:0;
+		profileFileUnfiltered<<i/float(info.periodInSamples)<<"\t"<<setprecision(20)<<" "<<value<<endl;
+	}
+}
+/*******************************************************************
+*FUNCTION: vector<PulsarPipeline*> PulsarPipeline::readPulsarList(Information& info_)
+*Information& info_	:Parameters of the run (after fillParams())
+*Reads info_.pulsarListFile, one pulsar per line with its name, period
+*in ms (-1 -> polyco), DM (-1 -> catalogue or polyco) and number of 
+*bins (-1 -> native resolution) as in gptool.in. Empty lines and 
+*lines starting with # are skipped. The polycos, period and DM of each
+*pulsar are found as for the main pulsar.
+*******************************************************************/
+vector<PulsarPipeline*> PulsarPipeline::readPulsarList(Information& info_)
+{
+	vector<PulsarPipeline*> pulsars;
+	ifstream listFile(info_.pulsarListFile.c_str(),ios::in);
+	if(!listFile.is_open())
+	{
+		cout<<"No pulsar list with name: "<<info_.pulsarListFile<<endl;
+		exit(1);
+	}
+	string line;
+	int lineNumber=0;
+	while(getline(listFile,line))
+	{
+		lineNumber++;
+		size_t start=line.find_first_not_of(" \t\r");
+		if(start==string::npos || line[start]=='#')
+			continue;
+		Information pulsarInfo=info_;
+		istringstream fields(line);
+		double period,dm;
+		int nBins;
+		if(!(fields>>pulsarInfo.pulsarName>>period>>dm>>nBins) || (period<=0 && period!=-1) || nBins==0 || nBins<-1)
+		{
+			cout<<"Error in line "<<lineNumber<<" of "<<info_.pulsarListFile<<":"<<endl;
+			cout<<"Expected: pulsar name, period in ms (-1 for polyco), DM (-1 from catalogue) and number of bins (-1 for native resolution)"<<endl;
+			exit(1);
+		}
+		pulsarInfo.periodInMs=period;
+		pulsarInfo.doFixedPeriodFolding=(period!=-1);
+		pulsarInfo.dispersionMeasure=dm;
+		pulsarInfo.periodInSamples=nBins;
+		pulsarInfo.profileOffset=0;
+		if(!pulsarInfo.doFixedPeriodFolding || pulsarInfo.dispersionMeasure<0)
+		{
+			if(pulsarInfo.psrcatdbPath==NULL)
+				info_.getPsrcatdbPath();
+			pulsarInfo.psrcatdbPath=info_.psrcatdbPath;
+			pulsarInfo.checkPulsarName();
+		}
+		pulsarInfo.initializeFolding();
+		//The phase is offset by the skipped start of the file as for the main pulsar (see Runtime::Runtime())
+		if(pulsarInfo.doReadFromFile)
+		{
+			double extraOffset=pulsarInfo.startTime*1000.0/pulsarInfo.periodInMs;
+			pulsarInfo.profileOffset=extraOffset-floor(extraOffset);
+		}
+		pulsars.push_back(new PulsarPipeline(pulsarInfo));
+	}
+	listFile.close();
+	return pulsars;
+}
+
+//implementation of PulsarPipeline methods ends
+
 class Plot
 {
 	public:
@@ -4789,6 +9131,7 @@ char *startFlags;
 char *endFlags;
 
 static bool keepRunning = true;
+static volatile sig_atomic_t snapshotRequested = 0;	//Set by SIGUSR1, the snapshot buffer is dumped
 class ThreadPacket
 {
 	public:
@@ -4893,6 +9236,13 @@ class Runtime
 	char* blankTimeFlags;
 	char* blankChanFlags;
 	float* histogramInterval;
+	float* histogramOrigin;
+	StreamingQuantile** zeroDMQuartiles;	//Streaming quartile estimators of zeroDM, 3 per polarization
+	ChannelMaskLibrary* channelMaskLibrary;	//Persistent channel mask of the band, NULL if not used
+	SnapshotBuffer* snapshotBuffer;		//Buffer of filtered 2-D data dumped around triggers, NULL if not used
+	vector<PulsarPipeline*> pulsars;	//Pipelines of the pulsars of the -pulsars list
+	PeriodicitySearch** periodicitySearch;	//Periodicity search of each polarization, NULL if not used
+	volatile char isPipeClosed;		//1-> all blocks have been through the pipeline (ends periodicityTasks())
 	char readDoneFlag;
 	char readCompleteFlag;
 	ThreadPacket** threadPacket;
@@ -4909,6 +9259,7 @@ class Runtime
 	void closePipe();
 	void quickclosePipe();
 	void action(int threadPacketIndex,int actionIndex);
+	void periodicityTasks();
 	private:
 	int nActions;
 	int nThreadMultiplicity,nThreadMultiplicityTemp;
@@ -4916,6 +9267,7 @@ class Runtime
 	char hasReachedEof;
 	
 	void writeAll(ThreadPacket* threadPacket);
+	void writePulsarProfiles();
 	void testStatistics(ThreadPacket* threadPacket);
 	void displayBlockIndex(int blockIndex);
 	void ioTasks(int threadPacketIndex);
@@ -4924,6 +9276,7 @@ class Runtime
 	void timeTasks(int threadPacketIndex);
 	void fullDMTask(int threadPacketIndex);
 	void floatConversionTasks(int threadPacketIndex);
+	void filterRawData(ThreadPacket* threadPacket,int polarIndex,long int firstSample,long int nSamples);	//Produces the filtered 2-D data of a range of time samples
 	void writeFlagStats(ThreadPacket* threadPacket);
 	void copyToSHM(ThreadPacket* threadPacket);
 };
@@ -4950,6 +9303,23 @@ Runtime::Runtime(Information info_,int nThreadMultiplicity_)
 		info.blockSizeSamples=(aquireData->info).blockSizeSamples;
 		info.blockSizeSec=(aquireData->info).blockSizeSec;
 	}
+	if(info.doTiledExecution)
+	{
+		/*A tile of raw input and its float conversion (all polarizations)
+		*is sized to half of the L2 cache so that it stays resident while
+		*it is converted and accumulated. The channel flags need the 
+		*bandshape and the time flags the zeroDM of the whole block, so a 
+		*block is taken through three passes over its tiles: conversion 
+		*and bandshape, normalization and zeroDM, then filtering and 
+		*dedispersion (see fullDMTask()).*/
+		long int cacheSize=sysconf(_SC_LEVEL2_CACHE_SIZE);
+		if(cacheSize<=0)
+			cacheSize=256*1024;
+		long int bytesPerSample=(long int)info.noOfChannels*info.noOfPol*(info.sampleSizeBytes+sizeof(float));
+		info.tileSizeSamples=(cacheSize/2)/bytesPerSample;
+		if(info.tileSizeSamples<1)
+			info.tileSizeSamples=1;
+	}
 	AquireData::info=info;
 	AquireData::curPos=long((info.startTime/info.samplingInterval))*info.noOfChannels*info.noOfPol* info.sampleSizeBytes;	
 	AquireData::info.startTime=long(info.startTime/info.blockSizeSec)*info.blockSizeSec;
@@ -4961,6 +9331,23 @@ Runtime::Runtime(Information info_,int nThreadMultiplicity_)
 	}
 
 	histogramInterval=new float[info.noOfPol];
+	histogramOrigin=new float[info.noOfPol];
+	zeroDMQuartiles=new StreamingQuantile*[3*info.noOfPol];
+	for(int i=0;i<info.noOfPol;i++)
+		for(int j=0;j<3;j++)
+			zeroDMQuartiles[3*i+j]=new StreamingQuantile(0.25*(j+1),4*info.blockSizeSamples);
+	channelMaskLibrary=NULL;
+	if(info.doChannelMaskLibrary)
+	{
+		channelMaskLibrary=new ChannelMaskLibrary(info);
+		cout<<"Channel mask library "<<channelMaskLibrary->fileName<<" masks "<<channelMaskLibrary->nMasked<<" channels"<<endl;
+	}
+	snapshotBuffer=NULL;
+	if(info.doSnapshot)
+	{
+		snapshotBuffer=new SnapshotBuffer(info);
+		cout<<"Snapshot buffer holds "<<snapshotBuffer->length<<" samples ("<<snapshotBuffer->length*info.noOfChannels*sizeof(short int)/1048576<<" MB)"<<endl;
+	}
 	int totalBlocksNoOff=0;
 	if(info.doReadFromFile)
 	{
@@ -4992,9 +9379,37 @@ Runtime::Runtime(Information info_,int nThreadMultiplicity_)
 	for(int k=0;k<info.noOfPol;k++)
 	{
 		if(!info.doFilteringOnly)
-			threadPacket[(nActions-1)*nThreadMultiplicity]->advancedAnalysisOld[k]=new AdvancedAnalysis(info);
+			threadPacket[(nActions-1)*nThreadMultiplicity]->advancedAnalysisOld[k]=new AdvancedAnalysis(info,nThreadMultiplicity);
 		threadPacket[nActions-1]->basicAnalysis[k]=new BasicAnalysis(info);	
 	}
+	if(info.doDMSearch && !info.doFilteringOnly)
+	{
+		DMSearch dmSearch(info);	//initializes the trials
+		cout<<dmSearch.nTrials<<" trial DMs in "<<dmSearch.nGroups<<" scrunch groups of a "<<dmSearch.nSubbands<<" channel FDMT"<<endl;
+	}
+	if(info.doSinglePulseSearch && !info.doFilteringOnly)
+	{
+		SinglePulseSearch singlePulseSearch(info);	//initializes the series to search
+		cout<<singlePulseSearch.nSeries<<" dedispersed series searched for single pulses"<<endl;
+	}
+	if(info.doCube && !info.doFilteringOnly)
+		SubintCube cube(info,AdvancedAnalysis::delayTable,AdvancedAnalysis::maxDelay,AdvancedAnalysis::dedispersionTileLength);	//initializes the subbands and phases
+	if(info.doPulsarList && !info.doFilteringOnly)
+	{
+		pulsars=PulsarPipeline::readPulsarList(info);
+		for(size_t p=0;p<pulsars.size();p++)
+			cout<<"Also folding "<<pulsars[p]->info.pulsarName<<" at DM "<<pulsars[p]->info.dispersionMeasure<<" pc/cc with "<<pulsars[p]->info.periodInSamples<<" bins (maximum delay "<<pulsars[p]->maxDelay<<" samples)"<<endl;
+	}
+	periodicitySearch=NULL;
+	isPipeClosed=0;
+	if(info.doPeriodicitySearch && !info.doFilteringOnly)
+	{
+		PeriodicitySearch periodicitySearchInit(info);	//initializes the series to search
+		cout<<periodicitySearchInit.nSeries<<" dedispersed series searched for periodicities"<<endl;
+		periodicitySearch=new PeriodicitySearch*[info.noOfPol];
+		for(int k=0;k<info.noOfPol;k++)
+			periodicitySearch[k]=new PeriodicitySearch(k);
+	}
 
 	blankTimeFlags=new char[info.blockSizeSamples+1];
 	blankChanFlags=new char[info.stopChannel-info.startChannel];
@@ -5007,8 +9422,8 @@ Runtime::Runtime(Information info_,int nThreadMultiplicity_)
 	
 	blockIndex=0;
 	chanFirst=0;
-	if((info.doTimeFlag && info.doChanFlag && (info.flagOrder==1)) || info.doUseNormalizedData ||info.doChanFlag)
-		chanFirst=1;
+	if((info.doTimeFlag && info.doChanFlag && (info.flagOrder==1)) || info.doUseNormalizedData ||info.doChanFlag || info.doSumThreshold || info.doSpectralKurtosis || info.doChannelMaskLibrary)
+		chanFirst=1;						//SumThreshold and spectral kurtosis use the bandshape pass of the block
 	//cout<<"Reached end of Runtime()"<<endl; //DEBUG
 	//omp_set_num_threads(2+3*nThreadMultiplicity);
 	
@@ -5022,6 +9437,27 @@ Runtime::~Runtime()
 	delete[] blankTimeFlags;
 	delete[] blankChanFlags;
 	delete[] histogramInterval;
+	delete[] histogramOrigin;
+	for(int i=0;i<3*info.noOfPol;i++)
+		delete zeroDMQuartiles[i];
+	delete[] zeroDMQuartiles;
+	if(channelMaskLibrary!=NULL)
+	{
+		channelMaskLibrary->write();
+		delete channelMaskLibrary;
+	}
+	if(snapshotBuffer!=NULL)
+		delete snapshotBuffer;
+	if(info.doCube && !info.doFilteringOnly)
+		SubintCube::writeComplete(0,1);
+	for(size_t p=0;p<pulsars.size();p++)
+		delete pulsars[p];
+	if(periodicitySearch!=NULL)
+	{
+		for(int k=0;k<info.noOfPol;k++)
+			delete periodicitySearch[k];
+		delete[] periodicitySearch;
+	}
 }
 void Runtime::displayBlockIndex(int blockIndex)
 {
@@ -5161,6 +9597,26 @@ void Runtime::intializeFiles()
 			fullDMCountfile.open("fullDMCount.gpt",ios::out | ios::trunc);
 			fullDMCountfile.close();
 		}
+		if(info.doDMSearch && !info.doFilteringOnly)
+		{
+			ofstream dmTimeFile;	
+			dmTimeFile.open("dmTime.gpt",ios::out | ios::trunc);
+			dmTimeFile.close();
+		}
+		if(info.doSinglePulseSearch && !info.doFilteringOnly)
+		{
+			ofstream singlePulseFile;	
+			singlePulseFile.open("singlepulse.gpt",ios::out | ios::trunc);
+			singlePulseFile<<"#MJD\tDM\tS/N\twidth_ms\tsample\tn_detections"<<endl;
+			singlePulseFile.close();
+		}
+		if(info.doPeriodicitySearch && !info.doFilteringOnly)
+		{
+			ofstream periodicityFile;	
+			periodicityFile.open("periodicity.gpt",ios::out | ios::trunc);
+			periodicityFile<<"#MJD_segment_start\tDM\tperiod_ms\tfrequency_Hz\tharmonics\tsigma\tpower\tsegment_s"<<endl;
+			periodicityFile.close();
+		}
 		
 		ofstream statFile;
 		statFile.open("stats.gpt",ios::out | ios::trunc);
@@ -5222,6 +9678,35 @@ void Runtime::intializeFiles()
 				fullDMCountfile.open(filename.str().c_str(),ios::out | ios::trunc);
 				fullDMCountfile.close();
 			}
+			if(info.doDMSearch && !info.doFilteringOnly)
+			{
+				filename.str("");
+				filename.clear();
+				filename<<"dmTime"<<k+1<<".gpt";
+				ofstream dmTimeFile;	
+				dmTimeFile.open(filename.str().c_str(),ios::out | ios::trunc);
+				dmTimeFile.close();
+			}
+			if(info.doSinglePulseSearch && !info.doFilteringOnly)
+			{
+				filename.str("");
+				filename.clear();
+				filename<<"singlepulse"<<k+1<<".gpt";
+				ofstream singlePulseFile;	
+				singlePulseFile.open(filename.str().c_str(),ios::out | ios::trunc);
+				singlePulseFile<<"#MJD\tDM\tS/N\twidth_ms\tsample\tn_detections"<<endl;
+				singlePulseFile.close();
+			}
+			if(info.doPeriodicitySearch && !info.doFilteringOnly)
+			{
+				filename.str("");
+				filename.clear();
+				filename<<"periodicity"<<k+1<<".gpt";
+				ofstream periodicityFile;	
+				periodicityFile.open(filename.str().c_str(),ios::out | ios::trunc);
+				periodicityFile<<"#MJD_segment_start\tDM\tperiod_ms\tfrequency_Hz\tharmonics\tsigma\tpower\tsegment_s"<<endl;
+				periodicityFile.close();
+			}
 			
 			filename.str("");
 			filename.clear();
@@ -5241,11 +9726,45 @@ void Runtime::intializeFiles()
 
 		}
 	}
+	if(info.doDMSearch && !info.doFilteringOnly)
+		DMSearch::writeTrials("dmTrials.gpt");
+	if(info.doCube && !info.doFilteringOnly)
+		SubintCube::writeHeader("cube.gpt");
+	if(info.doSnapshot)
+	{
+		ofstream snapshotFile;
+		snapshotFile.open("snapshots.gpt",ios::out | ios::trunc);
+		snapshotFile<<"#file\tMJD_start\tfirst_sample\tn_samples\tDM\tS/N"<<endl;
+		snapshotFile.close();
+	}
 	
 }
 
 void Runtime::writeAll(ThreadPacket *threadPacket)
 {
+	if(snapshotBuffer!=NULL)
+	{
+		snapshotBuffer->add(threadPacket->basicAnalysisWrite[0]->filteredRawData,threadPacket->basicAnalysisWrite[0]->blockLength);
+		if(info.doSinglePulseSearch && !info.doFilteringOnly)
+		{
+			vector<SinglePulseCandidate>& candidates=threadPacket->advancedAnalysis[0]->singlePulseSearch->candidates;
+			for(unsigned int c=0;c<candidates.size();c++)
+				if(candidates[c].snr>=info.snapshotThreshold)
+					snapshotBuffer->trigger(candidates[c].sample,(int)(candidates[c].widthMs/(info.samplingInterval*1000.0)+0.5),candidates[c].dm,candidates[c].snr);
+		}
+		if(snapshotRequested)
+		{
+			snapshotRequested=0;
+			snapshotBuffer->triggerAll();
+		}
+		snapshotBuffer->dumpReady(0);
+	}
+	if(info.doCube && !info.doFilteringOnly)
+	{
+		for(int k=0;k<info.noOfPol;k++)
+			threadPacket->advancedAnalysis[k]->cube->merge();
+		SubintCube::writeComplete(threadPacket->advancedAnalysis[0]->startSample+threadPacket->advancedAnalysis[0]->length,0);
+	}
 
 	
 	if(!info.doPolarMode)
@@ -5259,6 +9778,10 @@ void Runtime::writeAll(ThreadPacket *threadPacket)
 			threadPacket->advancedAnalysis[0]->writeFullDMCount("fullDMCount.gpt");
 			timeFullDMWrite+=omp_get_wtime(); //benchmark			
 		}
+		if(info.doDMSearch && !info.doFilteringOnly)
+			threadPacket->advancedAnalysis[0]->dmSearch->write("dmTime.gpt");
+		if(info.doSinglePulseSearch && !info.doFilteringOnly)
+			threadPacket->advancedAnalysis[0]->singlePulseSearch->write("singlepulse.gpt");
 		if(info.doWriteFiltered2D)
 		{
 			if(info.sampleSizeBytes==1)
@@ -5367,6 +9890,20 @@ void Runtime::writeAll(ThreadPacket *threadPacket)
 				
 				
 				
+			}
+			if(info.doDMSearch && !info.doFilteringOnly)
+			{
+				filename.str("");
+				filename.clear();
+				filename<<"dmTime"<<k+1<<".gpt";
+				threadPacket->advancedAnalysis[k]->dmSearch->write(filename.str().c_str());
+			}
+			if(info.doSinglePulseSearch && !info.doFilteringOnly)
+			{
+				filename.str("");
+				filename.clear();
+				filename<<"singlepulse"<<k+1<<".gpt";
+				threadPacket->advancedAnalysis[k]->singlePulseSearch->write(filename.str().c_str());
 			}
 			
 			/**
@@ -5400,6 +9937,58 @@ void Runtime::writeAll(ThreadPacket *threadPacket)
 	testStatistics(threadPacket);
 	writeFlagStats(threadPacket);
 }
+//Writes out the profiles of the pulsars of the -pulsars list, named as those of the main pulsar with _<pulsar name> appended.
+void Runtime::writePulsarProfiles()
+{
+	for(size_t p=0;p<pulsars.size();p++)
+		for(int k=0;k<info.noOfPol;k++)
+		{
+			ostringstream filename;
+			ostringstream filenameUnfiltered;
+			if(info.doPolarMode)
+			{
+				filename<<"profile_filtered"<<k+1<<"_"<<pulsars[p]->info.pulsarName<<".gpt";
+				filenameUnfiltered<<"profile_unfiltered"<<k+1<<"_"<<pulsars[p]->info.pulsarName<<".gpt";
+			}
+			else
+			{
+				filename<<"profile_filtered_"<<pulsars[p]->info.pulsarName<<".gpt";
+				filenameUnfiltered<<"profile_unfiltered_"<<pulsars[p]->info.pulsarName<<".gpt";
+			}
+			pulsars[p]->writeProfile(k,filename.str().c_str(),filenameUnfiltered.str().c_str());
+		}
+}
+
+/*******************************************************************
+*FUNCTION: void Runtime::periodicityTasks()
+*Runs on a thread of its own for the whole run. Searches the segments
+*fullDMTask() queues in the periodicity search of each polarization,
+*the polarizations in parallel, so that the FFTs of a segment do not 
+*hold up the pipeline. Once the pipe is closed the segments left are
+*searched and the searches are finished.
+*******************************************************************/
+void Runtime::periodicityTasks()
+{
+	if(periodicitySearch==NULL)
+		return;
+	while(1)
+	{
+		char isClosed=isPipeClosed;
+		#pragma omp flush
+		int nSearched=0;
+		#pragma omp parallel for reduction(+:nSearched) if(info.noOfPol>1)
+		for(int k=0;k<info.noOfPol;k++)
+			nSearched+=periodicitySearch[k]->searchQueued();
+		if(nSearched>0)
+			continue;
+		if(isClosed)
+			break;
+		usleep(10000);	//nothing queued, a segment takes many blocks
+	}
+	#pragma omp parallel for if(info.noOfPol>1)
+	for(int k=0;k<info.noOfPol;k++)
+		periodicitySearch[k]->finish();
+}
 
 double fillTime; //benchmark
 void Runtime::fillPipe()
@@ -5624,6 +10213,7 @@ void Runtime::quickclosePipe()
 		if(!info.doFilteringOnly)
 			threadPacket[nThreadMultiplicityTemp-1]->advancedAnalysis[0]->writeProfile("profile_filtered.gpt","profile_unfiltered.gpt");		
 	}
+	writePulsarProfiles();
 	//for(int j=0;j<nThreadMultiplicity;j++)
 	//	threadPacket[j]->freeMem();
 	for(int j=0;j<nThreadMultiplicity;j++)
@@ -5741,6 +10331,7 @@ void Runtime::closePipe()
 		if(!info.doFilteringOnly)
 			threadPacket[nThreadMultiplicityTemp-1]->advancedAnalysis[0]->writeProfile("profile_filtered.gpt","profile_unfiltered.gpt");		
 	}
+	writePulsarProfiles();
 	
 	for(int j=0;j<nThreadMultiplicityTemp;j++) //free'ing last packets
 		threadPacket[j]->freeMem();
@@ -5854,20 +10445,67 @@ void Runtime::floatConversionTasks(int threadPacketIndex)
 	for(int i=0;i<nThreadMultiplicity;i++)
 	{
 		ThreadPacket* thisThreadPacket=threadPacket[threadPacketIndex+i];
+		AquireData* aquireData=thisThreadPacket->aquireData;
 		
- 		timeConvertToFloat-=omp_get_wtime(); //benchmark
-		thisThreadPacket->aquireData->splitRawData();		
-		timeConvertToFloat+=omp_get_wtime(); //benchmark
-
-		for(int k=0;k<info.noOfPol;k++)
+		if(info.doTiledExecution)
+		{
+			/*Each tile is converted and, if the channel stage comes next on
+			*unmodified data, immediately added to the bandshape while it is
+			*still in cache.*/
+			char doAccumulate=chanFirst && info.sampleSizeBytes!=1 && !info.doSpectralKurtosis && !(info.doTimeFlag && info.doChanFlag && (info.flagOrder==2));
+			long int blockLength=aquireData->blockLength;
+			aquireData->allocateSplittedRawData();
+			for(int k=0;k<info.noOfPol;k++)
+			{
+				thisThreadPacket->basicAnalysis[k]=new BasicAnalysis(aquireData->splittedRawData[k],k,blockLength);
+				if(doAccumulate)
+					thisThreadPacket->basicAnalysis[k]->startBandshape();
+			}
+			for(long int firstSample=0;firstSample<blockLength;firstSample+=info.tileSizeSamples)
+			{
+				long int nSamples=(blockLength-firstSample<info.tileSizeSamples)?blockLength-firstSample:info.tileSizeSamples;
+				timeConvertToFloat-=omp_get_wtime(); //benchmark
+				aquireData->splitRawData(firstSample,nSamples);
+				timeConvertToFloat+=omp_get_wtime(); //benchmark
+				if(doAccumulate)
+				{
+					timeBandshape-=omp_get_wtime(); //benchmark
+					for(int k=0;k<info.noOfPol;k++)
+						thisThreadPacket->basicAnalysis[k]->accumulateBandshape(firstSample,nSamples);
+					timeBandshape+=omp_get_wtime(); //benchmark
+				}
+			}
+			for(int k=0;k<info.noOfPol;k++)
+			{
+				if(doAccumulate)
+					thisThreadPacket->basicAnalysis[k]->finishBandshape();
+			}
+		}
+		else
+		{
+	 		timeConvertToFloat-=omp_get_wtime(); //benchmark
+			aquireData->splitRawData();		
+			timeConvertToFloat+=omp_get_wtime(); //benchmark
+		}
+	}
+	if(!info.doTiledExecution)
+	{
+		//the split polarizations of the blocks are taken up as independent tasks
+		#pragma omp parallel for schedule(dynamic, 1)
+		for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
 		{
-			thisThreadPacket->basicAnalysis[k]=new BasicAnalysis(thisThreadPacket->aquireData->splittedRawData[k],k,thisThreadPacket->aquireData->blockLength);
+			ThreadPacket* thisThreadPacket=threadPacket[threadPacketIndex+task/info.noOfPol];
+			int k=task%info.noOfPol;
+			AquireData* aquireData=thisThreadPacket->aquireData;
+			thisThreadPacket->basicAnalysis[k]=new BasicAnalysis(aquireData->splittedRawData[k],k,aquireData->blockLength);
 		}
+	}
+	for(int i=0;i<nThreadMultiplicity;i++)
+	{
+		ThreadPacket* thisThreadPacket=threadPacket[threadPacketIndex+i];
 		thisThreadPacket->basicAnalysis[0]->headerInfo=thisThreadPacket->aquireData->headerInfo;
 		delete thisThreadPacket->aquireData;
 		thisThreadPacket->aquireData=NULL;
-
-
 	}
 	
 
@@ -5898,91 +10536,103 @@ void Runtime::plotTasks(int threadPacketIndex)
 *******************************************************************/
 void Runtime::channelTasks(int threadPacketIndex)
 {
-	#pragma omp parallel for ordered schedule(dynamic, 1)
-	for(int t=0;t<nThreadMultiplicity;t++)
-	{
+	/*The polarizations of the blocks are independent tasks, the RR and LL
+	*flags are combined after all of them are done. Only the merge into
+	*the cumulative bandshapes is ordered, tasks are in block order.*/
+	#pragma omp parallel for schedule(dynamic, 1) ordered
+	for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
+	{
+		int t=task/info.noOfPol;
+		int i=task%info.noOfPol;
 		//cout<<"channel thread id:"<<sched_getcpu()<<endl;
 		BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
 		RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
 		RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
-		for(int i=0;i<info.noOfPol;i++)
+		switch((int)info.bandshapeToUse)
 		{
-			switch((int)info.bandshapeToUse)
-			{
-				case 1:
-					
-					rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->bandshape[info.startChannel]),info.stopChannel-info.startChannel);					
-					rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxBandshape;
-					rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minBandshape;
-					
-					break;
-				case 2:
+			case 1:
+				
+				rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->bandshape[info.startChannel]),info.stopChannel-info.startChannel);					
+				rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxBandshape;
+				rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minBandshape;
+				
+				break;
+			case 2:
 
-					rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->normalizedBandshape[info.startChannel]),info.stopChannel-info.startChannel);
-					rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxNormalizedBandshape;
-					rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minNormalizedBandshape;
+				rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->normalizedBandshape[info.startChannel]),info.stopChannel-info.startChannel);
+				rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxNormalizedBandshape;
+				rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minNormalizedBandshape;
 
-					break;
-				case 3:
-					rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->meanToRmsBandshape[info.startChannel]),info.stopChannel-info.startChannel);	
-					rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxMeanToRmsBandshape;
-					rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minMeanToRmsBandshape;
-					break;
-				case 4:
-					rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->meanToRmsBandshape[info.startChannel]),info.stopChannel-info.startChannel);	
-					rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxMeanToRmsBandshape;
-					rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minMeanToRmsBandshape;
-					break;
-				default:
-					rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->bandshape[info.startChannel]),info.stopChannel-info.startChannel);
-					rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxBandshape;
-					rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minBandshape;
-					break;
-			}
-			
-			if(info.doTimeFlag && info.doChanFlag && (info.flagOrder==2))
-			{
-				timeBandshape-=omp_get_wtime(); //benchmark
-				basicAnalysis[i]->computeBandshape(rFIFilteringTime[i]->flags);			
-				timeBandshape+=omp_get_wtime(); //benchmark
-			}
-			else
-			{	
-				timeBandshape-=omp_get_wtime(); //benchmark
-				basicAnalysis[i]->computeBandshape();			
-				timeBandshape+=omp_get_wtime(); //benchmark
-			}
+				break;
+			case 3:
+				rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->meanToRmsBandshape[info.startChannel]),info.stopChannel-info.startChannel);	
+				rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxMeanToRmsBandshape;
+				rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minMeanToRmsBandshape;
+				break;
+			case 4:
+				rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->meanToRmsBandshape[info.startChannel]),info.stopChannel-info.startChannel);	
+				rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxMeanToRmsBandshape;
+				rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minMeanToRmsBandshape;
+				break;
+			default:
+				rFIFilteringChan[i]=new RFIFiltering(&(basicAnalysis[i]->bandshape[info.startChannel]),info.stopChannel-info.startChannel);
+				rFIFilteringChan[i]->inputMax=basicAnalysis[i]->maxBandshape;
+				rFIFilteringChan[i]->inputMin=basicAnalysis[i]->minBandshape;
+				break;
+		}
+		
+		if(info.doTimeFlag && info.doChanFlag && (info.flagOrder==2))
+		{
+			timeBandshape-=omp_get_wtime(); //benchmark
+			basicAnalysis[i]->computeBandshape(rFIFilteringTime[i]->flags);			
+			timeBandshape+=omp_get_wtime(); //benchmark
+		}
+		else if(!basicAnalysis[i]->isBandshapeComputed)		//tiled execution accumulates it in floatConversionTasks()
+		{	
 			timeBandshape-=omp_get_wtime(); //benchmark
-			#pragma omp ordered
-			basicAnalysis[i]->calculateCumulativeBandshapes();			
+			basicAnalysis[i]->computeBandshape();			
 			timeBandshape+=omp_get_wtime(); //benchmark
-			if(info.doChanFlag)
+		}
+		timeBandshape-=omp_get_wtime(); //benchmark
+		basicAnalysis[i]->calculateBlockBandshapes();
+		#pragma omp ordered
+		basicAnalysis[i]->mergeCumulativeBandshapes();			
+		timeBandshape+=omp_get_wtime(); //benchmark
+		if(info.doChanFlag)
+		{
+			timeRFIChanStats-=omp_get_wtime(); //benchmark
+			rFIFilteringChan[i]->cutoffToRms=info.chanCutOffToRMS;
+			rFIFilteringChan[i]->computeStatistics(info.chanFlagAlgo);
+			timeRFIChanStats+=omp_get_wtime(); //benchmark
+		
+			timeRFIChanFlag-=omp_get_wtime(); //benchmark
+			rFIFilteringChan[i]->flagData();
+			if((int)info.bandshapeToUse==4)
 			{
-				timeRFIChanStats-=omp_get_wtime(); //benchmark
-				rFIFilteringChan[i]->cutoffToRms=info.chanCutOffToRMS;
+				rFIFilteringChan[i]->input=&(basicAnalysis[i]->normalizedBandshape[info.startChannel]);
 				rFIFilteringChan[i]->computeStatistics(info.chanFlagAlgo);
-				timeRFIChanStats+=omp_get_wtime(); //benchmark
-			
-				timeRFIChanFlag-=omp_get_wtime(); //benchmark
-				rFIFilteringChan[i]->flagData();
-				if((int)info.bandshapeToUse==4)
-				{
-					rFIFilteringChan[i]->input=&(basicAnalysis[i]->normalizedBandshape[info.startChannel]);
-					rFIFilteringChan[i]->computeStatistics(info.chanFlagAlgo);
-					rFIFilteringChan[i]->flagData();	
-				}
-				rFIFilteringChan[i]->generateManualFlags(info.nBadChanBlocks,info.badChanBlocks,info.startChannel);
-				timeRFIChanFlag+=omp_get_wtime(); //benchmark	
+				rFIFilteringChan[i]->flagData();	
 			}
-			else
-			{
-				rFIFilteringChan[i]->generateBlankFlags();
-				rFIFilteringChan[i]->generateManualFlags(info.nBadChanBlocks,info.badChanBlocks,info.startChannel);
-			}
-		
+			if(channelMaskLibrary!=NULL)
+				channelMaskLibrary->update(rFIFilteringChan[i]->flags);
+			rFIFilteringChan[i]->generateManualFlags(info.nBadChanBlocks,info.badChanBlocks,info.startChannel);
+			timeRFIChanFlag+=omp_get_wtime(); //benchmark	
 		}
-		if(info.doPolarMode)
-		{ //transfer RR OR LL flags to all
+		else
+		{
+			rFIFilteringChan[i]->generateBlankFlags();
+			rFIFilteringChan[i]->generateManualFlags(info.nBadChanBlocks,info.badChanBlocks,info.startChannel);
+		}
+		if(channelMaskLibrary!=NULL)
+			channelMaskLibrary->applyMask(rFIFilteringChan[i]->flags);
+	
+	}
+	if(info.doPolarMode)
+	{ //transfer RR OR LL flags to all
+		#pragma omp parallel for
+		for(int t=0;t<nThreadMultiplicity;t++)
+		{
+			RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
 			char* ptrChanFlag1=rFIFilteringChan[0]->flags;
 			char* ptrChanFlag2=rFIFilteringChan[2]->flags;
 			for(int i=0;i<info.stopChannel-info.startChannel;i++,ptrChanFlag1++,ptrChanFlag2++)
@@ -6015,83 +10665,100 @@ void Runtime::channelTasks(int threadPacketIndex)
 void Runtime::timeTasks(int threadPacketIndex)
 {
 	float* histogramIntervalTemp=new float[info.noOfPol];
+	float* histogramOriginTemp=new float[info.noOfPol];
+	/*The polarizations of the blocks are independent tasks, the RR and LL
+	*flags are combined after all of them are done.*/
 	#pragma omp parallel for schedule(dynamic, 1)
-	for(int t=0;t<nThreadMultiplicity;t++)
+	for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
 	{
+		int t=task/info.noOfPol;
+		int i=task%info.noOfPol;
 		//cout<<"time thread id:"<<sched_getcpu()<<endl;
 		BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
 		RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
 		RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
 		
-		for(int i=0;i<info.noOfPol;i++)
+		rFIFilteringTime[i]=new RFIFiltering(basicAnalysis[i]->zeroDM,basicAnalysis[i]->blockLength);
+		char* chanFlags=blankChanFlags;
+		if(info.doChanFlag || info.doChannelMaskLibrary)
+			chanFlags=rFIFilteringChan[i]->flags;
+		if(info.doTiledExecution)
+		{
+			timeZeroDM-=omp_get_wtime(); //benchmark
+			basicAnalysis[i]->normalizeAndComputeZeroDM(chanFlags,info.tileSizeSamples);			
+			timeZeroDM+=omp_get_wtime(); //benchmark
+		}
+		else
 		{
 			timeNormalization-=omp_get_wtime(); //benchmark
 			if(info.doUseNormalizedData)
 				basicAnalysis[i]->normalizeData();
 			timeNormalization+=omp_get_wtime(); //benchmark
-			rFIFilteringTime[i]=new RFIFiltering(basicAnalysis[i]->zeroDM,basicAnalysis[i]->blockLength);
-			if(info.doChanFlag || (info.doTimeFlag && info.doChanFlag && (info.flagOrder==1)))
+			timeZeroDM-=omp_get_wtime(); //benchmark
+			basicAnalysis[i]->computeZeroDM(chanFlags);			
+			timeZeroDM+=omp_get_wtime(); //benchmark
+		}
+		if(info.doSumThreshold)
+		{
+			timeRFITimeFlags-=omp_get_wtime(); //benchmark
+			basicAnalysis[i]->flagSumThreshold(chanFlags);
+			timeRFITimeFlags+=omp_get_wtime(); //benchmark
+		}
+	
+	
+		if(info.doTimeFlag)
+		{
+			timeRFITimeStats-=omp_get_wtime(); //benchmark
+			rFIFilteringTime[i]->cutoffToRms=info.timeCutOffToRMS;
+			rFIFilteringTime[i]->inputMax=basicAnalysis[i]->maxZeroDM;
+			rFIFilteringTime[i]->inputMin=basicAnalysis[i]->minZeroDM;
+
+	 		rFIFilteringTime[i]->histogramInterval=histogramInterval[i];
+			rFIFilteringTime[i]->histogramOrigin=histogramOrigin[i];
+			rFIFilteringTime[i]->quartiles=&zeroDMQuartiles[3*i];
+			if(blockIndex==3*nThreadMultiplicity)
 			{
-				timeZeroDM-=omp_get_wtime(); //benchmark
-				basicAnalysis[i]->computeZeroDM(rFIFilteringChan[i]->flags);			
-				timeZeroDM+=omp_get_wtime(); //benchmark
-			}
-			else
-			{		
-				timeZeroDM-=omp_get_wtime(); //benchmark
-				basicAnalysis[i]->computeZeroDM(blankChanFlags);			
-				timeZeroDM+=omp_get_wtime(); //benchmark
+				rFIFilteringTime[i]->histogramInterval=(basicAnalysis[i]->maxZeroDM-basicAnalysis[i]->minZeroDM)/(pow(basicAnalysis[i]->blockLength,1/3.0));
+				rFIFilteringTime[i]->histogramOrigin=basicAnalysis[i]->minZeroDM;
 			}
+			rFIFilteringTime[i]->computeStatistics(info.timeFlagAlgo);
+			timeRFITimeStats+=omp_get_wtime(); //benchmark
 		
 		
-			if(info.doTimeFlag)
-			{
-				timeRFITimeStats-=omp_get_wtime(); //benchmark
-				rFIFilteringTime[i]->cutoffToRms=info.timeCutOffToRMS;
-				rFIFilteringTime[i]->inputMax=basicAnalysis[i]->maxZeroDM;
-				rFIFilteringTime[i]->inputMin=basicAnalysis[i]->minZeroDM;
-	
-		 		rFIFilteringTime[i]->histogramInterval=histogramInterval[i];
-				if(blockIndex==3*nThreadMultiplicity)
-					rFIFilteringTime[i]->histogramInterval=(basicAnalysis[i]->maxZeroDM-basicAnalysis[i]->minZeroDM)/(pow(basicAnalysis[i]->blockLength,1/3.0));
-				rFIFilteringTime[i]->computeStatistics(info.timeFlagAlgo);
-				timeRFITimeStats+=omp_get_wtime(); //benchmark
-			
-			
-				timeRFITimeFlags-=omp_get_wtime(); //benchmark
-				if(info.doMultiPointFilter)
-					rFIFilteringTime[i]->multiPointFlagData(info.cutoff);
-				else
-					rFIFilteringTime[i]->flagData();
-				if(info.doZeroDMSub==1)				
-					basicAnalysis[i]->subtractZeroDM(rFIFilteringChan[i]->flags,rFIFilteringTime[i]->centralTendency);
-
-				if(info.smoothFlagWindowLength>0)
-					rFIFilteringTime[i]->smoothFlags((int)info.smoothFlagWindowLength,info.concentrationThreshold);	
-				
-				if(!info.doReplaceByMean && info.doWriteFiltered2D)
-					basicAnalysis[i]->getFilteredRawData(rFIFilteringTime[i]->flags,rFIFilteringChan[i]->flags,0);
-				if(info.doReplaceByMean==1)
-					basicAnalysis[i]->getFilteredRawData(rFIFilteringTime[i]->flags,rFIFilteringChan[i]->flags,rFIFilteringTime[i]->centralTendency);
-				else if(info.doReplaceByMean==2)
-					basicAnalysis[i]->getFilteredRawDataSmoothBshape(rFIFilteringTime[i]->flags,rFIFilteringChan[i]->flags);
-				timeRFITimeFlags+=omp_get_wtime(); //benchmark
-				
-			
-			}
+			timeRFITimeFlags-=omp_get_wtime(); //benchmark
+			if(info.doMultiPointFilter)
+				rFIFilteringTime[i]->multiPointFlagData(info.cutoff,info.multiPointLength);
 			else
-			{
-				rFIFilteringTime[i]->generateBlankFlags();
-				if(info.doZeroDMSub==1)				
-					basicAnalysis[i]->subtractZeroDM(rFIFilteringChan[i]->flags,1);
-			}
+				rFIFilteringTime[i]->flagData();
+			if(info.doZeroDMSub==1)				
+				basicAnalysis[i]->subtractZeroDM(rFIFilteringChan[i]->flags,rFIFilteringTime[i]->centralTendency);
+
+			if(info.smoothFlagWindowLength>0)
+				rFIFilteringTime[i]->smoothFlags((int)info.smoothFlagWindowLength,info.concentrationThreshold);	
+			timeRFITimeFlags+=omp_get_wtime(); //benchmark
 			
+		
+		}
+		else
+		{
+			rFIFilteringTime[i]->generateBlankFlags();
+			if(info.doZeroDMSub==1)				
+				basicAnalysis[i]->subtractZeroDM(rFIFilteringChan[i]->flags,1);
 		}
+		
 		if(t==nThreadMultiplicity-1)
-			for(int i=0;i<info.noOfPol;i++)
-				histogramIntervalTemp[i]=rFIFilteringTime[i]->histogramInterval;
-		if(info.doPolarMode)
-		{ //transfer RR OR LL flags to all
+		{
+			histogramIntervalTemp[i]=rFIFilteringTime[i]->histogramInterval;
+			histogramOriginTemp[i]=rFIFilteringTime[i]->histogramOrigin;
+		}
+	}
+	if(info.doPolarMode)
+	{ //transfer RR OR LL flags to all
+		#pragma omp parallel for
+		for(int t=0;t<nThreadMultiplicity;t++)
+		{
+			BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
+			RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
 			char* ptrTimeFlag1=rFIFilteringTime[0]->flags;
 			char* ptrTimeFlag2=rFIFilteringTime[2]->flags;
 			for(int i=0;i<basicAnalysis[0]->blockLength;i++,ptrTimeFlag1++,ptrTimeFlag2++)
@@ -6107,15 +10774,105 @@ void Runtime::timeTasks(int threadPacketIndex)
 					*ptrTimeFlag2=*ptrTimeFlag1;			
 				}
 			}
+			if(basicAnalysis[0]->sampleFlags!=NULL)
+			{
+				long int size=basicAnalysis[0]->blockLength*info.noOfChannels;
+				char* ptrSampleFlag1=basicAnalysis[0]->sampleFlags;
+				char* ptrSampleFlag2=basicAnalysis[2]->sampleFlags;
+				for(long int j=0;j<size;j++,ptrSampleFlag1++,ptrSampleFlag2++)
+					*ptrSampleFlag1=(*ptrSampleFlag1 | *ptrSampleFlag2);
+				for(int i=1;i<info.noOfPol;i++)
+					memcpy(basicAnalysis[i]->sampleFlags,basicAnalysis[0]->sampleFlags,size);
+			}
+		}
+	}
+	/*The flags are final from here on. Whether a block is mostly flagged
+	*is decided once on them, the filtered 2-D data and all stages of 
+	*fullDMTask() go by the same decision.*/
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
+	{
+		int t=task/info.noOfPol;
+		int i=task%info.noOfPol;
+		BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
+		RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
+		RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
+		if(info.doSkipFlaggedBlocks)
+			basicAnalysis[i]->isFlaggedBlock=(flagOccupancy(rFIFilteringTime[i]->flags,basicAnalysis[i]->blockLength,rFIFilteringChan[i]->flags,info.stopChannel-info.startChannel)>info.skipFlaggedOccupancy);
+		timeRFITimeFlags-=omp_get_wtime(); //benchmark
+		if(info.doTimeFlag && basicAnalysis[i]->isFlaggedBlock)
+		{
+			if(!info.doReplaceByMean && info.doWriteFiltered2D)
+				basicAnalysis[i]->getReplacedRawData(0);
+			if(info.doReplaceByMean==1)
+				basicAnalysis[i]->getReplacedRawData(rFIFilteringTime[i]->centralTendency);
+			else if(info.doReplaceByMean==2)
+				basicAnalysis[i]->getReplacedRawDataSmoothBshape();
 		}
+		//In tiled execution the blocks that are dedispersed are filtered tile by tile in fullDMTask()
+		if(!(info.doTiledExecution && !info.doOverlapSave && !info.doFilteringOnly) || basicAnalysis[i]->isFlaggedBlock)
+			filterRawData(threadPacket[threadPacketIndex+t],i,0,basicAnalysis[i]->blockLength);
+		timeRFITimeFlags+=omp_get_wtime(); //benchmark
 	}
 	
 	for(int i=0;i<info.noOfPol;i++)
+	{
 		histogramInterval[i]=histogramIntervalTemp[i];
+		histogramOrigin[i]=histogramOriginTemp[i];
+	}
 	delete[] histogramIntervalTemp;
+	delete[] histogramOriginTemp;
+	/*The streaming estimators are updated with the zeroDM of all blocks
+	*in block order once their thresholds are computed.*/
+	if(info.doTimeFlag && info.timeFlagAlgo==3)
+	{
+		timeRFITimeStats-=omp_get_wtime(); //benchmark
+		#pragma omp parallel for
+		for(int i=0;i<info.noOfPol;i++)
+			for(int t=0;t<nThreadMultiplicity;t++)
+			{
+				BasicAnalysis* basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis[i];
+				float* ptrZeroDM=basicAnalysis->zeroDM;
+				for(long int k=0;k<basicAnalysis->blockLength;k++,ptrZeroDM++)
+					for(int j=0;j<3;j++)
+						zeroDMQuartiles[3*i+j]->add(*ptrZeroDM);
+			}
+		timeRFITimeStats+=omp_get_wtime(); //benchmark
+	}
 	
 }
 /*******************************************************************
+*FUNCTION: void Runtime::filterRawData(ThreadPacket* threadPacket,int polarIndex,long int firstSample,long int nSamples)
+*ThreadPacket* threadPacket	:block to filter
+*int polarIndex			:polarization to filter
+*long int firstSample		:first time sample of the range
+*long int nSamples		:number of time samples in the range
+*Produces the filtered 2-D data of a range of time samples on the 
+*final flags, as needed for -replace, the filtered 2-D output and the
+*snapshot buffer (which keeps the first polarization). Blocks that 
+*are mostly flagged are replaced as a whole in timeTasks() instead.
+*******************************************************************/
+void Runtime::filterRawData(ThreadPacket* threadPacket,int polarIndex,long int firstSample,long int nSamples)
+{
+	BasicAnalysis* basicAnalysis=threadPacket->basicAnalysis[polarIndex];
+	RFIFiltering* rFIFilteringTime=threadPacket->rFIFilteringTime[polarIndex];
+	char* chanFlags=threadPacket->rFIFilteringChan[polarIndex]->flags;
+	char isFiltered=info.doTimeFlag && (info.doReplaceByMean || info.doWriteFiltered2D);
+	if(isFiltered && basicAnalysis->isFlaggedBlock)
+		return;
+	if(isFiltered)
+	{
+		if(!info.doReplaceByMean && info.doWriteFiltered2D)
+			basicAnalysis->getFilteredRawData(rFIFilteringTime->flags,chanFlags,0,firstSample,nSamples);
+		if(info.doReplaceByMean==1)
+			basicAnalysis->getFilteredRawData(rFIFilteringTime->flags,chanFlags,rFIFilteringTime->centralTendency,firstSample,nSamples);
+		else if(info.doReplaceByMean==2)
+			basicAnalysis->getFilteredRawDataSmoothBshape(rFIFilteringTime->flags,chanFlags,firstSample,nSamples);
+	}
+	else if(info.doSnapshot && polarIndex==0)
+		basicAnalysis->getFilteredRawData(rFIFilteringTime->flags,(info.doChanFlag || info.doChannelMaskLibrary)?chanFlags:blankChanFlags,0,firstSample,nSamples);
+}
+/*******************************************************************
 *FUNCTION: void thread4Tasks(int threadPacketIndex)
 *This function performs the tasks on thread four.
 *The tasks are :Calculating dedispersed time series and folding it
@@ -6125,54 +10882,204 @@ void Runtime::timeTasks(int threadPacketIndex)
 *******************************************************************/
 void Runtime::fullDMTask(int threadPacketIndex)
 {
-	float timeCalc=0.0;
-	float timeMerge=0.0;
-	float timeNormalize=0.0;
 	omp_set_nested(1);
-	#pragma omp parallel for ordered schedule(dynamic, 1) 
+	//The blocks are created in block order, this places them in the dedispersion accumulators.
 	for(int t=0;t<nThreadMultiplicity;t++)
 	{
-		//cout<<"dedisp thread id:"<<sched_getcpu()<<endl;
 		BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
-		RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
-		RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
 		AdvancedAnalysis **advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis;
-		AdvancedAnalysis **advancedAnalysisOld;
-		if(t==0)
-			advancedAnalysisOld=threadPacket[threadPacketIndex]->advancedAnalysisOld;
-
-		else
-			advancedAnalysisOld=threadPacket[threadPacketIndex+t-1]->advancedAnalysis;
 		for(int k=0;k<info.noOfPol;k++)
 		{
 			advancedAnalysis[k]=new AdvancedAnalysis(blockIndex+t-(nActions-1)*nThreadMultiplicity,k,basicAnalysis[k]->rawData,basicAnalysis[k]->blockLength);
+			advancedAnalysis[k]->isFlaggedBlock=basicAnalysis[k]->isFlaggedBlock;
+		}
+	}
+	if(info.doOverlapSave)
+	{
+		/*Overlap-save: every block first goes into the history, flagged
+		*blocks included as the blocks after them read their samples. Each
+		*block then reads its dedispersed series off the history on its 
+		*own, with no ordering between the blocks.*/
+		#pragma omp parallel for schedule(dynamic, 1) 
+		for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
+		{
+			int t=task/info.noOfPol;
+			int k=task%info.noOfPol;
+			BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
+			RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
+			RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
+			AdvancedAnalysis **advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis;
 			timeFullDMCalc-=omp_get_wtime(); //benchmark
-			if(info.doReplaceByMean)
-				advancedAnalysis[k]->calculateFullDM(basicAnalysis[k]->filteredRawData);
-			else
-				advancedAnalysis[k]->calculateFullDM(rFIFilteringTime[k]->flags,rFIFilteringChan[k]->flags);
+			advancedAnalysis[k]->saveHistory(rFIFilteringTime[k]->flags,rFIFilteringChan[k]->flags,basicAnalysis[k]->sampleFlags);
 			timeFullDMCalc+=omp_get_wtime(); //benchmark
 		}
-		timeFullDMCalc-=omp_get_wtime(); //benchmark
-		
-		#pragma omp ordered
-		for(int k=0;k<info.noOfPol;k++)
-			advancedAnalysis[k]->mergeExcess(advancedAnalysisOld[k]->excess,advancedAnalysisOld[k]->countExcess,advancedAnalysisOld[k]->excessUnfiltered,advancedAnalysisOld[k]->countExcessUnfiltered);
-		timeFullDMCalc+=omp_get_wtime(); //benchmar
-		
-		for(int k=0;k<info.noOfPol;k++)
+		#pragma omp parallel for schedule(dynamic, 1) 
+		for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
 		{
-			
+			int t=task/info.noOfPol;
+			int k=task%info.noOfPol;
+			AdvancedAnalysis **advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis;
 			timeFullDMCalc-=omp_get_wtime(); //benchmark
+			if(!advancedAnalysis[k]->isFlaggedBlock)
+				advancedAnalysis[k]->calculateFullDMOverlapSave();
 			advancedAnalysis[k]->normalizeFullDM();
 			timeFullDMCalc+=omp_get_wtime(); //benchmark
-			
-			timeProfileCalc-=omp_get_wtime(); //benchmark
-			advancedAnalysis[k]->calculateProfile();	
-			timeProfileCalc+=omp_get_wtime(); //benchmark
-		}		
+		}
 	}
-	
+	else
+	{
+		/*The polarizations of the blocks are dedispersed as independent 
+		*tasks. A block adds to the accumulators up to maxDelay samples past
+		*its end, so the blocks are taken up in nGroups rounds in which the 
+		*blocks of a polarization are at least nGroups blocks apart and never
+		*add to the same samples.*/
+		int nGroups=1+(AdvancedAnalysis::maxDelay+info.blockSizeSamples-1)/info.blockSizeSamples;
+		if(nGroups>nThreadMultiplicity)
+			nGroups=nThreadMultiplicity;
+		for(int group=0;group<nGroups;group++)
+		{
+			#pragma omp parallel for schedule(dynamic, 1) 
+			for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
+			{
+				int t=task/info.noOfPol;
+				int k=task%info.noOfPol;
+				if(t%nGroups!=group)
+					continue;
+				//cout<<"dedisp thread id:"<<sched_getcpu()<<endl;
+				BasicAnalysis **basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis;
+				RFIFiltering **rFIFilteringChan=threadPacket[threadPacketIndex+t]->rFIFilteringChan;
+				RFIFiltering **rFIFilteringTime=threadPacket[threadPacketIndex+t]->rFIFilteringTime;
+				AdvancedAnalysis **advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis;
+				//A flagged block is left out of the dedispersed series, it still takes what the earlier blocks added to its samples in drainAccumulators()
+				if(advancedAnalysis[k]->isFlaggedBlock)
+					continue;
+				timeFullDMCalc-=omp_get_wtime(); //benchmark
+				if(info.doTiledExecution)
+				{
+					/*Last phase of the tile schedule: each tile is filtered on 
+					*the final flags and dedispersed while it is in cache.*/
+					long int blockLength=basicAnalysis[k]->blockLength;
+					for(long int firstSample=0;firstSample<blockLength;firstSample+=info.tileSizeSamples)
+					{
+						long int nSamples=(blockLength-firstSample<info.tileSizeSamples)?blockLength-firstSample:info.tileSizeSamples;
+						filterRawData(threadPacket[threadPacketIndex+t],k,firstSample,nSamples);
+						if(info.doReplaceByMean)
+							advancedAnalysis[k]->calculateFullDM(basicAnalysis[k]->filteredRawData,firstSample,nSamples);
+						else
+							advancedAnalysis[k]->calculateFullDM(rFIFilteringTime[k]->flags,rFIFilteringChan[k]->flags,basicAnalysis[k]->sampleFlags,firstSample,nSamples);
+					}
+				}
+				else if(info.doReplaceByMean)
+					advancedAnalysis[k]->calculateFullDM(basicAnalysis[k]->filteredRawData);
+				else if(basicAnalysis[k]->sampleFlags!=NULL)
+					advancedAnalysis[k]->calculateFullDM(rFIFilteringTime[k]->flags,rFIFilteringChan[k]->flags,basicAnalysis[k]->sampleFlags);
+				else
+					advancedAnalysis[k]->calculateFullDM(rFIFilteringTime[k]->flags,rFIFilteringChan[k]->flags);
+				timeFullDMCalc+=omp_get_wtime(); //benchmark
+			}
+		}
+		
+		#pragma omp parallel for schedule(dynamic, 1) 
+		for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
+		{
+			AdvancedAnalysis *advancedAnalysis=threadPacket[threadPacketIndex+task/info.noOfPol]->advancedAnalysis[task%info.noOfPol];
+			timeFullDMCalc-=omp_get_wtime(); //benchmark
+			advancedAnalysis->drainAccumulators();
+			advancedAnalysis->normalizeFullDM();
+			timeFullDMCalc+=omp_get_wtime(); //benchmark
+		}
+	}
+	/*Each block is searched over the trial DMs with the samples the block
+	*before it left in DMSearch::tail and for single pulses with what the 
+	*block before it left in SinglePulseSearch, so the blocks of a 
+	*polarization are searched in block order.*/
+	if(info.doDMSearch || info.doSinglePulseSearch)
+	{
+		#pragma omp parallel for
+		for(int k=0;k<info.noOfPol;k++)
+			for(int t=0;t<nThreadMultiplicity;t++)
+			{
+				BasicAnalysis *basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis[k];
+				AdvancedAnalysis *advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis[k];
+				if(info.doDMSearch)
+				{
+					advancedAnalysis->dmSearch=new DMSearch(k,basicAnalysis->blockLength);
+					advancedAnalysis->dmSearch->transform(basicAnalysis->rawData,threadPacket[threadPacketIndex+t]->rFIFilteringTime[k]->flags,threadPacket[threadPacketIndex+t]->rFIFilteringChan[k]->flags,basicAnalysis->sampleFlags);
+				}
+				if(info.doSinglePulseSearch)
+				{
+					advancedAnalysis->singlePulseSearch=new SinglePulseSearch(k,advancedAnalysis->startSample,advancedAnalysis->length);
+					if(advancedAnalysis->hasEnoughDedispersedData && !advancedAnalysis->isFlaggedBlock)
+						advancedAnalysis->singlePulseSearch->search(advancedAnalysis->fullDM,advancedAnalysis->dedispFlags,advancedAnalysis->foldingStartIndex,advancedAnalysis->dmSearch);
+					else
+						advancedAnalysis->singlePulseSearch->search(NULL,advancedAnalysis->dedispFlags,0,advancedAnalysis->dmSearch);
+				}
+			}
+	}
+	/*The series of the blocks are appended to the periodicity search of
+	*their polarization in block order. A block that completes a segment
+	*only queues it, it is searched on the periodicity thread (see 
+	*periodicityTasks()).*/
+	if(periodicitySearch!=NULL)
+	{
+		for(int k=0;k<info.noOfPol;k++)
+			for(int t=0;t<nThreadMultiplicity;t++)
+			{
+				AdvancedAnalysis *advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis[k];
+				if(advancedAnalysis->hasEnoughDedispersedData && !advancedAnalysis->isFlaggedBlock)
+					periodicitySearch[k]->add(advancedAnalysis->fullDM,advancedAnalysis->dedispFlags,advancedAnalysis->foldingStartIndex,advancedAnalysis->length,advancedAnalysis->dmSearch);
+				else
+					periodicitySearch[k]->add(NULL,NULL,0,advancedAnalysis->length,advancedAnalysis->dmSearch);
+			}
+	}
+	//Each block folds into its own partial cube, they are merged in block order in writeAll().
+	if(info.doCube)
+	{
+		timeProfileCalc-=omp_get_wtime(); //benchmark
+		#pragma omp parallel for schedule(dynamic, 1) 
+		for(int task=0;task<nThreadMultiplicity*info.noOfPol;task++)
+		{
+			int t=task/info.noOfPol;
+			int k=task%info.noOfPol;
+			BasicAnalysis *basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis[k];
+			AdvancedAnalysis *advancedAnalysis=threadPacket[threadPacketIndex+t]->advancedAnalysis[k];
+			advancedAnalysis->cube=new SubintCube(k,advancedAnalysis->startSample,advancedAnalysis->length);
+			if(advancedAnalysis->isFlaggedBlock)
+				continue;
+			advancedAnalysis->cube->fold(basicAnalysis->rawData,threadPacket[threadPacketIndex+t]->rFIFilteringTime[k]->flags,threadPacket[threadPacketIndex+t]->rFIFilteringChan[k]->flags,basicAnalysis->sampleFlags);
+		}
+		timeProfileCalc+=omp_get_wtime(); //benchmark
+	}
+	/*Each polarization of each pulsar of the -pulsars list takes up the 
+	*blocks in block order.*/
+	if(!pulsars.empty())
+	{
+		timeFullDMCalc-=omp_get_wtime(); //benchmark
+		#pragma omp parallel for schedule(dynamic, 1)
+		for(int task=0;task<(int)pulsars.size()*info.noOfPol;task++)
+		{
+			int k=task%info.noOfPol;
+			for(int t=0;t<nThreadMultiplicity;t++)
+			{
+				BasicAnalysis *basicAnalysis=threadPacket[threadPacketIndex+t]->basicAnalysis[k];
+				pulsars[task/info.noOfPol]->addBlock(k,basicAnalysis->rawData,basicAnalysis->blockLength,threadPacket[threadPacketIndex+t]->rFIFilteringTime[k]->flags,threadPacket[threadPacketIndex+t]->rFIFilteringChan[k]->flags,basicAnalysis->sampleFlags,threadPacket[threadPacketIndex+t]->advancedAnalysis[k]->isFlaggedBlock);
+			}
+		}
+		timeFullDMCalc+=omp_get_wtime(); //benchmark
+	}
+	//The blocks of a polarization are folded in block order. The bins of a block are the same for all polarizations.
+	timeProfileCalc-=omp_get_wtime(); //benchmark
+	int** blockBins=new int*[nThreadMultiplicity];
+	for(int t=0;t<nThreadMultiplicity;t++)
+		blockBins[t]=threadPacket[threadPacketIndex+t]->advancedAnalysis[0]->calculateFoldingBins();
+	#pragma omp parallel for
+	for(int k=0;k<info.noOfPol;k++)
+		for(int t=0;t<nThreadMultiplicity;t++)
+			threadPacket[threadPacketIndex+t]->advancedAnalysis[k]->calculateProfile(blockBins[t]);	
+	for(int t=0;t<nThreadMultiplicity;t++)
+		delete[] blockBins[t];
+	delete[] blockBins;
+	timeProfileCalc+=omp_get_wtime(); //benchmark
 }
 
 
@@ -6181,6 +11088,10 @@ void intHandler(int) {
     	keepRunning = false;
 }
 
+void snapshotHandler(int) {
+    	snapshotRequested = 1;
+}
+
 
 int main(int argc, char *argv[])
 {
@@ -6194,6 +11105,38 @@ int main(int argc, char *argv[])
 	info.doRunFilteredMode=0;
 	info.psrcatdbPath=NULL;
 	info.isInline=0;
+	info.doTiledExecution=0;
+	info.tileSizeSamples=0;
+	info.doSumThreshold=0;
+	info.sumThresholdCutOff=6;
+	info.doSpectralKurtosis=0;
+	info.skBlockLength=0;
+	info.skShape=1;
+	info.doChannelMaskLibrary=0;
+	info.channelMaskOccupancy=0.9;
+	info.doSkipFlaggedBlocks=0;
+	info.skipFlaggedOccupancy=0.95;
+	info.doOverlapSave=0;
+	info.doDMSearch=0;
+	info.dmSearchLow=0;
+	info.dmSearchHigh=0;
+	info.dmSearchTolerance=1.25;
+	info.doSinglePulseSearch=0;
+	info.singlePulseThreshold=6;
+	info.singlePulseMaxWidthMs=10;
+	info.doSnapshot=0;
+	info.snapshotBufferSec=10;
+	info.snapshotThreshold=10;
+	info.doCube=0;
+	info.cubeSubintSec=10;
+	info.cubeSubbands=16;
+	info.doPulsarList=0;
+	info.doPeriodicitySearch=0;
+	info.periodicitySegmentSec=0;
+	info.periodicityHarmonics=16;
+	info.periodicityThreshold=6;
+	info.doMultiPointFilter=0;
+	info.multiPointLength=1;
 	info.shmID=1;
 	int arg = 1;
 	int nThreadMultiplicity=1;
@@ -6220,6 +11163,21 @@ int main(int argc, char *argv[])
         			case 'f':
         			case 'F':
         			{          
+					if(string(argv[arg]) == "-fftsearch")
+					{
+						info.doPeriodicitySearch=1;
+						info.periodicitySegmentSec=info.stringToDouble(argv[arg+1]);
+						info.periodicityHarmonics=info.stringToDouble(argv[arg+2]);
+						info.periodicityThreshold=info.stringToDouble(argv[arg+3]);
+						int h=info.periodicityHarmonics;
+						if(info.periodicitySegmentSec<0 || h<1 || h>32 || (h&(h-1))!=0 || info.periodicityThreshold<=0)
+						{
+							cout<<"FFT search needs segment_sec>=0, n_harmonics a power of 2 up to 32 and sigma>0."<<endl;
+							exit(0);
+						}
+						arg+=4;
+						break;
+					}
           				info.filepath = argv[arg+1];
           				info.doReadFromFile = 1;
           				arg+=2;
@@ -6227,6 +11185,12 @@ int main(int argc, char *argv[])
         			break;
         			case 'o':
         			{          
+					if(string(argv[arg]) == "-overlapsave")
+					{
+						info.doOverlapSave=1;
+						arg+=1;
+						break;
+					}
           				info.outputfilepath = argv[arg+1];
           				arg+=2;
         			}
@@ -6240,7 +11204,63 @@ int main(int argc, char *argv[])
         			break;
         			case 's':
         			{       
-					if(string(argv[arg]) == "-shmID")
+					if(string(argv[arg]) == "-sk")
+					{
+						info.doSpectralKurtosis=1;
+						info.skBlockLength=info.stringToDouble(argv[arg+1]);
+						info.skShape=info.stringToDouble(argv[arg+2]);
+						if(info.skBlockLength<2 || info.skShape<=0)
+						{
+							cout<<"Spectral kurtosis needs M>=2 and N*d>0."<<endl;
+							exit(0);
+						}
+						arg+=1;
+					}
+					else if(string(argv[arg]) == "-sumthreshold")
+					{
+						info.doSumThreshold=1;
+						info.sumThresholdCutOff=info.stringToDouble(argv[arg+1]);
+						if(info.sumThresholdCutOff<=0)
+						{
+							cout<<"SumThreshold cutoff must be positive."<<endl;
+							exit(0);
+						}
+					}
+					else if(string(argv[arg]) == "-skipflagged")
+					{
+						info.doSkipFlaggedBlocks=1;
+						info.skipFlaggedOccupancy=info.stringToDouble(argv[arg+1])/100.0;
+						if(info.skipFlaggedOccupancy<=0 || info.skipFlaggedOccupancy>1)
+						{
+							cout<<"Flagged block occupancy must be between 0 and 100 percent."<<endl;
+							exit(0);
+						}
+					}
+					else if(string(argv[arg]) == "-singlepulse")
+					{
+						info.doSinglePulseSearch=1;
+						info.singlePulseThreshold=info.stringToDouble(argv[arg+1]);
+						info.singlePulseMaxWidthMs=info.stringToDouble(argv[arg+2]);
+						if(info.singlePulseThreshold<=0 || info.singlePulseMaxWidthMs<=0)
+						{
+							cout<<"Single pulse search needs S/N>0 and max_width_ms>0."<<endl;
+							exit(0);
+						}
+						arg+=1;
+					}
+					else if(string(argv[arg]) == "-snapshot")
+					{
+						info.doSnapshot=1;
+						info.snapshotBufferSec=info.stringToDouble(argv[arg+1]);
+						info.snapshotThreshold=info.stringToDouble(argv[arg+2]);
+						if(info.snapshotBufferSec<=0 || info.snapshotThreshold<=0)
+						{
+							cout<<"Snapshots need buffer_sec>0 and S/N>0."<<endl;
+							exit(0);
+						}
+						arg+=1;
+					}
+					else if(string(argv[arg]) == "-shmID")
 					{
 						info.shmID=info.stringToDouble(argv[arg+1]);				
           					arg+=2;
@@ -6268,6 +11288,11 @@ int main(int argc, char *argv[])
 						info.doUseTempo2=1;
 						arg+=1;
 					}
+					else if(string(argv[arg]) == "-tile")
+					{
+						info.doTiledExecution=1;
+						arg+=1;
+					}
 					else
 					{
 						nThreadMultiplicity=info.stringToDouble(argv[arg+1]);				
@@ -6275,6 +11300,54 @@ int main(int argc, char *argv[])
 					}
         			}
 				break;
+				case 'c':
+        			{          
+					if(string(argv[arg]) == "-chanmask")
+					{
+						info.doChannelMaskLibrary=1;
+						info.channelMaskOccupancy=info.stringToDouble(argv[arg+1])/100.0;
+						if(info.channelMaskOccupancy<=0 || info.channelMaskOccupancy>1)
+						{
+							cout<<"Channel mask occupancy must be between 0 and 100 percent."<<endl;
+							exit(0);
+						}
+						arg+=2;
+					}
+					else if(string(argv[arg]) == "-cube")
+					{
+						info.doCube=1;
+						info.cubeSubintSec=info.stringToDouble(argv[arg+1]);
+						info.cubeSubbands=int(info.stringToDouble(argv[arg+2]));
+						if(info.cubeSubintSec<=0 || info.cubeSubbands<1)
+						{
+							cout<<"Folded cube needs subint_sec>0 and n_subbands>=1."<<endl;
+							exit(0);
+						}
+						arg+=3;
+					}
+					else
+						arg+=1;
+        			}
+				break;
+				case 'd':
+        			{          
+					if(string(argv[arg]) == "-dmsearch")
+					{
+						info.doDMSearch=1;
+						info.dmSearchLow=info.stringToDouble(argv[arg+1]);
+						info.dmSearchHigh=info.stringToDouble(argv[arg+2]);
+						info.dmSearchTolerance=info.stringToDouble(argv[arg+3]);
+						if(info.dmSearchLow<0 || info.dmSearchHigh<info.dmSearchLow || info.dmSearchTolerance<=1)
+						{
+							cout<<"DM search needs 0<=DM_low<=DM_high and tolerance>1."<<endl;
+							exit(0);
+						}
+						arg+=4;
+					}
+					else
+						arg+=1;
+        			}
+				break;
 				case 'z':
         			{          
 					if(string(argv[arg]) == "-zsub")
@@ -6304,6 +11377,18 @@ int main(int argc, char *argv[])
 					}
         			}
         			break; 
+				case 'p':
+        			{          
+					if(string(argv[arg]) == "-pulsars")
+					{
+						info.doPulsarList=1;
+						info.pulsarListFile=argv[arg+1];
+						arg+=2;
+					}
+					else
+						arg+=1;
+        			}
+        			break;
 				case 'm':
         			{          
 					if(string(argv[arg]) == "-m")
@@ -6311,6 +11396,19 @@ int main(int argc, char *argv[])
 						info.meanval=int(info.stringToDouble(argv[arg+1]));
 						arg+=2;
 					}
+					else if(string(argv[arg]) == "-multipoint")
+					{
+						info.doMultiPointFilter=1;
+						info.multiPointLength=int(info.stringToDouble(argv[arg+1]));
+						if(info.multiPointLength<2 || info.multiPointLength>5)
+						{
+							cout<<"Multi-point time flagging tests runs of 2 to 5 samples."<<endl;
+							exit(0);
+						}
+						arg+=2;
+					}
+					else
+						arg+=1;
         			}
         			break;
 				default:
@@ -6360,6 +11458,13 @@ int main(int argc, char *argv[])
 	struct sigaction act;
     	act.sa_handler = intHandler;
     	sigaction(SIGINT, &act, NULL);
+	if(info.doSnapshot)
+	{
+		struct sigaction snapshotAct;
+		memset(&snapshotAct,0,sizeof(snapshotAct));
+		snapshotAct.sa_handler = snapshotHandler;
+		sigaction(SIGUSR1, &snapshotAct, NULL);
+	}
 	
     	
     	#pragma omp parallel sections 
@@ -6382,6 +11487,12 @@ int main(int argc, char *argv[])
 				runtime->quickclosePipe();
 			else
 				runtime->closePipe();
+			#pragma omp flush
+			runtime->isPipeClosed=1;
+		}
+		#pragma omp section
+		{
+			runtime->periodicityTasks();
 		}
 	}
 